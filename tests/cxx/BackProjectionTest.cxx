@@ -0,0 +1,165 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "BackProjectionKernels.h"
+
+using namespace tomviz;
+
+namespace {
+
+const double pi = 3.14159265359;
+
+// The double precision back projection the kernels replaced.
+void referenceBackProjection(const float* sinogram, const double* tiltAngles,
+                             float* image, int numOfTilts, int numOfRays)
+{
+  for (int i = 0; i < numOfRays * numOfRays; ++i) {
+    image[i] = 0;
+  }
+  for (int tt = 0; tt < numOfTilts; ++tt) {
+    double angle = tiltAngles[tt] * pi / 180;
+    for (int iy = 0; iy < numOfRays; ++iy) {
+      for (int iz = 0; iz < numOfRays; ++iz) {
+        double y = iy + 0.5 - ((double)numOfRays) / 2.0;
+        double z = iz + 0.5 - ((double)numOfRays) / 2.0;
+        double t = y * cos(angle) + z * sin(angle);
+        if (t >= -numOfRays / 2 && t <= numOfRays / 2) {
+          int rayIndex = floor((t + numOfRays / 2));
+          if (rayIndex >= 0 && rayIndex <= numOfRays - 2) {
+            double Q1 = sinogram[tt * numOfRays + rayIndex];
+            double Q2 = sinogram[tt * numOfRays + rayIndex + 1];
+            double QDash =
+              Q1 + (t - double(rayIndex - numOfRays / 2)) * (Q2 - Q1);
+            image[iy * numOfRays + iz] += QDash;
+          }
+        }
+      }
+    }
+  }
+}
+
+class BackProjectionTest : public ::testing::Test
+{
+protected:
+  void setUp(int numOfTilts, int numOfRays)
+  {
+    tilts = numOfTilts;
+    rays = numOfRays;
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    sinogram.resize(tilts * rays);
+    for (auto& value : sinogram) {
+      value = distribution(generator);
+    }
+    angles.resize(tilts);
+    cosines.resize(tilts);
+    sines.resize(tilts);
+    for (int tt = 0; tt < tilts; ++tt) {
+      angles[tt] = -73.0 + 146.0 * tt / tilts;
+      cosines[tt] = static_cast<float>(cos(angles[tt] * pi / 180));
+      sines[tt] = static_cast<float>(sin(angles[tt] * pi / 180));
+    }
+  }
+
+  std::vector<BackProjectionKernels::InstructionSet> supported() const
+  {
+    std::vector<BackProjectionKernels::InstructionSet> sets;
+    for (auto set : { BackProjectionKernels::InstructionSet::Scalar,
+                      BackProjectionKernels::InstructionSet::AVX2,
+                      BackProjectionKernels::InstructionSet::NEON }) {
+      if (BackProjectionKernels::isSupported(set)) {
+        sets.push_back(set);
+      }
+    }
+    return sets;
+  }
+
+  int tilts = 0;
+  int rays = 0;
+  std::vector<float> sinogram;
+  std::vector<double> angles;
+  std::vector<float> cosines;
+  std::vector<float> sines;
+};
+}
+
+TEST_F(BackProjectionTest, kernels_match_reference)
+{
+  // Odd sizes exercise the scalar tails of the SIMD kernels.
+  for (int size : { 2, 37, 64 }) {
+    setUp(45, size);
+    std::vector<float> expected(rays * rays);
+    referenceBackProjection(sinogram.data(), angles.data(), expected.data(),
+                            tilts, rays);
+    for (auto set : supported()) {
+      std::vector<float> image(rays * rays, -1.0f);
+      BackProjectionKernels::backProject(sinogram.data(), cosines.data(),
+                                         sines.data(), image.data(), tilts,
+                                         rays, set);
+      // Pixels whose ray lands within rounding of the edge of a projection
+      // may be included by one and not the other, each tilt adds at most 1.
+      int differences = 0;
+      for (int i = 0; i < rays * rays; ++i) {
+        if (std::abs(image[i] - expected[i]) > 1e-3f * tilts) {
+          ++differences;
+        }
+      }
+      ASSERT_LE(differences, rays / 8 + 1) << "instruction set "
+                                            << static_cast<int>(set);
+    }
+  }
+}
+
+// Not run by default, use --gtest_also_run_disabled_tests to compare the
+// kernels with the reference.
+TEST_F(BackProjectionTest, DISABLED_benchmark)
+{
+  setUp(180, 512);
+  std::vector<float> image(rays * rays);
+  auto time = [&](const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    const int repeats = 5;
+    for (int i = 0; i < repeats; ++i) {
+      run();
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repeats;
+  };
+
+  double reference = time([&]() {
+    referenceBackProjection(sinogram.data(), angles.data(), image.data(),
+                            tilts, rays);
+  });
+  std::cout << "reference: " << reference << " ms" << std::endl;
+  for (auto set : supported()) {
+    double kernel = time([&]() {
+      BackProjectionKernels::backProject(sinogram.data(), cosines.data(),
+                                         sines.data(), image.data(), tilts,
+                                         rays, set);
+    });
+    std::cout << "instruction set " << static_cast<int>(set) << ": "
+              << kernel << " ms (" << reference / kernel << "x)" << std::endl;
+  }
+}
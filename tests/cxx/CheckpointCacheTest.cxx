@@ -0,0 +1,176 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+#include "CheckpointCache.h"
+#include "Operator.h"
+#include "TomvizTest.h"
+#include "Utilities.h"
+
+using namespace tomviz;
+
+namespace {
+
+class NoOpOperator : public Operator
+{
+public:
+  QString label() const override { return "NoOp"; }
+  QIcon icon() const override { return QIcon(); }
+  Operator* clone() const override { return new NoOpOperator; }
+  bool serialize(pugi::xml_node&) const override { return true; }
+  bool deserialize(const pugi::xml_node&) override { return true; }
+
+protected:
+  bool applyTransform(vtkDataObject*) override { return true; }
+};
+
+vtkSmartPointer<vtkImageData> createImage(int dim, float value)
+{
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(dim, dim, dim);
+  image->AllocateScalars(VTK_FLOAT, 1);
+  auto data = static_cast<float*>(image->GetScalarPointer());
+  for (int i = 0; i < dim * dim * dim; ++i) {
+    data[i] = value;
+  }
+  return image;
+}
+
+qint64 imageSize(vtkImageData* image)
+{
+  return static_cast<qint64>(image->GetActualMemorySize()) * 1024;
+}
+}
+
+class CheckpointCacheTest : public ::testing::Test
+{
+protected:
+  NoOpOperator op1;
+  NoOpOperator op2;
+  NoOpOperator op3;
+  CheckpointCache cache;
+};
+
+TEST_F(CheckpointCacheTest, insert_copies)
+{
+  auto image = createImage(32, 1.0f);
+  cache.setBudget(imageSize(image) * 4);
+  ASSERT_TRUE(cache.insert(&op1, image, cache.generation()));
+
+  // Modifying the source must not touch the checkpoint, the arrays are shared
+  // until detached.
+  ASSERT_GT(detachSharedArrays(image), 0);
+  ASSERT_EQ(detachSharedArrays(image), 0);
+  static_cast<float*>(image->GetScalarPointer())[0] = 2.0f;
+  auto checkpoint = cache.find(&op1);
+  ASSERT_NE(checkpoint.Get(), nullptr);
+  ASSERT_EQ(static_cast<float*>(checkpoint->GetScalarPointer())[0], 1.0f);
+  ASSERT_EQ(cache.find(&op2).Get(), nullptr);
+}
+
+TEST_F(CheckpointCacheTest, detach_keeps_arrays_in_place)
+{
+  // Scalars first, then an unnamed array, then the active vectors.
+  auto image = createImage(4, 1.0f);
+  image->GetPointData()->GetScalars()->SetName("scalars");
+  vtkNew<vtkFloatArray> unnamed;
+  unnamed->SetNumberOfTuples(image->GetNumberOfPoints());
+  unnamed->FillValue(2.0f);
+  image->GetPointData()->AddArray(unnamed.Get());
+  vtkNew<vtkFloatArray> vectors;
+  vectors->SetName("vectors");
+  vectors->SetNumberOfComponents(3);
+  vectors->SetNumberOfTuples(image->GetNumberOfPoints());
+  vectors->FillValue(3.0f);
+  image->GetPointData()->SetVectors(vectors.Get());
+
+  auto shared = vtkSmartPointer<vtkImageData>::New();
+  copyOnWrite(image, shared);
+  vtkPointData* pointData = shared->GetPointData();
+  ASSERT_EQ(pointData->GetNumberOfArrays(), 3);
+  ASSERT_GT(detachSharedArrays(shared), 0);
+
+  ASSERT_EQ(pointData->GetNumberOfArrays(), 3);
+  for (int i = 0; i < 3; ++i) {
+    vtkAbstractArray* array = pointData->GetAbstractArray(i);
+    // None of the arrays are shared with image anymore.
+    EXPECT_EQ(array->GetReferenceCount(), 1);
+    EXPECT_NE(array, image->GetPointData()->GetAbstractArray(i));
+  }
+  EXPECT_STREQ(pointData->GetAbstractArray(0)->GetName(), "scalars");
+  EXPECT_EQ(pointData->GetAbstractArray(1)->GetName(), nullptr);
+  EXPECT_STREQ(pointData->GetAbstractArray(2)->GetName(), "vectors");
+  EXPECT_EQ(pointData->GetScalars(), pointData->GetAbstractArray(0));
+  EXPECT_EQ(pointData->GetVectors(), pointData->GetAbstractArray(2));
+  ASSERT_EQ(detachSharedArrays(shared), 0);
+}
+
+TEST_F(CheckpointCacheTest, evicts_least_recently_used)
+{
+  auto image = createImage(32, 1.0f);
+  cache.setBudget(imageSize(image) * 2);
+  ASSERT_TRUE(cache.insert(&op1, image, cache.generation()));
+  ASSERT_TRUE(cache.insert(&op2, image, cache.generation()));
+
+  // Touch op1 so op2 becomes the least recently used
+  ASSERT_NE(cache.find(&op1).Get(), nullptr);
+  ASSERT_TRUE(cache.insert(&op3, image, cache.generation()));
+
+  ASSERT_NE(cache.find(&op1).Get(), nullptr);
+  ASSERT_EQ(cache.find(&op2).Get(), nullptr);
+  ASSERT_NE(cache.find(&op3).Get(), nullptr);
+  ASSERT_LE(cache.size(), cache.budget());
+}
+
+TEST_F(CheckpointCacheTest, rejects_too_large)
+{
+  auto image = createImage(32, 1.0f);
+  cache.setBudget(imageSize(image) / 2);
+  ASSERT_FALSE(cache.insert(&op1, image, cache.generation()));
+  ASSERT_EQ(cache.size(), static_cast<qint64>(0));
+
+  cache.setBudget(0);
+  ASSERT_FALSE(cache.insert(&op1, image, cache.generation()));
+}
+
+TEST_F(CheckpointCacheTest, invalidate)
+{
+  auto image = createImage(16, 1.0f);
+  cache.setBudget(imageSize(image) * 8);
+  auto generation = cache.generation();
+  ASSERT_TRUE(cache.insert(&op1, image, generation));
+  ASSERT_TRUE(cache.insert(&op2, image, generation));
+
+  QList<Operator*> ops;
+  ops << &op2;
+  cache.invalidate(ops);
+  ASSERT_NE(cache.find(&op1).Get(), nullptr);
+  ASSERT_EQ(cache.find(&op2).Get(), nullptr);
+
+  // A run started before the invalidation can't add stale checkpoints
+  ASSERT_FALSE(cache.insert(&op3, image, generation));
+  ASSERT_TRUE(cache.insert(&op3, image, cache.generation()));
+
+  cache.clear();
+  ASSERT_EQ(cache.find(&op1).Get(), nullptr);
+  ASSERT_EQ(cache.size(), static_cast<qint64>(0));
+}
@@ -0,0 +1,301 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "ComputeHistogram.h"
+
+using namespace tomviz;
+
+namespace {
+
+// The single threaded histogram of the L2 norm of the tuples.
+template <typename T>
+std::vector<int> referenceHistogram(const std::vector<T>& values,
+                                    int numComponents, double min, double inc,
+                                    int numBins, int& invalid)
+{
+  std::vector<int> pops(numBins, 0);
+  for (size_t i = 0; i < values.size(); i += numComponents) {
+    double squaredSum = 0;
+    bool valid = true;
+    for (int c = 0; c < numComponents; ++c) {
+      double value = values[i + c];
+      valid = valid && std::isfinite(value);
+      squaredSum += value * value;
+    }
+    if (!valid) {
+      ++invalid;
+      continue;
+    }
+    double value = numComponents == 1 ? values[i] : std::sqrt(squaredSum);
+    int index = static_cast<int>((value - min) / inc);
+    ++pops[std::min(std::max(index, 0), numBins - 1)];
+  }
+  return pops;
+}
+}
+
+TEST(ComputeHistogramTest, float_values)
+{
+  const int numBins = 256;
+  // More than one block, with non finite values in several of them.
+  std::vector<float> values(5 * HistogramBlockSize + 123);
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> uniform(-3.0f, 11.0f);
+  for (auto& value : values) {
+    value = uniform(generator);
+  }
+  values[0] = std::numeric_limits<float>::quiet_NaN();
+  values[HistogramBlockSize + 5] = std::numeric_limits<float>::infinity();
+  values.back() = -std::numeric_limits<float>::infinity();
+  values[17] = -3.5f;
+  values[HistogramBlockSize * 3] = 11.5f;
+
+  double range[2] = { 0, 0 };
+  ASSERT_TRUE(CalculateFiniteRange(values.data(), values.size(), 1, -1,
+                                   range));
+  EXPECT_DOUBLE_EQ(range[0], -3.5);
+  EXPECT_DOUBLE_EQ(range[1], 11.5);
+
+  // Bin widths that are exact in binary, so that multiplying by the inverse
+  // gives the same bins as dividing.
+  const float inc = 1.0f / 16;
+  const float min = -8.0f;
+  std::vector<int> pops(numBins, 0);
+  int invalid = 0;
+  CalculateHistogram(values.data(), values.size(), 1, -1, min, pops.data(),
+                     inc, numBins, invalid);
+  EXPECT_EQ(invalid, 3);
+
+  int referenceInvalid = 0;
+  auto reference =
+    referenceHistogram(values, 1, min, inc, numBins, referenceInvalid);
+  EXPECT_EQ(pops, reference);
+}
+
+TEST(ComputeHistogramTest, integer_values)
+{
+  const int numBins = 64;
+  std::vector<std::uint16_t> values(3 * HistogramBlockSize + 7);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<std::uint16_t>((i * 2654435761u) % 4096);
+  }
+
+  double range[2] = { 0, 0 };
+  ASSERT_TRUE(CalculateFiniteRange(values.data(), values.size(), 1, 0, range));
+  EXPECT_DOUBLE_EQ(range[0], 0);
+  EXPECT_DOUBLE_EQ(range[1], 4095);
+
+  const float inc = 4096.0f / numBins;
+  std::vector<int> pops(numBins, 0);
+  int invalid = 0;
+  CalculateHistogram(values.data(), values.size(), 1, 0, 0.0f, pops.data(),
+                     inc, numBins, invalid);
+  EXPECT_EQ(invalid, 0);
+
+  int referenceInvalid = 0;
+  EXPECT_EQ(pops, referenceHistogram(values, 1, 0.0, inc, numBins,
+                                     referenceInvalid));
+}
+
+TEST(ComputeHistogramTest, magnitude)
+{
+  const int numBins = 32;
+  const int numComponents = 3;
+  const vtkIdType numTuples = HistogramBlockSize + 11;
+  std::vector<double> values(numTuples * numComponents);
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  for (auto& value : values) {
+    value = uniform(generator);
+  }
+  values[4] = std::numeric_limits<double>::quiet_NaN();
+
+  double range[2] = { 0, 0 };
+  ASSERT_TRUE(
+    CalculateFiniteRange(values.data(), numTuples, numComponents, -1, range));
+  EXPECT_GE(range[0], 0.0);
+  EXPECT_LE(range[1], std::sqrt(3.0));
+
+  const float inc = 1.0f / 16;
+  std::vector<int> pops(numBins, 0);
+  int invalid = 0;
+  CalculateHistogram(values.data(), numTuples, numComponents, -1, 0.0f,
+                     pops.data(), inc, numBins, invalid);
+  EXPECT_EQ(invalid, 1);
+
+  int referenceInvalid = 0;
+  EXPECT_EQ(pops, referenceHistogram(values, numComponents, 0.0, inc, numBins,
+                                     referenceInvalid));
+}
+
+TEST(ComputeHistogramTest, no_finite_values)
+{
+  std::vector<float> values(10, std::numeric_limits<float>::quiet_NaN());
+  double range[2] = { 1, 2 };
+  EXPECT_FALSE(CalculateFiniteRange(values.data(), values.size(), 1, 0, range));
+  EXPECT_EQ(range[0], 1);
+  EXPECT_EQ(range[1], 2);
+}
+
+namespace {
+
+// A smooth volume with some noise, so that the gradients cover many bins.
+std::vector<float> gradientVolume(const int dim[3])
+{
+  std::vector<float> volume(static_cast<size_t>(dim[0]) * dim[1] * dim[2]);
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> noise(0.0f, 4.0f);
+  size_t index = 0;
+  for (int k = 0; k < dim[2]; ++k) {
+    for (int j = 0; j < dim[1]; ++j) {
+      for (int i = 0; i < dim[0]; ++i) {
+        volume[index++] = 100.0f * std::sin(0.11f * i) * std::cos(0.07f * j) +
+                          2.0f * k + noise(generator);
+      }
+    }
+  }
+  return volume;
+}
+
+// The single threaded 2D histogram of the first component.
+std::vector<double> reference2DHistogram(const std::vector<float>& values,
+                                         const int dim[3], int numComp,
+                                         const double range[2],
+                                         const double spacing[3],
+                                         const int bins[2])
+{
+  std::vector<double> histogram(bins[0] * bins[1], 0.0);
+  const double avgSpacing = (spacing[0] + spacing[1] + spacing[2]) / 3.0;
+  const double invDelta[3] = { avgSpacing / (spacing[0] * 2),
+                               avgSpacing / (spacing[1] * 2),
+                               avgSpacing / (spacing[2] * 2) };
+  const double maxGradMag = range[1] * 0.25;
+  const double gradScale = (bins[1] - 1) / maxGradMag;
+  const double valueScale = (bins[0] - 1) / (range[1] - range[0]);
+  auto at = [&](int i, int j, int k) {
+    return static_cast<double>(
+      values[((static_cast<size_t>(k) * dim[1] + j) * dim[0] + i) * numComp]);
+  };
+  for (int k = 1; k < dim[2] - 1; ++k) {
+    for (int j = 1; j < dim[1] - 1; ++j) {
+      for (int i = 1; i < dim[0] - 1; ++i) {
+        double Dx = (at(i + 1, j, k) - at(i - 1, j, k)) * invDelta[0];
+        double Dy = (at(i, j + 1, k) - at(i, j - 1, k)) * invDelta[1];
+        double Dz = (at(i, j, k + 1) - at(i, j, k - 1)) * invDelta[2];
+        double gradMag = std::sqrt(Dx * Dx + Dy * Dy + Dz * Dz);
+        gradMag = std::min(std::floor(gradMag + 0.5), maxGradMag);
+        int gradIndex = static_cast<int>(gradMag * gradScale);
+        int valueIndex =
+          static_cast<int>((at(i, j, k) - range[0]) * valueScale);
+        valueIndex = std::min(std::max(valueIndex, 0), bins[0] - 1);
+        histogram[gradIndex * bins[0] + valueIndex] += 1.0;
+      }
+    }
+  }
+  return histogram;
+}
+}
+
+TEST(ComputeHistogramTest, gradient_histogram)
+{
+  const int dim[3] = { 37, 29, 23 };
+  const double spacing[3] = { 1.0, 1.5, 0.75 };
+  const int bins[2] = { 64, 48 };
+  auto volume = gradientVolume(dim);
+  double range[2] = { 0, 0 };
+  ASSERT_TRUE(CalculateFiniteRange(volume.data(), volume.size(), 1, 0, range));
+
+  std::vector<double> histogram(bins[0] * bins[1], -1.0);
+  CalculateGradientHistogram(volume.data(), dim, 1, range, spacing, bins,
+                             histogram.data());
+  EXPECT_EQ(histogram,
+            reference2DHistogram(volume, dim, 1, range, spacing, bins));
+
+  double total = 0;
+  for (double count : histogram) {
+    total += count;
+  }
+  EXPECT_EQ(total, (dim[0] - 2) * (dim[1] - 2) * (dim[2] - 2));
+}
+
+TEST(ComputeHistogramTest, gradient_histogram_components)
+{
+  // Only the first of the interleaved components is binned.
+  const int dim[3] = { 12, 10, 9 };
+  const double spacing[3] = { 1.0, 1.0, 1.0 };
+  const int bins[2] = { 16, 16 };
+  auto volume = gradientVolume(dim);
+  std::vector<float> interleaved(volume.size() * 2);
+  for (size_t i = 0; i < volume.size(); ++i) {
+    interleaved[2 * i] = volume[i];
+    interleaved[2 * i + 1] = std::numeric_limits<float>::quiet_NaN();
+  }
+  double range[2] = { 0, 0 };
+  ASSERT_TRUE(CalculateFiniteRange(volume.data(), volume.size(), 1, 0, range));
+
+  std::vector<double> histogram(bins[0] * bins[1]);
+  CalculateGradientHistogram(interleaved.data(), dim, 2, range, spacing, bins,
+                             histogram.data());
+  EXPECT_EQ(histogram,
+            reference2DHistogram(interleaved, dim, 2, range, spacing, bins));
+}
+
+// Not run by default, use --gtest_also_run_disabled_tests to compare the
+// parallel 2D histogram with the single threaded reference.
+TEST(ComputeHistogramTest, DISABLED_benchmark)
+{
+  const int dim[3] = { 256, 256, 256 };
+  const double spacing[3] = { 1.0, 1.0, 1.0 };
+  const int bins[2] = { 256, 256 };
+  auto volume = gradientVolume(dim);
+  double range[2] = { 0, 0 };
+  std::vector<double> histogram(bins[0] * bins[1]);
+  auto time = [&](const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    const int repeats = 3;
+    for (int i = 0; i < repeats; ++i) {
+      run();
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count() / repeats;
+  };
+
+  double rangeTime = time([&]() {
+    CalculateFiniteRange(volume.data(), volume.size(), 1, 0, range);
+  });
+  std::cout << "range: " << rangeTime << " ms" << std::endl;
+  double reference = time([&]() {
+    histogram = reference2DHistogram(volume, dim, 1, range, spacing, bins);
+  });
+  std::cout << "reference: " << reference << " ms" << std::endl;
+  double parallel = time([&]() {
+    CalculateGradientHistogram(volume.data(), dim, 1, range, spacing, bins,
+                               histogram.data());
+  });
+  std::cout << "parallel: " << parallel << " ms (" << reference / parallel
+            << "x)" << std::endl;
+}
@@ -0,0 +1,64 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "CrossCorrelationAlignment.h"
+
+using namespace tomviz;
+
+TEST(CrossCorrelationAlignmentTest, subpixel_offsets)
+{
+  // Blobs drawn at fractional positions, moved by a different translation in
+  // every image.
+  const int Nx = 96;
+  const int Ny = 80;
+  const int count = 7;
+  const int reference = 3;
+  const double translations[count][2] = { { 2.3, -1.6 }, { 1.1, 0.4 },
+                                          { -0.7, 2.25 }, { 0, 0 },
+                                          { 3.6, 1.5 },   { -2.4, -3.1 },
+                                          { 0.5, 4.8 } };
+  std::vector<float> images(static_cast<size_t>(Nx) * Ny * count);
+  for (int i = 0; i < count; ++i) {
+    float* image = &images[static_cast<size_t>(i) * Nx * Ny];
+    for (int y = 0; y < Ny; ++y) {
+      for (int x = 0; x < Nx; ++x) {
+        double value = 0;
+        for (int b = 0; b < 12; ++b) {
+          double bx = Nx / 2 + 25 * std::sin(2.1 * b) + translations[i][0];
+          double by = Ny / 2 + 20 * std::cos(3.3 * b) + translations[i][1];
+          double squared = (x - bx) * (x - bx) + (y - by) * (y - by);
+          value += (1 + b % 3) * std::exp(-squared / 18);
+        }
+        image[y * Nx + x] = static_cast<float>(value);
+      }
+    }
+  }
+
+  CrossCorrelationAlignment alignment(Nx, Ny);
+  auto offsets = alignment.align(&images[0], count, reference);
+  ASSERT_EQ(offsets.size(), static_cast<size_t>(count));
+  for (int i = 0; i < count; ++i) {
+    for (int axis = 0; axis < 2; ++axis) {
+      ASSERT_NEAR(offsets[i][axis],
+                  translations[reference][axis] - translations[i][axis], 0.05)
+        << i;
+    }
+  }
+}
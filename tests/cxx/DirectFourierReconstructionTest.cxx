@@ -0,0 +1,170 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "DirectFourierReconstruction.h"
+#include "FFT.h"
+#include "TomvizTest.h"
+
+using namespace tomviz;
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+}
+
+TEST(DirectFourierReconstructionTest, fft_any_size)
+{
+  for (int n : { 2, 5, 12, 100, 128 }) {
+    std::vector<std::complex<double>> data(n);
+    for (int i = 0; i < n; ++i) {
+      data[i] = std::complex<double>(std::sin(1.3 * i) + i % 3, std::cos(i));
+    }
+    auto transform = data;
+    FFT::transform(&transform[0], n);
+    for (int k = 0; k < n; ++k) {
+      std::complex<double> expected(0, 0);
+      for (int i = 0; i < n; ++i) {
+        expected += data[i] * std::polar(1.0, -2 * pi * k * i / n);
+      }
+      ASSERT_LT(std::abs(transform[k] - expected), 1e-9) << n;
+    }
+    FFT::transform(&transform[0], n, true);
+    for (int i = 0; i < n; ++i) {
+      ASSERT_LT(std::abs(transform[i] - data[i]), 1e-12) << n;
+    }
+  }
+}
+
+TEST(DirectFourierReconstructionTest, fft_concurrent)
+{
+  // Every thread uses the cached plans of all the sizes.
+  const std::vector<int> sizes = { 6, 7, 64, 96, 100 };
+  std::vector<std::vector<std::complex<double>>> expected;
+  for (int n : sizes) {
+    std::vector<std::complex<double>> data(n);
+    for (int i = 0; i < n; ++i) {
+      data[i] = std::complex<double>(std::cos(0.7 * i), i % 5);
+    }
+    expected.push_back(data);
+  }
+  std::vector<std::vector<std::vector<std::complex<double>>>> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&sizes, &expected, &result]() {
+      for (int repeat = 0; repeat < 50; ++repeat) {
+        result = expected;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+          FFT::transform(&result[i][0], sizes[i]);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    auto transform = expected[i];
+    FFT::transform(&transform[0], sizes[i]);
+    for (auto& result : results) {
+      for (int k = 0; k < sizes[i]; ++k) {
+        ASSERT_EQ(result[i][k], transform[k]) << sizes[i];
+      }
+    }
+  }
+}
+
+TEST(DirectFourierReconstructionTest, reconstructs_cylinder)
+{
+  // A cylinder of radius 10 along the tilt axis, centered in the volume. Its
+  // projections are the lengths of the chords at every angle.
+  const int Nx = 8;
+  const int Ny = 48;
+  const double radius = 10;
+  DirectFourierReconstruction reconstruction(Nx, Ny);
+  std::vector<double> projection(Nx * Ny);
+  for (int a = -90; a < 90; ++a) {
+    for (int y = 0; y < Ny; ++y) {
+      double offset = y - Ny / 2;
+      double chord =
+        offset * offset < radius * radius
+          ? 2 * std::sqrt(radius * radius - offset * offset)
+          : 0;
+      for (int x = 0; x < Nx; ++x) {
+        projection[y * Nx + x] = chord;
+      }
+    }
+    reconstruction.addProjection(&projection[0], a);
+  }
+
+  std::vector<double> volume(Nx * Ny * Ny);
+  reconstruction.reconstruct(&volume[0]);
+  double inside = 0;
+  double outside = 0;
+  int insideCount = 0;
+  int outsideCount = 0;
+  for (int z = 0; z < Ny; ++z) {
+    for (int y = 0; y < Ny; ++y) {
+      double r = std::hypot(y - Ny / 2, z - Ny / 2);
+      double value = volume[(z * Ny + y) * Nx + Nx / 2];
+      if (r < radius - 2) {
+        inside += value;
+        ++insideCount;
+      } else if (r > radius + 2) {
+        outside += std::abs(value);
+        ++outsideCount;
+      }
+    }
+  }
+  ASSERT_NEAR(inside / insideCount, 1.0, 0.15);
+  ASSERT_LT(outside / outsideCount, 0.1);
+}
+
+TEST(DirectFourierReconstructionTest, matches_recon_dft_py)
+{
+  // The output of Recon_DFT.py on a random tilt series, generated by
+  // fixtures/recon_dft.py.
+  std::ifstream file(SOURCE_DIR "/fixtures/recon_dft.txt");
+  ASSERT_TRUE(file.good());
+  int Nx, Ny, Nproj;
+  file >> Nx >> Ny >> Nproj;
+  std::vector<double> angles(Nproj);
+  std::vector<double> tiltSeries(Nx * Ny * Nproj);
+  std::vector<double> expected(Nx * Ny * Ny);
+  for (auto values : { &angles, &tiltSeries, &expected }) {
+    for (double& value : *values) {
+      file >> value;
+    }
+  }
+  ASSERT_FALSE(file.fail());
+
+  DirectFourierReconstruction reconstruction(Nx, Ny);
+  for (int a = 0; a < Nproj; ++a) {
+    reconstruction.addProjection(&tiltSeries[a * Nx * Ny], angles[a]);
+  }
+  std::vector<double> volume(Nx * Ny * Ny);
+  reconstruction.reconstruct(&volume[0]);
+  for (size_t i = 0; i < volume.size(); ++i) {
+    ASSERT_NEAR(volume[i], expected[i], 1e-12) << i;
+  }
+}
@@ -0,0 +1,106 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkImageData.h>
+#include <vtkLookupTable.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "FramePrefetcher.h"
+
+using namespace tomviz;
+
+TEST(FramePrefetcherTest, color_table)
+{
+  vtkNew<vtkLookupTable> lut;
+  lut->SetRange(-2.0, 6.0);
+  lut->SetHueRange(0.0, 0.0);
+  lut->SetSaturationRange(0.0, 0.0);
+  lut->SetValueRange(0.0, 1.0);
+  lut->Build();
+
+  auto table = FramePrefetcher::colorTable(lut.Get(), 256);
+  ASSERT_EQ(table.size(), 256);
+  EXPECT_DOUBLE_EQ(table.range[0], -2.0);
+  EXPECT_DOUBLE_EQ(table.range[1], 6.0);
+  // A gray ramp from black to white.
+  EXPECT_EQ(table.rgb[0], 0);
+  EXPECT_EQ(table.rgb[3 * 255], 255);
+  for (int i = 1; i < table.size(); ++i) {
+    EXPECT_GE(table.rgb[3 * i], table.rgb[3 * (i - 1)]);
+    EXPECT_EQ(table.rgb[3 * i], table.rgb[3 * i + 1]);
+    EXPECT_EQ(table.rgb[3 * i], table.rgb[3 * i + 2]);
+  }
+}
+
+TEST(FramePrefetcherTest, map_slice)
+{
+  const int nx = 5;
+  const int ny = 4;
+  const int nz = 3;
+  auto tiltSeries = vtkSmartPointer<vtkImageData>::New();
+  tiltSeries->SetOrigin(1.0, 2.0, 3.0);
+  tiltSeries->SetSpacing(0.5, 0.5, 2.0);
+  tiltSeries->SetDimensions(nx, ny, nz);
+  tiltSeries->AllocateScalars(VTK_FLOAT, 1);
+  auto values = static_cast<float*>(tiltSeries->GetScalarPointer());
+  for (int i = 0; i < nx * ny * nz; ++i) {
+    values[i] = static_cast<float>(i % 7) - 1.0f;
+  }
+  // Below, above and not in the range of the table.
+  float* slice = values + nx * ny;
+  slice[0] = -100.0f;
+  slice[1] = 100.0f;
+  slice[2] = std::numeric_limits<float>::quiet_NaN();
+
+  // Each entry holds its own index, the range gives one entry per unit.
+  FramePrefetcher::ColorTable table;
+  table.range[0] = 0.0;
+  table.range[1] = 5.0;
+  for (int i = 0; i <= 5; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      table.rgb.push_back(static_cast<unsigned char>(10 * i + c));
+    }
+  }
+
+  auto frame = FramePrefetcher::mapSlice(tiltSeries, 1, table);
+  int extent[6];
+  frame->GetExtent(extent);
+  EXPECT_EQ(extent[0], 0);
+  EXPECT_EQ(extent[1], nx - 1);
+  EXPECT_EQ(extent[3], ny - 1);
+  EXPECT_EQ(extent[4], 1);
+  EXPECT_EQ(extent[5], 1);
+  EXPECT_DOUBLE_EQ(frame->GetOrigin()[2], 3.0);
+  EXPECT_DOUBLE_EQ(frame->GetSpacing()[2], 2.0);
+  ASSERT_EQ(frame->GetScalarType(), VTK_UNSIGNED_CHAR);
+  ASSERT_EQ(frame->GetNumberOfScalarComponents(), 3);
+
+  auto rgb = static_cast<unsigned char*>(frame->GetScalarPointer());
+  EXPECT_EQ(rgb[0], 0);
+  EXPECT_EQ(rgb[3], 50);
+  EXPECT_EQ(rgb[6], 0);
+  for (int i = 3; i < nx * ny; ++i) {
+    int index = std::min(std::max(static_cast<int>(slice[i]), 0), 5);
+    EXPECT_EQ(rgb[3 * i], 10 * index);
+    EXPECT_EQ(rgb[3 * i + 1], 10 * index + 1);
+    EXPECT_EQ(rgb[3 * i + 2], 10 * index + 2);
+  }
+}
@@ -0,0 +1,254 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "IterativeReconstruction.h"
+#include "ParallelProjector.h"
+#include "ProjectionMatrix.h"
+
+using namespace tomviz;
+
+namespace {
+
+const int size = 32;
+
+// A disk with a brighter square in it
+std::vector<float> phantom()
+{
+  std::vector<float> image(size * size, 0.0f);
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      double dy = y - size / 2 + 0.5;
+      double dx = x - size / 2 + 0.5;
+      if (dx * dx + dy * dy < 100) {
+        image[y * size + x] = 1.0f;
+      }
+      if (std::abs(dy - 4) < 3 && std::abs(dx) < 3) {
+        image[y * size + x] = 2.0f;
+      }
+    }
+  }
+  return image;
+}
+
+double relativeError(const std::vector<float>& image,
+                     const std::vector<float>& expected)
+{
+  double error = 0;
+  double norm = 0;
+  for (size_t i = 0; i < image.size(); ++i) {
+    error += (image[i] - expected[i]) * (image[i] - expected[i]);
+    norm += expected[i] * expected[i];
+  }
+  return std::sqrt(error / norm);
+}
+}
+
+class IterativeReconstructionTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    for (int i = 0; i < 60; ++i) {
+      angles.push_back(-90.0 + 3 * i);
+    }
+    matrix = ProjectionMatrix::parallelRay(size, 1.0, angles, size, 1.0);
+    expected = phantom();
+    sinogram.resize(matrix.rows());
+    matrix.forward(expected.data(), sinogram.data());
+  }
+
+  std::vector<double> angles;
+  ProjectionMatrix matrix;
+  std::vector<float> expected;
+  std::vector<float> sinogram;
+};
+
+TEST_F(IterativeReconstructionTest, projection_matrix)
+{
+  ASSERT_EQ(matrix.rows(), 60 * size);
+  ASSERT_EQ(matrix.columns(), size * size);
+
+  // The rays cross the whole grid, a uniform image projects to its width.
+  std::vector<float> ones(size * size, 1.0f);
+  std::vector<float> lengths(matrix.rows());
+  matrix.forward(ones.data(), lengths.data());
+  ASSERT_NEAR(lengths[size / 2], size, 1e-4);
+
+  // The 0 degree rays are the rows of the grid, the first one runs along the
+  // bottom row of pixels.
+  int first = 30 * size;
+  ASSERT_EQ(matrix.rowOffsets()[first + 1] - matrix.rowOffsets()[first],
+            static_cast<size_t>(size));
+  ASSERT_EQ(matrix.columnIndices()[matrix.rowOffsets()[first]],
+            (size - 1) * size);
+
+  auto transpose = matrix.transposed();
+  ASSERT_EQ(transpose.rows(), matrix.columns());
+  ASSERT_EQ(transpose.nonZeros(), matrix.nonZeros());
+  ASSERT_EQ(transpose.transposed().rowOffsets(), matrix.rowOffsets());
+}
+
+TEST_F(IterativeReconstructionTest, converges)
+{
+  struct Run
+  {
+    IterativeReconstruction::Method method;
+    int iterations;
+    double relaxation;
+    double tolerance;
+  };
+  const Run runs[] = {
+    { IterativeReconstruction::Method::Landweber, 200, 0.0005, 0.1 },
+    { IterativeReconstruction::Method::ComponentAveraging, 20, 2.0, 0.15 },
+    { IterativeReconstruction::Method::ART, 20, 1.0, 0.05 }
+  };
+  for (const auto& run : runs) {
+    IterativeReconstruction reconstruction(matrix, run.method);
+    std::vector<float> image(size * size, 0.0f);
+    for (int i = 0; i < run.iterations; ++i) {
+      reconstruction.iterate(sinogram.data(), image.data(), run.relaxation);
+    }
+    ASSERT_LT(relativeError(image, expected), run.tolerance)
+      << "method " << static_cast<int>(run.method);
+  }
+}
+
+TEST_F(IterativeReconstructionTest, parallel_projector)
+{
+  ParallelProjector projector(size, 1.0, angles, size, 1.0);
+  ASSERT_EQ(projector.rows(), matrix.rows());
+  ASSERT_EQ(projector.columns(), matrix.columns());
+
+  // Close to the exact ray lengths of the matrix
+  std::vector<float> projections(projector.rows());
+  projector.forward(expected.data(), projections.data());
+  ASSERT_LT(relativeError(projections, sinogram), 0.05);
+
+  // <A x, y> == <x, A^T y>
+  std::vector<float> back(projector.columns());
+  projector.back(sinogram.data(), back.data());
+  double forwardDot = 0;
+  for (size_t r = 0; r < sinogram.size(); ++r) {
+    forwardDot += static_cast<double>(projections[r]) * sinogram[r];
+  }
+  double backDot = 0;
+  for (size_t c = 0; c < back.size(); ++c) {
+    backDot += static_cast<double>(expected[c]) * back[c];
+  }
+  ASSERT_NEAR(forwardDot / backDot, 1.0, 1e-5);
+
+  IterativeReconstruction reconstruction(
+    projector, IterativeReconstruction::Method::ComponentAveraging);
+  std::vector<float> image(size * size, 0.0f);
+  for (int i = 0; i < 20; ++i) {
+    reconstruction.iterate(sinogram.data(), image.data(), 2.0);
+  }
+  ASSERT_LT(relativeError(image, expected), 0.15);
+}
+
+TEST_F(IterativeReconstructionTest, batched)
+{
+  // Slice k is the phantom scaled by k + 1
+  const int count = 3;
+  std::vector<float> b(sinogram.size() * count);
+  for (size_t r = 0; r < sinogram.size(); ++r) {
+    for (int k = 0; k < count; ++k) {
+      b[r * count + k] = sinogram[r] * (k + 1);
+    }
+  }
+
+  ParallelProjector projector(size, 1.0, angles, size, 1.0);
+  const Projector* projectors[] = { &matrix, &projector };
+  for (auto method : { IterativeReconstruction::Method::ComponentAveraging,
+                       IterativeReconstruction::Method::ART }) {
+    for (auto p : projectors) {
+      IterativeReconstruction reconstruction(*p, method);
+      std::vector<float> single(size * size, 0.0f);
+      std::vector<float> batch(size * size * count, 0.0f);
+      for (int i = 0; i < 3; ++i) {
+        reconstruction.iterate(sinogram.data(), single.data(), 1.0);
+        reconstruction.iterate(b.data(), batch.data(), 1.0, count);
+      }
+      std::vector<std::vector<float>> results(
+        count, std::vector<float>(size * size));
+      std::vector<float*> slices;
+      for (auto& result : results) {
+        slices.push_back(result.data());
+      }
+      deinterleaveSlices(batch.data(), count, size * size, slices.data());
+      for (int k = 0; k < count; ++k) {
+        std::vector<float> scaled(single);
+        for (auto& value : scaled) {
+          value *= k + 1;
+        }
+        ASSERT_LT(relativeError(results[k], scaled), 1e-5);
+      }
+    }
+  }
+}
+
+TEST_F(IterativeReconstructionTest, DISABLED_benchmark)
+{
+  const int side = 256;
+  const int slices = 32;
+  const int iterations = 5;
+  angles.clear();
+  for (int i = 0; i < 90; ++i) {
+    angles.push_back(-90.0 + 2 * i);
+  }
+  auto bigMatrix = ProjectionMatrix::parallelRay(side, 1.0, angles, side, 1.0);
+  IterativeReconstruction reconstruction(
+    bigMatrix, IterativeReconstruction::Method::ComponentAveraging);
+  std::vector<float> b(static_cast<size_t>(bigMatrix.rows()) * slices, 1.0f);
+  std::vector<float> f(static_cast<size_t>(bigMatrix.columns()) * slices);
+
+  auto time = [&](const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  };
+
+  double single = time([&]() {
+    for (int s = 0; s < slices; ++s) {
+      for (int i = 0; i < iterations; ++i) {
+        reconstruction.iterate(&b[s * bigMatrix.rows()],
+                               &f[s * bigMatrix.columns()], 1.0);
+      }
+    }
+  });
+  std::cout << "per slice: " << single << " ms" << std::endl;
+  for (int count : { 4, 8, 16 }) {
+    double batched = time([&]() {
+      for (int s = 0; s < slices; s += count) {
+        for (int i = 0; i < iterations; ++i) {
+          reconstruction.iterate(&b[s * bigMatrix.rows()],
+                                 &f[s * bigMatrix.columns()], 1.0, count);
+        }
+      }
+    });
+    std::cout << "blocks of " << count << ": " << batched << " ms ("
+              << single / batched << "x)" << std::endl;
+  }
+}
@@ -0,0 +1,180 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "LiveReconstruction.h"
+#include "TomographyReconstruction.h"
+
+using namespace tomviz;
+
+TEST(LiveReconstructionTest, matches_weighted_back_projection)
+{
+  const int Nx = 4;
+  const int Ny = 24;
+  const int tilts = 15;
+  vtkNew<vtkImageData> tiltSeries;
+  tiltSeries->SetDimensions(Nx, Ny, tilts);
+  tiltSeries->AllocateScalars(VTK_FLOAT, 1);
+  auto data = static_cast<float*>(tiltSeries->GetScalarPointer());
+  for (int i = 0; i < Nx * Ny * tilts; ++i) {
+    data[i] = static_cast<float>(std::sin(0.37 * i) + 1);
+  }
+  vtkNew<vtkDoubleArray> angles;
+  angles->SetName("tilt_angles");
+  for (int t = 0; t < tilts; ++t) {
+    angles->InsertNextValue(-70.0 + 10 * t);
+  }
+  tiltSeries->GetFieldData()->AddArray(angles.Get());
+
+  LiveReconstruction live;
+  for (int t = 0; t < tilts; ++t) {
+    vtkNew<vtkImageData> projection;
+    projection->SetDimensions(Nx, Ny, 1);
+    projection->AllocateScalars(VTK_FLOAT, 1);
+    auto values = static_cast<float*>(projection->GetScalarPointer());
+    std::copy(data + t * Nx * Ny, data + (t + 1) * Nx * Ny, values);
+    ASSERT_TRUE(live.addProjection(projection.Get(), angles->GetValue(t)));
+  }
+  ASSERT_EQ(live.numberOfProjections(), tilts);
+
+  vtkNew<vtkImageData> expected;
+  TomographyReconstruction::weightedBackProjection3(tiltSeries.Get(),
+                                                    expected.Get());
+  auto reconstruction = live.reconstruction();
+  int dims[3];
+  reconstruction->GetDimensions(dims);
+  ASSERT_EQ(dims[0], Nx);
+  ASSERT_EQ(dims[1], Ny);
+  ASSERT_EQ(dims[2], Ny);
+  auto result = static_cast<float*>(reconstruction->GetScalarPointer());
+  auto reference = static_cast<float*>(expected->GetScalarPointer());
+  for (int i = 0; i < Nx * Ny * Ny; ++i) {
+    ASSERT_NEAR(result[i], reference[i], 1e-4 * (1 + std::abs(reference[i])));
+  }
+
+  live.reset();
+  ASSERT_EQ(live.numberOfProjections(), 0);
+  ASSERT_EQ(live.volume(), nullptr);
+}
+
+TEST(LiveReconstructionTest, replaces_duplicate_angles)
+{
+  const int Nx = 3;
+  const int Ny = 16;
+  auto makeProjection = [Nx, Ny](double phase) {
+    auto projection = vtkSmartPointer<vtkImageData>::New();
+    projection->SetDimensions(Nx, Ny, 1);
+    projection->AllocateScalars(VTK_FLOAT, 1);
+    auto values = static_cast<float*>(projection->GetScalarPointer());
+    for (int i = 0; i < Nx * Ny; ++i) {
+      values[i] = static_cast<float>(std::cos(0.29 * i + phase) + 1);
+    }
+    return projection;
+  };
+
+  LiveReconstruction expected;
+  ASSERT_TRUE(expected.addProjection(makeProjection(0.0), 0.0));
+  ASSERT_TRUE(expected.addProjection(makeProjection(1.0), 30.0));
+
+  // The second projection at zero degrees replaces the first one
+  LiveReconstruction live;
+  ASSERT_TRUE(live.addProjection(makeProjection(2.0), 0.0));
+  ASSERT_TRUE(live.addProjection(makeProjection(1.0), 30.0));
+  ASSERT_TRUE(live.addProjection(makeProjection(0.0), 0.0));
+  ASSERT_EQ(live.numberOfProjections(), 2);
+
+  auto result = live.reconstruction();
+  auto reference = expected.reconstruction();
+  auto resultData = static_cast<float*>(result->GetScalarPointer());
+  auto referenceData = static_cast<float*>(reference->GetScalarPointer());
+  for (vtkIdType i = 0; i < result->GetNumberOfPoints(); ++i) {
+    ASSERT_NEAR(resultData[i], referenceData[i],
+                1e-4 * (1 + std::abs(referenceData[i])));
+  }
+}
+
+TEST(LiveReconstructionTest, bins_large_projections)
+{
+  // Binned by 3 down to 5 by 8, the last column is dropped
+  const int Nx = 16;
+  const int Ny = 24;
+  const int bin = 3;
+  const int angles[] = { -45, 0, 45 };
+  LiveReconstruction live;
+  live.setMaximumSize(8);
+  LiveReconstruction expected;
+  for (int angle : angles) {
+    vtkNew<vtkImageData> projection;
+    projection->SetDimensions(Nx, Ny, 1);
+    projection->AllocateScalars(VTK_FLOAT, 1);
+    auto values = static_cast<float*>(projection->GetScalarPointer());
+    for (int i = 0; i < Nx * Ny; ++i) {
+      values[i] = static_cast<float>(std::sin(0.13 * i + angle) + 1);
+    }
+    vtkNew<vtkImageData> binned;
+    binned->SetDimensions(Nx / bin, Ny / bin, 1);
+    binned->AllocateScalars(VTK_FLOAT, 1);
+    auto binnedValues = static_cast<float*>(binned->GetScalarPointer());
+    for (int y = 0; y < Ny / bin; ++y) {
+      for (int x = 0; x < Nx / bin; ++x) {
+        float sum = 0;
+        for (int i = 0; i < bin * bin; ++i) {
+          sum += values[(y * bin + i / bin) * Nx + x * bin + i % bin];
+        }
+        binnedValues[y * (Nx / bin) + x] = sum / (bin * bin);
+      }
+    }
+    ASSERT_TRUE(live.addProjection(projection.Get(), angle));
+    ASSERT_TRUE(expected.addProjection(binned.Get(), angle));
+  }
+
+  auto result = live.reconstruction();
+  int dims[3];
+  result->GetDimensions(dims);
+  ASSERT_EQ(dims[0], Nx / bin);
+  ASSERT_EQ(dims[1], Ny / bin);
+  ASSERT_EQ(dims[2], Ny / bin);
+  ASSERT_EQ(result->GetSpacing()[0], bin);
+
+  // The binned voxels are bin times as long
+  auto reference = expected.reconstruction();
+  auto resultData = static_cast<float*>(result->GetScalarPointer());
+  auto referenceData = static_cast<float*>(reference->GetScalarPointer());
+  for (vtkIdType i = 0; i < result->GetNumberOfPoints(); ++i) {
+    ASSERT_NEAR(resultData[i] * bin, referenceData[i],
+                1e-4 * (1 + std::abs(referenceData[i])));
+  }
+
+  // The center slice across the tilt axis
+  auto slice = live.centerSlice();
+  slice->GetDimensions(dims);
+  ASSERT_EQ(dims[0], 1);
+  ASSERT_EQ(dims[1], Ny / bin);
+  ASSERT_EQ(dims[2], Ny / bin);
+  auto sliceData = static_cast<float*>(slice->GetScalarPointer());
+  for (int i = 0; i < dims[1] * dims[2]; ++i) {
+    ASSERT_EQ(sliceData[i], resultData[i * (Nx / bin) + Nx / bin / 2]);
+  }
+}
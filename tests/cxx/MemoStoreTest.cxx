@@ -0,0 +1,204 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+#include "MemoStore.h"
+#include "Operator.h"
+#include "TomvizTest.h"
+
+using namespace tomviz;
+
+namespace {
+
+class AddOperator : public Operator
+{
+public:
+  QString label() const override { return "Add"; }
+  QIcon icon() const override { return QIcon(); }
+  Operator* clone() const override { return new AddOperator; }
+  bool serialize(pugi::xml_node& ns) const override
+  {
+    ns.append_attribute("value").set_value(value);
+    return true;
+  }
+  bool deserialize(const pugi::xml_node& ns) override
+  {
+    value = ns.attribute("value").as_float();
+    return true;
+  }
+
+  float value = 1.0f;
+  int runs = 0;
+
+protected:
+  bool applyTransform(vtkDataObject* data) override
+  {
+    auto image = vtkImageData::SafeDownCast(data);
+    auto scalars = static_cast<float*>(image->GetScalarPointer());
+    for (vtkIdType i = 0; i < image->GetNumberOfPoints(); ++i) {
+      scalars[i] += value;
+    }
+    ++runs;
+    return true;
+  }
+};
+
+vtkSmartPointer<vtkImageData> createImage(int dim, float value)
+{
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(dim, dim, dim);
+  image->AllocateScalars(VTK_FLOAT, 1);
+  auto data = static_cast<float*>(image->GetScalarPointer());
+  for (int i = 0; i < dim * dim * dim; ++i) {
+    data[i] = value;
+  }
+  return image;
+}
+
+float firstValue(vtkImageData* image)
+{
+  return static_cast<float*>(image->GetScalarPointer())[0];
+}
+}
+
+class MemoStoreTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    MemoStore::instance().setBudget(64 * 1024 * 1024);
+    MemoStore::instance().setHashMode(MemoStore::HashMode::Full);
+    MemoStore::instance().clear();
+  }
+
+  AddOperator op;
+};
+
+TEST_F(MemoStoreTest, reuses_output)
+{
+  auto image = createImage(16, 1.0f);
+  ASSERT_EQ(op.transform(image), TransformResult::Complete);
+  ASSERT_EQ(firstValue(image), 2.0f);
+
+  auto again = createImage(16, 1.0f);
+  ASSERT_EQ(op.transform(again), TransformResult::Complete);
+  ASSERT_EQ(firstValue(again), 2.0f);
+  ASSERT_EQ(op.runs, 1);
+
+  // The stored output must not be modified through the reused arrays.
+  ASSERT_EQ(op.transform(again), TransformResult::Complete);
+  ASSERT_EQ(firstValue(again), 3.0f);
+  auto third = createImage(16, 1.0f);
+  ASSERT_EQ(op.transform(third), TransformResult::Complete);
+  ASSERT_EQ(firstValue(third), 2.0f);
+}
+
+TEST_F(MemoStoreTest, parameters_are_part_of_the_key)
+{
+  auto image = createImage(16, 1.0f);
+  ASSERT_EQ(op.transform(image), TransformResult::Complete);
+
+  op.value = 5.0f;
+  auto again = createImage(16, 1.0f);
+  ASSERT_EQ(op.transform(again), TransformResult::Complete);
+  ASSERT_EQ(firstValue(again), 6.0f);
+  ASSERT_EQ(op.runs, 2);
+}
+
+TEST_F(MemoStoreTest, data_is_part_of_the_key)
+{
+  auto image = createImage(16, 1.0f);
+  auto other = createImage(16, 1.0f);
+  static_cast<float*>(other->GetScalarPointer())[100] = 7.0f;
+  ASSERT_NE(MemoStore::hash(image), MemoStore::hash(other));
+
+  auto spaced = createImage(16, 1.0f);
+  spaced->SetSpacing(2.0, 1.0, 1.0);
+  ASSERT_NE(MemoStore::hash(image), MemoStore::hash(spaced));
+
+  // The metadata hash ignores the voxels.
+  ASSERT_EQ(MemoStore::hashMetadata(image), MemoStore::hashMetadata(other));
+  ASSERT_NE(MemoStore::hashMetadata(image), MemoStore::hashMetadata(spaced));
+}
+
+TEST_F(MemoStoreTest, key_covers_every_value)
+{
+  // Large enough for a sampled hash to miss the edit.
+  auto image = createImage(128, 1.0f);
+  QByteArray key = MemoStore::instance().key(&op, image);
+  ASSERT_FALSE(key.isEmpty());
+  static_cast<float*>(image->GetScalarPointer())[4096 + 1] = 7.0f;
+  ASSERT_NE(MemoStore::instance().key(&op, image), key);
+}
+
+TEST_F(MemoStoreTest, full_hash_covers_every_block)
+{
+  // 8 blocks of a megabyte, an edit in the last one.
+  auto image = createImage(128, 1.0f);
+  quint64 hash = MemoStore::hash(image);
+  static_cast<float*>(image->GetScalarPointer())[128 * 128 * 128 - 1] = 7.0f;
+  ASSERT_NE(MemoStore::hash(image), hash);
+
+  // Not a whole number of words.
+  auto small = createImage(3, 1.0f);
+  hash = MemoStore::hash(small);
+  static_cast<float*>(small->GetScalarPointer())[26] = 7.0f;
+  ASSERT_NE(MemoStore::hash(small), hash);
+}
+
+TEST_F(MemoStoreTest, sampled_hash_mode)
+{
+  auto image = createImage(16, 1.0f);
+  ASSERT_EQ(op.transform(image), TransformResult::Complete);
+  ASSERT_GT(MemoStore::instance().size(), 0);
+
+  // Changing the mode invalidates the keys.
+  MemoStore::instance().setHashMode(MemoStore::HashMode::Sampled);
+  ASSERT_EQ(MemoStore::instance().size(), 0);
+
+  // Blind to an edit between the sampled blocks.
+  auto large = createImage(128, 1.0f);
+  QByteArray key = MemoStore::instance().key(&op, large);
+  ASSERT_FALSE(key.isEmpty());
+  static_cast<float*>(large->GetScalarPointer())[4096 + 1] = 7.0f;
+  ASSERT_EQ(MemoStore::instance().key(&op, large), key);
+  static_cast<float*>(large->GetScalarPointer())[0] = 7.0f;
+  ASSERT_NE(MemoStore::instance().key(&op, large), key);
+}
+
+TEST_F(MemoStoreTest, data_larger_than_budget_is_not_hashed)
+{
+  auto image = createImage(16, 1.0f);
+  qint64 bytes = static_cast<qint64>(image->GetActualMemorySize()) * 1024;
+  MemoStore::instance().setBudget(bytes - 1);
+  ASSERT_TRUE(MemoStore::instance().key(&op, image).isEmpty());
+  MemoStore::instance().setBudget(bytes);
+  ASSERT_FALSE(MemoStore::instance().key(&op, image).isEmpty());
+}
+
+TEST_F(MemoStoreTest, disabled_by_zero_budget)
+{
+  MemoStore::instance().setBudget(0);
+  auto image = createImage(16, 1.0f);
+  ASSERT_TRUE(MemoStore::instance().key(&op, image).isEmpty());
+  ASSERT_EQ(op.transform(image), TransformResult::Complete);
+  auto again = createImage(16, 1.0f);
+  ASSERT_EQ(op.transform(again), TransformResult::Complete);
+  ASSERT_EQ(op.runs, 2);
+}
@@ -0,0 +1,169 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include <thread>
+
+#include "MemoStore.h"
+#include "Operator.h"
+#include "PipelineTracer.h"
+#include "TomvizTest.h"
+
+using namespace tomviz;
+
+namespace {
+
+class SleepOperator : public Operator
+{
+public:
+  QString label() const override { return "Sleep"; }
+  QIcon icon() const override { return QIcon(); }
+  Operator* clone() const override { return new SleepOperator; }
+  bool serialize(pugi::xml_node&) const override { return true; }
+  bool deserialize(const pugi::xml_node&) override { return true; }
+
+protected:
+  bool applyTransform(vtkDataObject*) override
+  {
+    QThread::msleep(20);
+    return true;
+  }
+};
+
+vtkSmartPointer<vtkImageData> createImage(int dim)
+{
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(dim, dim, dim);
+  image->AllocateScalars(VTK_FLOAT, 1);
+  return image;
+}
+}
+
+class PipelineTracerTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    // Memoized outputs would skip the operators.
+    MemoStore::instance().setBudget(0);
+    PipelineTracer::instance().clear();
+    PipelineTracer::instance().setEnabled(true);
+  }
+
+  void TearDown() override { PipelineTracer::instance().setEnabled(false); }
+
+  SleepOperator op;
+};
+
+TEST_F(PipelineTracerTest, disabled_records_nothing)
+{
+  PipelineTracer::instance().setEnabled(false);
+  {
+    PipelineTracer::Scope scope(&op);
+    op.transform(createImage(8));
+  }
+  ASSERT_TRUE(PipelineTracer::instance().events().isEmpty());
+}
+
+TEST_F(PipelineTracerTest, records_each_operator)
+{
+  {
+    PipelineTracer::Scope scope(&op, 5);
+    ASSERT_EQ(op.transform(createImage(8)), TransformResult::Complete);
+  }
+  {
+    PipelineTracer::Scope scope(&op);
+    ASSERT_EQ(op.transform(createImage(8)), TransformResult::Complete);
+  }
+
+  auto events = PipelineTracer::instance().events();
+  ASSERT_EQ(events.size(), 2);
+  ASSERT_EQ(events[0].name, QString("Sleep"));
+  ASSERT_EQ(events[0].waitTime, 5);
+  ASSERT_GE(events[0].wallTime, 20000);
+  // Sleeping doesn't use the CPU.
+  ASSERT_LT(events[0].cpuTime, events[0].wallTime);
+  ASSERT_GE(events[1].start, events[0].start + events[0].wallTime);
+}
+
+TEST_F(PipelineTracerTest, bytes_copied)
+{
+  auto image = createImage(16);
+  auto shared = createImage(16);
+  shared->ShallowCopy(image);
+  {
+    PipelineTracer::Scope scope(&op);
+    ASSERT_EQ(op.transform(shared), TransformResult::Complete);
+  }
+
+  // The operator modifies its input in place, the shared scalars are copied.
+  auto events = PipelineTracer::instance().events();
+  ASSERT_EQ(events.size(), 1);
+  ASSERT_EQ(events[0].bytesCopied, 16 * 16 * 16 * 4);
+}
+
+TEST_F(PipelineTracerTest, gil_wait_is_attributed_to_the_thread)
+{
+  {
+    PipelineTracer::Scope scope(&op);
+    PipelineTracer::addGilWaitTime(100);
+    std::thread other([]() { PipelineTracer::addGilWaitTime(1000); });
+    other.join();
+    PipelineTracer::addGilWaitTime(20);
+  }
+
+  auto events = PipelineTracer::instance().events();
+  ASSERT_EQ(events.size(), 1);
+  ASSERT_EQ(events[0].gilWaitTime, 120);
+}
+
+TEST_F(PipelineTracerTest, chrome_trace)
+{
+  {
+    PipelineTracer::Scope scope(&op, 1000);
+    ASSERT_EQ(op.transform(createImage(8)), TransformResult::Complete);
+  }
+
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  QString fileName = dir.filePath("trace.json");
+  ASSERT_TRUE(PipelineTracer::instance().writeChromeTrace(fileName));
+
+  QFile file(fileName);
+  ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+  auto document = QJsonDocument::fromJson(file.readAll());
+  ASSERT_TRUE(document.isObject());
+  auto traceEvents = document.object()["traceEvents"].toArray();
+  // The operator and the time it was queued.
+  ASSERT_EQ(traceEvents.size(), 2);
+  auto complete = traceEvents[0].toObject();
+  ASSERT_EQ(complete["name"].toString(), QString("Sleep"));
+  ASSERT_EQ(complete["ph"].toString(), QString("X"));
+  ASSERT_GE(complete["dur"].toDouble(), 20000.0);
+  auto queued = traceEvents[1].toObject();
+  ASSERT_EQ(queued["dur"].toDouble(), 1000.0);
+  ASSERT_EQ(queued["ts"].toDouble() + 1000.0, complete["ts"].toDouble());
+}
@@ -0,0 +1,139 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTrivialProducer.h>
+#include <vtkXMLImageDataReader.h>
+
+#include <QTemporaryDir>
+
+#include "Operator.h"
+#include "SlabStreamer.h"
+#include "TomvizTest.h"
+
+using namespace tomviz;
+
+namespace {
+
+/// Averages each slice with its neighbors, so a slab needs one slice of halo.
+class SmoothZOperator : public Operator
+{
+public:
+  QString label() const override { return "SmoothZ"; }
+  QIcon icon() const override { return QIcon(); }
+  Operator* clone() const override { return new SmoothZOperator; }
+  bool serialize(pugi::xml_node&) const override { return true; }
+  bool deserialize(const pugi::xml_node&) override { return true; }
+  bool supportsSlabs() const override { return true; }
+  int slabHalo() const override { return 1; }
+
+protected:
+  bool applyTransform(vtkDataObject* data) override
+  {
+    auto image = vtkImageData::SafeDownCast(data);
+    int dims[3];
+    image->GetDimensions(dims);
+    auto input = static_cast<float*>(image->GetScalarPointer());
+    vtkNew<vtkFloatArray> output;
+    output->SetNumberOfTuples(image->GetNumberOfPoints());
+    output->SetName("scalars");
+    vtkIdType slice = dims[0] * dims[1];
+    for (int k = 0; k < dims[2]; ++k) {
+      int below = k > 0 ? k - 1 : k;
+      int above = k < dims[2] - 1 ? k + 1 : k;
+      for (vtkIdType i = 0; i < slice; ++i) {
+        output->SetValue(k * slice + i, (input[below * slice + i] +
+                                         input[k * slice + i] +
+                                         input[above * slice + i]) /
+                                          3.0f);
+      }
+    }
+    image->GetPointData()->SetScalars(output.Get());
+    return true;
+  }
+};
+
+vtkSmartPointer<vtkImageData> createImage()
+{
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(4, 3, 11);
+  image->SetSpacing(1.0, 2.0, 3.0);
+  image->AllocateScalars(VTK_FLOAT, 1);
+  image->GetPointData()->GetScalars()->SetName("scalars");
+  auto data = static_cast<float*>(image->GetScalarPointer());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints(); ++i) {
+    data[i] = static_cast<float>(i % 7) * static_cast<float>(i / 12);
+  }
+  vtkNew<vtkDoubleArray> angles;
+  angles->SetName("tilt_angles");
+  angles->SetNumberOfTuples(11);
+  for (int i = 0; i < 11; ++i) {
+    angles->SetValue(i, -50.0 + 10 * i);
+  }
+  image->GetFieldData()->AddArray(angles.Get());
+  return image;
+}
+}
+
+TEST(SlabStreamerTest, matches_in_memory_execution)
+{
+  auto image = createImage();
+  vtkNew<vtkTrivialProducer> source;
+  source->SetOutput(image);
+
+  SmoothZOperator op1;
+  SmoothZOperator op2;
+  QList<Operator*> ops;
+  ops << &op1 << &op2;
+  ASSERT_TRUE(SlabStreamer::canStream(ops));
+  ASSERT_EQ(SlabStreamer::halo(ops), 2);
+
+  QTemporaryDir dir;
+  QString fileName = dir.filePath("streamed.vti");
+  SlabStreamer streamer(source.Get(), ops, fileName);
+  // Slabs that don't divide the volume, and are thinner than the halo.
+  streamer.setSlabThickness(2);
+  ASSERT_TRUE(streamer.execute());
+
+  vtkNew<vtkImageData> expected;
+  expected->DeepCopy(image);
+  ASSERT_EQ(op1.transform(expected.Get()), TransformResult::Complete);
+  ASSERT_EQ(op2.transform(expected.Get()), TransformResult::Complete);
+
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(fileName.toLatin1().data());
+  reader->Update();
+  vtkImageData* streamed = reader->GetOutput();
+  ASSERT_EQ(streamed->GetNumberOfPoints(), expected->GetNumberOfPoints());
+  ASSERT_EQ(streamed->GetSpacing()[2], 3.0);
+  auto expectedValues = static_cast<float*>(expected->GetScalarPointer());
+  auto streamedValues = static_cast<float*>(streamed->GetScalarPointer());
+  for (vtkIdType i = 0; i < expected->GetNumberOfPoints(); ++i) {
+    ASSERT_FLOAT_EQ(streamedValues[i], expectedValues[i]);
+  }
+
+  vtkDataArray* angles = streamed->GetFieldData()->GetArray("tilt_angles");
+  ASSERT_NE(angles, nullptr);
+  ASSERT_EQ(angles->GetNumberOfTuples(), 11);
+  ASSERT_EQ(angles->GetTuple1(10), 50.0);
+}
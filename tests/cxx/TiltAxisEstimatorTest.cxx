@@ -0,0 +1,100 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+#include <cmath>
+#include <vector>
+
+#include "TiltAxisEstimator.h"
+#include "TomographyTiltSeries.h"
+
+using namespace tomviz;
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+struct Ball
+{
+  double x, y, z, radius, density;
+};
+}
+
+TEST(TiltAxisEstimatorTest, finds_shift_and_angle)
+{
+  // Balls projected with a tilt axis shifted and rotated as the
+  // RotateAlignWidget models it: slice x is shifted by
+  // -shift + sin(-angle) * (x - Nx / 2) rays.
+  const int Nx = 64;
+  const int Ny = 128;
+  const double shift = 3.3;
+  const double angle = 1.5;
+  std::vector<double> tiltAngles;
+  for (int a = -70; a <= 70; a += 2) {
+    tiltAngles.push_back(a);
+  }
+  const int tilts = static_cast<int>(tiltAngles.size());
+  std::vector<Ball> balls;
+  for (int i = 0; i < 40; ++i) {
+    balls.push_back({ (std::sin(7.1 * i) + 1) / 2 * Nx,
+                      0.3 * Ny * std::sin(3.7 * i + 1),
+                      0.3 * Ny * std::cos(5.3 * i + 2),
+                      (std::sin(1.9 * i) + 1.5) * Ny / 40,
+                      std::cos(2.3 * i) + 1.5 });
+  }
+
+  vtkNew<vtkImageData> tiltSeries;
+  tiltSeries->SetDimensions(Nx, Ny, tilts);
+  tiltSeries->AllocateScalars(VTK_FLOAT, 1);
+  auto data = static_cast<float*>(tiltSeries->GetScalarPointer());
+  for (int t = 0; t < tilts; ++t) {
+    double theta = tiltAngles[t] * pi / 180;
+    for (int r = 0; r < Ny; ++r) {
+      for (int x = 0; x < Nx; ++x) {
+        double ray = r - Ny / 2 + shift -
+                     std::sin(-angle * pi / 180) * (x - Nx / 2);
+        double value = 0;
+        for (const Ball& ball : balls) {
+          double dx = x - ball.x;
+          double squared = ball.radius * ball.radius - dx * dx;
+          double distance =
+            ray - (ball.y * std::cos(theta) - ball.z * std::sin(theta));
+          if (distance * distance < squared) {
+            value +=
+              2 * ball.density * std::sqrt(squared - distance * distance);
+          }
+        }
+        data[(t * Ny + r) * Nx + x] = static_cast<float>(value);
+      }
+    }
+  }
+
+  TomographyTiltSeries::SinogramStack sinograms(tiltSeries.Get());
+  TiltAxisEstimator estimator(sinograms, tiltAngles);
+  ASSERT_EQ(estimator.slices().size(), 5u);
+  auto estimate = estimator.estimate();
+  // The slices are close to the axis, so the angle is only known to within
+  // some tenths of a degree. Check where the estimate puts the slices instead,
+  // to within half a ray.
+  for (int slice : estimator.slices()) {
+    ASSERT_NEAR(estimator.sliceShift(slice, estimate.shift, estimate.angle),
+                estimator.sliceShift(slice, shift, angle), 0.5);
+  }
+  ASSERT_GT(estimate.score, estimator.score(0, 0));
+}
@@ -0,0 +1,131 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+#include "TranslateAlignOperator.h"
+
+#include <cmath>
+
+using namespace tomviz;
+
+namespace {
+
+const int nx = 16;
+const int ny = 12;
+const int nz = 3;
+
+template <typename T>
+vtkSmartPointer<vtkImageData> createTiltSeries(int type)
+{
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(nx, ny, nz);
+  image->AllocateScalars(type, 1);
+  auto data = static_cast<T*>(image->GetScalarPointer());
+  for (int z = 0; z < nz; ++z) {
+    for (int y = 0; y < ny; ++y) {
+      for (int x = 0; x < nx; ++x) {
+        data[(z * ny + y) * nx + x] = static_cast<T>(1 + x + 3 * y + 50 * z);
+      }
+    }
+  }
+  return image;
+}
+
+// The value at (x, y) of the original image z, zero outside of the image.
+double original(int x, int y, int z)
+{
+  if (x < 0 || x >= nx || y < 0 || y >= ny) {
+    return 0.0;
+  }
+  return 1 + x + 3 * y + 50 * z;
+}
+}
+
+TEST(TranslateAlignOperatorTest, integer_offsets)
+{
+  auto image = createTiltSeries<float>(VTK_FLOAT);
+  QVector<vtkVector2f> offsets;
+  offsets << vtkVector2f(0, 0) << vtkVector2f(3, -2) << vtkVector2f(-5, 4);
+
+  TranslateAlignOperator op(nullptr);
+  op.setAlignOffsets(offsets);
+  ASSERT_EQ(op.transform(image), TransformResult::Complete);
+
+  auto data = static_cast<float*>(image->GetScalarPointer());
+  for (int z = 0; z < nz; ++z) {
+    int dx = static_cast<int>(offsets[z][0]);
+    int dy = static_cast<int>(offsets[z][1]);
+    for (int y = 0; y < ny; ++y) {
+      for (int x = 0; x < nx; ++x) {
+        ASSERT_FLOAT_EQ(data[(z * ny + y) * nx + x],
+                        original(x - dx, y - dy, z));
+      }
+    }
+  }
+}
+
+TEST(TranslateAlignOperatorTest, fractional_offsets)
+{
+  auto image = createTiltSeries<float>(VTK_FLOAT);
+  QVector<vtkVector2f> offsets;
+  offsets << vtkVector2f(0.5f, 0.25f) << vtkVector2f(-1.75f, 2.5f)
+          << vtkVector2f(2.25f, -0.5f);
+
+  TranslateAlignOperator op(nullptr);
+  op.setAlignOffsets(offsets);
+  ASSERT_EQ(op.transform(image), TransformResult::Complete);
+
+  auto data = static_cast<float*>(image->GetScalarPointer());
+  for (int z = 0; z < nz; ++z) {
+    double sx = -offsets[z][0];
+    double sy = -offsets[z][1];
+    int dx = static_cast<int>(std::floor(sx));
+    int dy = static_cast<int>(std::floor(sy));
+    double fx = sx - dx;
+    double fy = sy - dy;
+    for (int y = 0; y < ny; ++y) {
+      for (int x = 0; x < nx; ++x) {
+        double expected =
+          (1 - fx) * (1 - fy) * original(x + dx, y + dy, z) +
+          fx * (1 - fy) * original(x + dx + 1, y + dy, z) +
+          (1 - fx) * fy * original(x + dx, y + dy + 1, z) +
+          fx * fy * original(x + dx + 1, y + dy + 1, z);
+        ASSERT_NEAR(data[(z * ny + y) * nx + x], expected, 1e-4);
+      }
+    }
+  }
+}
+
+TEST(TranslateAlignOperatorTest, integer_scalars_are_rounded)
+{
+  auto image = createTiltSeries<unsigned char>(VTK_UNSIGNED_CHAR);
+  QVector<vtkVector2f> offsets;
+  offsets << vtkVector2f(0.5f, 0) << vtkVector2f(0, 0) << vtkVector2f(0, 0);
+
+  TranslateAlignOperator op(nullptr);
+  op.setAlignOffsets(offsets);
+  ASSERT_EQ(op.transform(image), TransformResult::Complete);
+
+  // Halfway between two neighbours that differ by one rounds up.
+  auto data = static_cast<unsigned char*>(image->GetScalarPointer());
+  EXPECT_EQ(data[0], 1);
+  EXPECT_EQ(data[1], 2);
+  EXPECT_EQ(data[nx - 1], 16);
+  EXPECT_EQ(data[nx * ny], 51);
+}
@@ -0,0 +1,104 @@
+"""Writes recon_dft.txt, the output of tomviz/python/Recon_DFT.py on a random
+tilt series, used by DirectFourierReconstructionTest. The script itself is
+run, with numpy based stand-ins for pyfftw and the tomviz modules.
+
+    python recon_dft.py > recon_dft.txt
+
+The file holds Nx, Ny and the number of projections, the tilt angles, the
+tilt series and then the reconstruction, x fastest.
+"""
+import os
+import sys
+import types
+
+# The operator.py fixture next to this script shadows the standard module.
+here = os.path.dirname(os.path.abspath(__file__))
+sys.path = [path for path in sys.path if os.path.abspath(path) != here]
+
+import numpy as np  # noqa
+
+# Removed from recent numpy versions.
+if not hasattr(np, 'int'):
+    np.int = int
+if not hasattr(np.lib, 'pad'):
+    np.lib.pad = np.pad
+
+
+class FFTW(object):
+
+    def __init__(self, input_array, output_array, direction='FFTW_FORWARD',
+                 axes=(-1,)):
+        self.direction = direction
+        self.axes = axes
+        self.update_arrays(input_array, output_array)
+
+    def update_arrays(self, input_array, output_array):
+        self.input_array = input_array
+        self.output_array = output_array
+
+    def __call__(self):
+        if self.direction == 'FFTW_FORWARD':
+            self.output_array[:] = np.fft.rfftn(self.input_array,
+                                                axes=self.axes)
+        else:
+            self.output_array[:] = np.fft.irfftn(
+                self.input_array, s=self.output_array.shape, axes=self.axes)
+
+
+def n_byte_align_empty(shape, n, dtype='float64', order='C'):
+    return np.empty(shape, dtype=dtype, order=order)
+
+
+class Progress(object):
+    maximum = 0
+    value = 0
+    message = ''
+
+
+class CancelableOperator(object):
+    canceled = False
+    progress = Progress()
+
+
+class Dataset(object):
+
+    def CopyStructure(self, other):
+        pass
+
+
+pyfftw = types.ModuleType('pyfftw')
+pyfftw.FFTW = FFTW
+pyfftw.n_byte_align_empty = n_byte_align_empty
+tomviz = types.ModuleType('tomviz')
+tomviz.operators = types.ModuleType('tomviz.operators')
+tomviz.operators.CancelableOperator = CancelableOperator
+tomviz.utils = types.ModuleType('tomviz.utils')
+tomviz.utils.get_tilt_angles = lambda dataset: dataset.angles
+tomviz.utils.get_array = lambda dataset: dataset.array
+tomviz.utils.set_array = lambda dataset, array: setattr(dataset, 'array',
+                                                        array)
+tomviz.utils.mark_as_volume = lambda dataset: None
+vtk = types.ModuleType('vtk')
+vtk.vtkImageData = Dataset
+sys.modules.update({'pyfftw': pyfftw, 'tomviz': tomviz,
+                    'tomviz.operators': tomviz.operators,
+                    'tomviz.utils': tomviz.utils, 'vtk': vtk})
+
+script = os.path.join(here, '..', '..', '..', 'tomviz', 'python',
+                      'Recon_DFT.py')
+namespace = {}
+with open(script) as f:
+    exec(compile(f.read(), script, 'exec'), namespace)
+
+(Nx, Ny, Nproj) = (4, 12, 9)
+np.random.seed(0)
+dataset = Dataset()
+dataset.angles = np.linspace(-80, 80, Nproj)
+dataset.array = np.asfortranarray(np.random.rand(Nx, Ny, Nproj))
+recon = namespace['ReconDFMOperator']().transform_scalars(dataset)
+recon = recon['reconstruction'].array
+
+print('%d %d %d' % (Nx, Ny, Nproj))
+for values in (dataset.angles, dataset.array.flatten(order='F'),
+               recon.flatten(order='F')):
+    print('\n'.join('%.17g' % value for value in values))
@@ -20,6 +20,10 @@
 
 #include "AcquisitionClient.h"
 #include "ActiveObjects.h"
+#include "DataSource.h"
+#include "LiveReconstruction.h"
+#include "LoadDataReaction.h"
+#include "PipelineScheduler.h"
 
 #include <pqApplicationCore.h>
 #include <pqSettings.h>
@@ -41,13 +45,56 @@
 #include <QDebug>
 #include <QDir>
 #include <QFile>
+#include <QRunnable>
+
+#include <algorithm>
+
+Q_DECLARE_METATYPE(vtkSmartPointer<vtkImageData>)
 
 namespace tomviz {
 
+namespace {
+
+/// Adds a projection to the live reconstruction on the PipelineScheduler, and
+/// reports the center slice to show. The slice is null if the projection
+/// could not be added.
+class LiveReconstructionJob : public QObject, public QRunnable
+{
+  Q_OBJECT
+
+public:
+  LiveReconstructionJob(QSharedPointer<LiveReconstruction> reconstruction,
+                        vtkImageData* projection, double angle)
+    : m_reconstruction(reconstruction), m_projection(projection),
+      m_angle(angle)
+  {
+  }
+
+  void run() override
+  {
+    vtkSmartPointer<vtkImageData> slice;
+    if (m_reconstruction->addProjection(m_projection, m_angle)) {
+      slice = m_reconstruction->centerSlice();
+    }
+    emit finished(slice, m_reconstruction->numberOfProjections());
+  }
+
+signals:
+  void finished(vtkSmartPointer<vtkImageData> slice, int count);
+
+private:
+  QSharedPointer<LiveReconstruction> m_reconstruction;
+  vtkSmartPointer<vtkImageData> m_projection;
+  double m_angle;
+};
+}
+
 AcquisitionWidget::AcquisitionWidget(QWidget* parent)
   : QWidget(parent), m_ui(new Ui::AcquisitionWidget),
-    m_client(new AcquisitionClient("http://localhost:8080/acquisition", this))
+    m_client(new AcquisitionClient("http://localhost:8080/acquisition", this)),
+    m_liveReconstruction(new LiveReconstruction)
 {
+  qRegisterMetaType<vtkSmartPointer<vtkImageData>>();
   m_ui->setupUi(this);
   this->setWindowFlags(Qt::Dialog);
 
@@ -64,6 +111,22 @@ AcquisitionWidget::AcquisitionWidget(QWidget* parent)
   m_renderer->SetBackground(1.0, 1.0, 1.0);
   m_renderer->SetViewport(0.0, 0.0, 1.0, 1.0);
 
+  m_ui->reconstructionWidget->GetRenderWindow()->AddRenderer(
+    m_reconstructionRenderer.Get());
+  m_ui->reconstructionWidget->GetInteractor()->SetInteractorStyle(
+    m_reconstructionInteractorStyle.Get());
+  m_reconstructionRenderer->SetBackground(1.0, 1.0, 1.0);
+  m_reconstructionSlice->GetProperty()->SetInterpolationTypeToNearest();
+  m_reconstructionSliceMapper->SetOrientationToX();
+  m_reconstructionSlice->SetMapper(m_reconstructionSliceMapper.Get());
+  m_ui->reconstructionWidget->hide();
+  connect(m_ui->liveReconstructionCheckBox, SIGNAL(toggled(bool)),
+          SLOT(setLiveReconstruction(bool)));
+  connect(m_ui->resetReconstructionButton, SIGNAL(clicked(bool)),
+          SLOT(resetLiveReconstruction()));
+  connect(m_ui->loadReconstructionButton, SIGNAL(clicked(bool)),
+          SLOT(loadLiveReconstruction()));
+
   readSettings();
 }
 
@@ -245,6 +308,10 @@ void AcquisitionWidget::previewReady(QString mimeType, QByteArray result)
     m_imageSlice->GetProperty()->SetLookupTable(m_lut.Get());
   }
 
+  if (m_ui->liveReconstructionCheckBox->isChecked()) {
+    addToLiveReconstruction(m_imageData, m_tiltAngle);
+  }
+
   m_ui->previewButton->setEnabled(true);
   m_ui->acquireButton->setEnabled(true);
 }
@@ -275,6 +342,108 @@ void AcquisitionWidget::resetCamera()
   camera->SetClippingRange(clippingRange);
 }
 
+void AcquisitionWidget::setLiveReconstruction(bool enable)
+{
+  m_ui->reconstructionWidget->setVisible(enable);
+  m_ui->resetReconstructionButton->setEnabled(enable);
+  m_ui->loadReconstructionButton->setEnabled(
+    enable && !m_reconstructing &&
+    m_liveReconstruction->numberOfProjections() > 0);
+}
+
+void AcquisitionWidget::resetLiveReconstruction()
+{
+  m_liveReconstruction.reset(new LiveReconstruction);
+  m_pendingProjections.clear();
+  m_reconstructionRenderer->RemoveViewProp(m_reconstructionSlice.Get());
+  m_ui->reconstructionWidget->GetRenderWindow()->Render();
+  m_ui->liveReconstructionCount->setText("0");
+  m_ui->loadReconstructionButton->setEnabled(false);
+}
+
+void AcquisitionWidget::loadLiveReconstruction()
+{
+  // The volume is being updated
+  if (m_reconstructing) {
+    return;
+  }
+  auto reconstruction = m_liveReconstruction->reconstruction();
+  if (!reconstruction) {
+    return;
+  }
+  auto dataSource = LoadDataReaction::createDataSource(reconstruction);
+  dataSource->setFilename("Live Reconstruction");
+  LoadDataReaction::dataSourceAdded(dataSource);
+}
+
+void AcquisitionWidget::addToLiveReconstruction(vtkImageData* projection,
+                                                double angle)
+{
+  m_pendingProjections.append(
+    qMakePair(vtkSmartPointer<vtkImageData>(projection), angle));
+  startLiveReconstruction();
+}
+
+void AcquisitionWidget::startLiveReconstruction()
+{
+  if (m_reconstructing || m_pendingProjections.isEmpty()) {
+    return;
+  }
+
+  auto next = m_pendingProjections.takeFirst();
+  QSharedPointer<LiveReconstruction> reconstruction = m_liveReconstruction;
+  auto job = new LiveReconstructionJob(reconstruction, next.first, next.second);
+  connect(
+    job, &LiveReconstructionJob::finished, this,
+    [this, reconstruction](vtkSmartPointer<vtkImageData> slice, int count) {
+      m_reconstructing = false;
+      // Nothing to show if the reconstruction was reset in the meantime
+      if (reconstruction == m_liveReconstruction) {
+        if (slice) {
+          updateLiveReconstruction(slice, count);
+        } else {
+          qDebug() << "The preview can't be added to the live reconstruction.";
+        }
+      }
+      startLiveReconstruction();
+      setLiveReconstruction(m_ui->liveReconstructionCheckBox->isChecked());
+    });
+  m_reconstructing = true;
+  m_ui->loadReconstructionButton->setEnabled(false);
+  PipelineScheduler::instance().submit(
+    job, nullptr, PipelineScheduler::Priority::Interactive);
+}
+
+void AcquisitionWidget::updateLiveReconstruction(vtkImageData* slice,
+                                                 int count)
+{
+  bool first =
+    !m_reconstructionRenderer->HasViewProp(m_reconstructionSlice.Get());
+  m_reconstructionSliceMapper->SetInputData(slice);
+  m_reconstructionSliceMapper->SetSliceNumber(0);
+  m_reconstructionSliceMapper->Update();
+
+  // The range grows with every projection
+  double range[2];
+  slice->GetScalarRange(range);
+  auto property = m_reconstructionSlice->GetProperty();
+  property->SetColorWindow(std::max(range[1] - range[0], 1e-12));
+  property->SetColorLevel(0.5 * (range[0] + range[1]));
+
+  if (first) {
+    // Look down the tilt axis
+    m_reconstructionRenderer->AddViewProp(m_reconstructionSlice.Get());
+    vtkCamera* camera = m_reconstructionRenderer->GetActiveCamera();
+    camera->SetFocalPoint(0.0, 0.0, 0.0);
+    camera->SetPosition(1.0, 0.0, 0.0);
+    camera->SetViewUp(0.0, 0.0, 1.0);
+    camera->ParallelProjectionOn();
+    m_reconstructionRenderer->ResetCamera();
+  }
+  m_ui->reconstructionWidget->GetRenderWindow()->Render();
+  m_ui->liveReconstructionCount->setText(QString::number(count));
+}
+
 void AcquisitionWidget::onError(const QString& errorMessage,
                                 const QJsonValue& errorData)
 {
@@ -282,3 +451,5 @@ void AcquisitionWidget::onError(const QString& errorMessage,
   qDebug() << errorData;
 }
 }
+
+#include "AcquisitionWidget.moc"
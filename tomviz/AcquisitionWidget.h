@@ -17,6 +17,9 @@
 #define tomvizAcquisitionWidget_h
 
 #include <QScopedPointer>
+#include <QList>
+#include <QPair>
+#include <QSharedPointer>
 #include <QWidget>
 
 #include <vtkNew.h>
@@ -37,6 +40,7 @@ class AcquisitionWidget;
 namespace tomviz {
 
 class AcquisitionClient;
+class LiveReconstruction;
 
 class AcquisitionWidget : public QWidget
 {
@@ -67,9 +71,22 @@ private slots:
   void previewReady(QString, QByteArray);
 
   void resetCamera();
+
+  void setLiveReconstruction(bool enable);
+  void resetLiveReconstruction();
+  void loadLiveReconstruction();
+
   void onError(const QString& errorMessage, const QJsonValue& errorData);
 
 private:
+  // Queue a projection for the live reconstruction.
+  void addToLiveReconstruction(vtkImageData* projection, double angle);
+  // Add the next queued projection on the PipelineScheduler, one at a time as
+  // they all update the same volume.
+  void startLiveReconstruction();
+  // Show the center slice of the live reconstruction, across the tilt axis.
+  void updateLiveReconstruction(vtkImageData* slice, int count);
+
   QScopedPointer<Ui::AcquisitionWidget> m_ui;
   QScopedPointer<AcquisitionClient> m_client;
 
@@ -80,6 +97,15 @@ private:
   vtkNew<vtkImageSliceMapper> m_imageSliceMapper;
   vtkSmartPointer<vtkScalarsToColors> m_lut;
 
+  // Replaced on reset, a job still running holds on to the previous one.
+  QSharedPointer<LiveReconstruction> m_liveReconstruction;
+  QList<QPair<vtkSmartPointer<vtkImageData>, double>> m_pendingProjections;
+  bool m_reconstructing = false;
+  vtkNew<vtkRenderer> m_reconstructionRenderer;
+  vtkNew<vtkInteractorStyleRubberBand2D> m_reconstructionInteractorStyle;
+  vtkNew<vtkImageSlice> m_reconstructionSlice;
+  vtkNew<vtkImageSliceMapper> m_reconstructionSliceMapper;
+
   double m_tiltAngle = 0.0;
   QString m_units = "unknown";
   double m_calX = 0.0;
@@ -18,6 +18,7 @@
 
 #include "ActiveObjects.h"
 #include "DataSource.h"
+#include "FramePrefetcher.h"
 #include "LoadDataReaction.h"
 #include "SpinBox.h"
 #include "TranslateAlignOperator.h"
@@ -49,6 +50,7 @@
 #include <vtkImageSliceMapper.h>
 #include <vtkInteractorStyleRubberBand2D.h>
 #include <vtkInteractorStyleRubberBandZoom.h>
+#include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkRenderWindow.h>
@@ -103,14 +105,14 @@ public:
   virtual ~ViewMode() {}
   virtual void addToView(vtkRenderer* renderer) = 0;
   virtual void removeFromView(vtkRenderer* renderer) = 0;
-  void currentSliceUpdated(int sliceNumber, vtkVector2i offset)
+  void currentSliceUpdated(int sliceNumber, vtkVector2f offset)
   {
     m_currentSlice = sliceNumber;
     m_currentSliceOffset[0] = offset[0];
     m_currentSliceOffset[1] = offset[1];
     update();
   }
-  void referenceSliceUpdated(int sliceNumber, vtkVector2i offset)
+  void referenceSliceUpdated(int sliceNumber, vtkVector2f offset)
   {
     m_referenceSlice = sliceNumber;
     m_referenceSliceOffset[0] = offset[0];
@@ -147,12 +149,14 @@ public:
 
       vtkSMTransferFunctionProxy::RescaleTransferFunction(getLUT(),
                                                           adjustedRange);
+      lookupTableModified();
     }
   }
   virtual void range(double r[2]) { m_originalData->GetScalarRange(r); }
 
   virtual void timeout() {}
   virtual void timerStopped() {}
+  virtual void lookupTableModified() {}
   virtual double* bounds() const = 0;
   virtual void update() = 0;
   virtual vtkSMProxy* getLUT() = 0;
@@ -160,67 +164,98 @@ public:
 protected:
   vtkSmartPointer<vtkImageData> m_originalData;
   int m_currentSlice = 1;
-  vtkVector2i m_currentSliceOffset;
+  vtkVector2f m_currentSliceOffset;
   int m_referenceSlice = 0;
-  vtkVector2i m_referenceSliceOffset;
+  vtkVector2f m_referenceSliceOffset;
 };
 
+// Alternates between the current and the reference image. Both images stay
+// on the GPU in their own actor, so playback only toggles their visibility.
+// They show the frames of the prefetcher once these are ready, and the slices
+// of the tilt series mapped through the color map until then.
 class ToggleSliceShownViewMode : public ViewMode
 {
 public:
-  ToggleSliceShownViewMode(vtkImageData* data, vtkSMProxy* lutProxy)
-    : ViewMode(data)
+  ToggleSliceShownViewMode(vtkImageData* data, vtkSMProxy* lutProxy,
+                           FramePrefetcher* frames)
+    : ViewMode(data), m_frames(frames)
   {
-    m_imageSlice->GetProperty()->SetInterpolationTypeToNearest();
-    m_imageSliceMapper->SetInputData(data);
-    m_imageSliceMapper->Update();
-    m_imageSlice->SetMapper(m_imageSliceMapper.Get());
     m_lut = lutProxy;
-    vtkScalarsToColors* dataLUT =
+    m_dataLUT =
       vtkScalarsToColors::SafeDownCast(lutProxy->GetClientSideObject());
-    if (dataLUT) {
-      m_imageSlice->GetProperty()->SetLookupTable(dataLUT);
+    for (Layer* layer : { &m_current, &m_reference }) {
+      layer->slice->GetProperty()->SetInterpolationTypeToNearest();
+      layer->mapper->SetInputData(data);
+      layer->mapper->Update();
+      layer->slice->SetMapper(layer->mapper.Get());
+      layer->slice->GetProperty()->SetLookupTable(m_dataLUT);
     }
   }
   void addToView(vtkRenderer* renderer) override
   {
-    renderer->AddViewProp(m_imageSlice.Get());
+    renderer->AddViewProp(m_current.slice.Get());
+    renderer->AddViewProp(m_reference.slice.Get());
   }
   void removeFromView(vtkRenderer* renderer) override
   {
-    renderer->RemoveViewProp(m_imageSlice.Get());
+    renderer->RemoveViewProp(m_current.slice.Get());
+    renderer->RemoveViewProp(m_reference.slice.Get());
   }
   void timeout() override
   {
     m_showingCurrentSlice = !m_showingCurrentSlice;
-    update();
+    showLayer();
   }
   void timerStopped() override
   {
     m_showingCurrentSlice = true;
     update();
   }
+  void lookupTableModified() override { update(); }
   void update() override
   {
-    if (m_showingCurrentSlice) {
-      m_imageSliceMapper->SetSliceNumber(m_currentSlice);
-      m_imageSliceMapper->Update();
-      m_imageSlice->SetPosition(m_currentSliceOffset[0],
-                                m_currentSliceOffset[1], 0);
-    } else // showing reference slice
-    {
-      m_imageSliceMapper->SetSliceNumber(m_referenceSlice);
-      m_imageSliceMapper->Update();
-      m_imageSlice->SetPosition(m_referenceSliceOffset[0],
-                                m_referenceSliceOffset[1], 0);
+    if (m_frames) {
+      m_frames->setLookupTable(m_dataLUT);
+      m_frames->setCurrent(m_currentSlice, QList<int>() << m_referenceSlice);
     }
+    show(m_current, m_currentSlice, m_currentSliceOffset);
+    show(m_reference, m_referenceSlice, m_referenceSliceOffset);
+    showLayer();
   }
-  double* bounds() const override { return m_imageSliceMapper->GetBounds(); }
+  double* bounds() const override { return m_current.mapper->GetBounds(); }
   vtkSMProxy* getLUT() override { return m_lut; }
 private:
-  vtkNew<vtkImageSlice> m_imageSlice;
-  vtkNew<vtkImageSliceMapper> m_imageSliceMapper;
+  struct Layer
+  {
+    vtkNew<vtkImageSlice> slice;
+    vtkNew<vtkImageSliceMapper> mapper;
+  };
+
+  void show(Layer& layer, int sliceNumber, const vtkVector2f& offset)
+  {
+    vtkImageData* frame = m_frames ? m_frames->frame(sliceNumber) : nullptr;
+    vtkImageData* input = frame ? frame : m_originalData.GetPointer();
+    if (layer.mapper->GetInput() != input) {
+      layer.mapper->SetInputData(input);
+    }
+    // The frames already hold colors.
+    layer.slice->GetProperty()->SetLookupTable(frame ? nullptr : m_dataLUT);
+    layer.mapper->SetSliceNumber(sliceNumber);
+    layer.mapper->Update();
+    layer.slice->SetPosition(offset[0], offset[1], 0);
+  }
+
+  void showLayer()
+  {
+    m_current.slice->SetVisibility(m_showingCurrentSlice);
+    m_reference.slice->SetVisibility(!m_showingCurrentSlice);
+  }
+
+  Layer m_current;
+  Layer m_reference;
+  QPointer<FramePrefetcher> m_frames;
   vtkSmartPointer<vtkSMProxy> m_lut;
+  vtkScalarsToColors* m_dataLUT;
   bool m_showingCurrentSlice = false;
 };
 
@@ -305,23 +340,25 @@ public:
     vtkDataArrayAccessor<InputArray> in(input);
     vtkDataArrayAccessor<OutputArray> out(output);
 
+    // The difference is shown at whole pixel offsets.
+    vtkVector2i current(vtkMath::Round(m_currentSliceOffset[0]),
+                        vtkMath::Round(m_currentSliceOffset[1]));
+    vtkVector2i reference(vtkMath::Round(m_referenceSliceOffset[0]),
+                          vtkMath::Round(m_referenceSliceOffset[1]));
     for (vtkIdType j = 0; j < m_ySize; ++j) {
       for (vtkIdType i = 0; i < m_xSize; ++i) {
         vtkIdType destIdx = j * m_xSize + i;
-        if (j - m_currentSliceOffset[1] < m_ySize &&
-            j - m_currentSliceOffset[1] >= 0 &&
-            i - m_currentSliceOffset[0] < m_xSize &&
-            i - m_currentSliceOffset[0] >= 0) {
+        if (j - current[1] < m_ySize && j - current[1] >= 0 &&
+            i - current[0] < m_xSize && i - current[0] >= 0) {
           // Index of the point in the current slice that corresponds to the
           // given position
           vtkIdType currentSliceIdx = m_currentSlice * m_ySize * m_xSize +
-                                      (j - m_currentSliceOffset[1]) * m_xSize +
-                                      (i - m_currentSliceOffset[0]);
+                                      (j - current[1]) * m_xSize +
+                                      (i - current[0]);
           // Index in the reference slice that corresponds to the given position
-          vtkIdType referenceSliceIdx =
-            m_referenceSlice * m_ySize * m_xSize +
-            (j - m_referenceSliceOffset[1]) * m_xSize +
-            (i - m_referenceSliceOffset[0]);
+          vtkIdType referenceSliceIdx = m_referenceSlice * m_ySize * m_xSize +
+                                        (j - reference[1]) * m_xSize +
+                                        (i - reference[0]);
           // Compute the difference and set it to the output at the position
           out.Set(destIdx, 0,
                   in.Get(currentSliceIdx, 0) - in.Get(referenceSliceIdx, 0));
@@ -371,7 +408,10 @@ AlignWidget::AlignWidget(TranslateAlignOperator* op,
 
   // Set up the rendering pipeline
   if (imageData) {
-    m_modes.push_back(new ToggleSliceShownViewMode(imageData, lut));
+    m_frames = new FramePrefetcher(imageData, m_unalignedData, this);
+    connect(m_frames, &FramePrefetcher::frameReady, this,
+            &AlignWidget::frameReady);
+    m_modes.push_back(new ToggleSliceShownViewMode(imageData, lut, m_frames));
     m_modes.push_back(new ShowDifferenceImageMode(imageData));
     m_modes[0]->addToView(m_renderer.Get());
     m_modes[0]->update();
@@ -561,9 +601,9 @@ AlignWidget::AlignWidget(TranslateAlignOperator* op,
   m_offsetTable = new QTableWidget(this);
   m_offsetTable->verticalHeader()->setVisible(false);
   v->addWidget(m_offsetTable, 2);
-  m_offsets.fill(vtkVector2i(0, 0), m_maxSliceNum + 1);
+  m_offsets.fill(vtkVector2f(0, 0), m_maxSliceNum + 1);
 
-  const QVector<vtkVector2i>& oldOffsets = m_operator->getAlignOffsets();
+  const QVector<vtkVector2f>& oldOffsets = m_operator->getAlignOffsets();
 
   m_offsetTable->setRowCount(m_offsets.size());
   m_offsetTable->setColumnCount(4);
@@ -751,7 +791,7 @@ void AlignWidget::setFrameRate(int rate)
 
 void AlignWidget::widgetKeyPress(QKeyEvent* key)
 {
-  vtkVector2i& offset = m_offsets[m_currentSlice->value()];
+  vtkVector2f& offset = m_offsets[m_currentSlice->value()];
   bool updateTable = false;
   switch (key->key()) {
     case Qt::Key_Left:
@@ -811,7 +851,7 @@ void AlignWidget::changeMode(int mode)
 
 void AlignWidget::applySliceOffset(int sliceNumber)
 {
-  vtkVector2i offset(0, 0);
+  vtkVector2f offset(0, 0);
   if (sliceNumber == -1) {
     sliceNumber = m_currentSlice->value();
     offset = m_offsets[m_currentSlice->value()];
@@ -914,7 +954,7 @@ void AlignWidget::sliceOffsetEdited(int slice, int offsetComponent)
   QTableWidgetItem* item = m_offsetTable->item(slice, offsetComponent);
   QString str = item->data(Qt::DisplayRole).toString();
   bool ok;
-  int offset = str.toInt(&ok);
+  float offset = str.toFloat(&ok);
   if (ok) {
     m_offsets[slice][offsetComponent - 1] = offset;
   }
@@ -984,8 +1024,20 @@ void AlignWidget::applyCurrentPreset()
         vtkSMTransferFunctionProxy::RescaleTransferFunction(lut, range);
       }
     }
+    m_modes[m_currentMode]->lookupTableModified();
     renderViews();
     m_widget->GetRenderWindow()->Render();
   }
 }
+
+void AlignWidget::frameReady(int slice)
+{
+  // Only the "Toggle Images" mode shows the frames.
+  if (m_modes.length() == 0 || m_currentMode != 0 ||
+      (slice != m_currentSlice->value() && slice != m_referenceSlice)) {
+    return;
+  }
+  m_modes[m_currentMode]->update();
+  m_widget->GetRenderWindow()->Render();
+}
 }
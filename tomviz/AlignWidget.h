@@ -45,6 +45,7 @@ class vtkRenderer;
 namespace tomviz {
 
 class DataSource;
+class FramePrefetcher;
 class SpinBox;
 class TranslateAlignOperator;
 class ViewMode;
@@ -91,6 +92,8 @@ protected slots:
 
   void sliceOffsetEdited(int slice, int offsetComponent);
 
+  void frameReady(int slice);
+
 protected:
   vtkNew<vtkRenderer> m_renderer;
   vtkNew<vtkInteractorStyleRubberBand2D> m_defaultInteractorStyle;
@@ -119,9 +122,10 @@ protected:
   int m_minSliceNum = 0;
 
   QVector<ViewMode*> m_modes;
+  FramePrefetcher* m_frames = nullptr;
   int m_currentMode = 0;
 
-  QVector<vtkVector2i> m_offsets;
+  QVector<vtkVector2f> m_offsets;
   QPointer<TranslateAlignOperator> m_operator;
   DataSource* m_unalignedData;
 };
@@ -0,0 +1,216 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "BackProjectionKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TOMVIZ_HAVE_NEON_KERNEL
+#endif
+
+#if defined(TOMVIZ_HAVE_AVX2_KERNEL) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace tomviz {
+
+namespace BackProjectionKernels {
+
+InstructionSet best()
+{
+  static const InstructionSet instructionSet = []() {
+    if (isSupported(InstructionSet::AVX2)) {
+      return InstructionSet::AVX2;
+    }
+    if (isSupported(InstructionSet::NEON)) {
+      return InstructionSet::NEON;
+    }
+    return InstructionSet::Scalar;
+  }();
+  return instructionSet;
+}
+
+bool isSupported(InstructionSet instructionSet)
+{
+  switch (instructionSet) {
+    case InstructionSet::Scalar:
+      return true;
+    case InstructionSet::AVX2:
+#if defined(TOMVIZ_HAVE_AVX2_KERNEL) && defined(_MSC_VER)
+    {
+      // AVX2 and FMA, and the OS saving the YMM registers.
+      int info[4];
+      __cpuid(info, 1);
+      bool fma = (info[2] & (1 << 12)) != 0;
+      bool osxsave = (info[2] & (1 << 27)) != 0;
+      bool avx = (info[2] & (1 << 28)) != 0;
+      if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+      }
+      __cpuidex(info, 7, 0);
+      return (info[1] & (1 << 5)) != 0;
+    }
+#elif defined(TOMVIZ_HAVE_AVX2_KERNEL)
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+      return false;
+#endif
+    case InstructionSet::NEON:
+#if defined(TOMVIZ_HAVE_NEON_KERNEL)
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+void backProject(const float* sinogram, const float* cosines,
+                 const float* sines, float* image, int numOfTilts,
+                 int numOfRays, InstructionSet instructionSet)
+{
+  if (numOfRays < 2) {
+    std::fill(image, image + numOfRays * numOfRays, 0.0f);
+    return;
+  }
+
+  switch (instructionSet) {
+    case InstructionSet::AVX2:
+      backProjectAVX2(sinogram, cosines, sines, image, numOfTilts, numOfRays);
+      break;
+    case InstructionSet::NEON:
+      backProjectNEON(sinogram, cosines, sines, image, numOfTilts, numOfRays);
+      break;
+    case InstructionSet::Scalar:
+      backProjectScalar(sinogram, cosines, sines, image, numOfTilts,
+                        numOfRays);
+      break;
+  }
+}
+
+// Every kernel walks the image row by row so the row being accumulated stays
+// in cache, and for each tilt computes the position p of the pixels on the
+// projection, p = t + numOfRays / 2 with t the ray coordinate. Along a row p
+// grows by the sine of the tilt angle, it is computed as start + iz * step
+// rather than accumulated to not lose precision on large images. Only
+// 0 <= p < numOfRays - 1 contributes, linearly interpolated between the rays
+// floor(p) and floor(p) + 1.
+void backProjectScalar(const float* sinogram, const float* cosines,
+                       const float* sines, float* image, int numOfTilts,
+                       int numOfRays)
+{
+  const float center = 0.5f - numOfRays / 2.0f;
+  const float last = static_cast<float>(numOfRays - 1);
+  std::fill(image, image + numOfRays * numOfRays, 0.0f);
+  for (int iy = 0; iy < numOfRays; ++iy) {
+    float* row = image + iy * numOfRays;
+    float y = iy + center;
+    for (int tt = 0; tt < numOfTilts; ++tt) {
+      const float* projection = sinogram + tt * numOfRays;
+      float step = sines[tt];
+      float start = y * cosines[tt] + center * step + numOfRays / 2;
+      for (int iz = 0; iz < numOfRays; ++iz) {
+        float p = start + iz * step;
+        bool inside = p >= 0.0f && p < last;
+        int index = std::min(std::max(static_cast<int>(p), 0), numOfRays - 2);
+        float weight = p - index;
+        float q1 = projection[index];
+        float q2 = projection[index + 1];
+        row[iz] += inside ? q1 + weight * (q2 - q1) : 0.0f;
+      }
+    }
+  }
+}
+
+#if !defined(TOMVIZ_HAVE_AVX2_KERNEL)
+void backProjectAVX2(const float* sinogram, const float* cosines,
+                     const float* sines, float* image, int numOfTilts,
+                     int numOfRays)
+{
+  backProjectScalar(sinogram, cosines, sines, image, numOfTilts, numOfRays);
+}
+#endif
+
+#if defined(TOMVIZ_HAVE_NEON_KERNEL)
+void backProjectNEON(const float* sinogram, const float* cosines,
+                     const float* sines, float* image, int numOfTilts,
+                     int numOfRays)
+{
+  const float center = 0.5f - numOfRays / 2.0f;
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t last = vdupq_n_f32(static_cast<float>(numOfRays - 1));
+  const int32x4_t maxIndex = vdupq_n_s32(numOfRays - 2);
+  const float lanes[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+  const float32x4_t lane = vld1q_f32(lanes);
+  const float32x4_t four = vdupq_n_f32(4.0f);
+  const int vectorEnd = numOfRays - numOfRays % 4;
+  std::fill(image, image + numOfRays * numOfRays, 0.0f);
+  for (int iy = 0; iy < numOfRays; ++iy) {
+    float* row = image + iy * numOfRays;
+    float y = iy + center;
+    for (int tt = 0; tt < numOfTilts; ++tt) {
+      const float* projection = sinogram + tt * numOfRays;
+      float step = sines[tt];
+      float start = y * cosines[tt] + center * step + numOfRays / 2;
+      const float32x4_t first = vdupq_n_f32(start);
+      float32x4_t zs = lane;
+      int iz = 0;
+      for (; iz < vectorEnd; iz += 4, zs = vaddq_f32(zs, four)) {
+        float32x4_t p = vmlaq_n_f32(first, zs, step);
+        uint32x4_t inside = vandq_u32(vcgeq_f32(p, zero), vcltq_f32(p, last));
+        int32x4_t index =
+          vminq_s32(vmaxq_s32(vcvtq_s32_f32(p), vdupq_n_s32(0)), maxIndex);
+        float32x4_t weight = vsubq_f32(p, vcvtq_f32_s32(index));
+        // No gather instruction, load the lanes one by one.
+        int indices[4];
+        vst1q_s32(indices, index);
+        float q1s[4], q2s[4];
+        for (int l = 0; l < 4; ++l) {
+          q1s[l] = projection[indices[l]];
+          q2s[l] = projection[indices[l] + 1];
+        }
+        float32x4_t q1 = vld1q_f32(q1s);
+        float32x4_t q2 = vld1q_f32(q2s);
+        float32x4_t value = vmlaq_f32(q1, weight, vsubq_f32(q2, q1));
+        value = vreinterpretq_f32_u32(
+          vandq_u32(vreinterpretq_u32_f32(value), inside));
+        vst1q_f32(row + iz, vaddq_f32(vld1q_f32(row + iz), value));
+      }
+      for (; iz < numOfRays; ++iz) {
+        float tail = start + iz * step;
+        bool in = tail >= 0.0f && tail < numOfRays - 1;
+        int index =
+          std::min(std::max(static_cast<int>(tail), 0), numOfRays - 2);
+        float weight = tail - index;
+        float q1 = projection[index];
+        float q2 = projection[index + 1];
+        row[iz] += in ? q1 + weight * (q2 - q1) : 0.0f;
+      }
+    }
+  }
+}
+#else
+void backProjectNEON(const float* sinogram, const float* cosines,
+                     const float* sines, float* image, int numOfTilts,
+                     int numOfRays)
+{
+  backProjectScalar(sinogram, cosines, sines, image, numOfTilts, numOfRays);
+}
+#endif
+}
+}
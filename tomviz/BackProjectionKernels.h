@@ -0,0 +1,61 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizBackProjectionKernels_h
+#define tomvizBackProjectionKernels_h
+
+namespace tomviz {
+
+/// The inner loops of TomographyReconstruction::unweightedBackProjection2, in
+/// single precision, with a SIMD version per instruction set. The cosine and
+/// sine of each tilt angle are precomputed so that the ray coordinate of a
+/// pixel is an increment of its neighbor's, and rays falling outside of the
+/// projection are masked out instead of branched over.
+namespace BackProjectionKernels {
+
+enum class InstructionSet
+{
+  Scalar,
+  AVX2,
+  NEON
+};
+
+/// The fastest instruction set supported by the build and the CPU.
+InstructionSet best();
+
+/// Returns true if the kernel for the instruction set can run here.
+bool isSupported(InstructionSet instructionSet);
+
+/// Back project the sinogram (numOfTilts rows of numOfRays) into the
+/// numOfRays by numOfRays image, see unweightedBackProjection2. The image is
+/// overwritten and not normalized.
+void backProject(const float* sinogram, const float* cosines,
+                 const float* sines, float* image, int numOfTilts,
+                 int numOfRays, InstructionSet instructionSet = best());
+
+// The kernels, only call the ones for which isSupported() is true.
+void backProjectScalar(const float* sinogram, const float* cosines,
+                       const float* sines, float* image, int numOfTilts,
+                       int numOfRays);
+void backProjectAVX2(const float* sinogram, const float* cosines,
+                     const float* sines, float* image, int numOfTilts,
+                     int numOfRays);
+void backProjectNEON(const float* sinogram, const float* cosines,
+                     const float* sines, float* image, int numOfTilts,
+                     int numOfRays);
+}
+}
+
+#endif
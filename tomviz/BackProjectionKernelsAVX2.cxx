@@ -0,0 +1,77 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+// Compiled with AVX2 and FMA enabled, only called when the CPU supports them.
+#include "BackProjectionKernels.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+
+namespace tomviz {
+
+namespace BackProjectionKernels {
+
+void backProjectAVX2(const float* sinogram, const float* cosines,
+                     const float* sines, float* image, int numOfTilts,
+                     int numOfRays)
+{
+  const float center = 0.5f - numOfRays / 2.0f;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 last = _mm256_set1_ps(static_cast<float>(numOfRays - 1));
+  const __m256i minIndex = _mm256_setzero_si256();
+  const __m256i maxIndex = _mm256_set1_epi32(numOfRays - 2);
+  const __m256 eight = _mm256_set1_ps(8.0f);
+  const int vectorEnd = numOfRays - numOfRays % 8;
+  std::fill(image, image + numOfRays * numOfRays, 0.0f);
+  for (int iy = 0; iy < numOfRays; ++iy) {
+    float* row = image + iy * numOfRays;
+    float y = iy + center;
+    for (int tt = 0; tt < numOfTilts; ++tt) {
+      const float* projection = sinogram + tt * numOfRays;
+      float step = sines[tt];
+      float start = y * cosines[tt] + center * step + numOfRays / 2;
+      const __m256 first = _mm256_set1_ps(start);
+      const __m256 steps = _mm256_set1_ps(step);
+      __m256 zs = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+      int iz = 0;
+      for (; iz < vectorEnd; iz += 8, zs = _mm256_add_ps(zs, eight)) {
+        __m256 p = _mm256_fmadd_ps(zs, steps, first);
+        __m256 inside = _mm256_and_ps(_mm256_cmp_ps(p, zero, _CMP_GE_OQ),
+                                      _mm256_cmp_ps(p, last, _CMP_LT_OQ));
+        __m256i index = _mm256_min_epi32(
+          _mm256_max_epi32(_mm256_cvttps_epi32(p), minIndex), maxIndex);
+        __m256 weight = _mm256_sub_ps(p, _mm256_cvtepi32_ps(index));
+        __m256 q1 = _mm256_i32gather_ps(projection, index, 4);
+        __m256 q2 = _mm256_i32gather_ps(projection + 1, index, 4);
+        __m256 value = _mm256_fmadd_ps(weight, _mm256_sub_ps(q2, q1), q1);
+        value = _mm256_and_ps(value, inside);
+        _mm256_storeu_ps(row + iz,
+                         _mm256_add_ps(_mm256_loadu_ps(row + iz), value));
+      }
+      for (; iz < numOfRays; ++iz) {
+        float p = start + iz * step;
+        bool in = p >= 0.0f && p < numOfRays - 1;
+        int index = std::min(std::max(static_cast<int>(p), 0), numOfRays - 2);
+        float weight = p - index;
+        float q1 = projection[index];
+        float q2 = projection[index + 1];
+        row[iz] += in ? q1 + weight * (q2 - q1) : 0.0f;
+      }
+    }
+  }
+}
+}
+}
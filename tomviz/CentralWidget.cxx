@@ -62,8 +62,16 @@ void PopulateHistogram(vtkImageData* input, vtkTable* output)
   // over the input image data by incrementing the reference count here.
   vtkSmartPointer<vtkDataArray> arrayPtr = input->GetPointData()->GetScalars();
 
-  // The bin values are the centers, extending +/- half an inc either side
-  arrayPtr->GetFiniteRange(minmax, -1);
+  // The bin values are the centers, extending +/- half an inc either side.
+  // The range is the first pass over the same blocks as the histogram.
+  void* values = arrayPtr->GetVoidPointer(0);
+  vtkIdType numTuples = arrayPtr->GetNumberOfTuples();
+  int numComp = arrayPtr->GetNumberOfComponents();
+  switch (arrayPtr->GetDataType()) {
+    vtkTemplateMacro(tomviz::CalculateFiniteRange(
+      reinterpret_cast<VTK_TT*>(values), numTuples, numComp, -1 /* Magnitude */,
+      minmax));
+  }
   if (minmax[0] == minmax[1]) {
     minmax[1] = minmax[0] + 1.0;
   }
@@ -96,9 +104,8 @@ void PopulateHistogram(vtkImageData* input, vtkTable* output)
 
   switch (arrayPtr->GetDataType()) {
     vtkTemplateMacro(tomviz::CalculateHistogram(
-      reinterpret_cast<VTK_TT*>(arrayPtr->GetVoidPointer(0)),
-      arrayPtr->GetNumberOfTuples(), arrayPtr->GetNumberOfComponents(),
-      -1 /* Magnitude */, minmax[0], pops, inc, numberOfBins, invalid));
+      reinterpret_cast<VTK_TT*>(values), numTuples, numComp, -1 /* Magnitude */,
+      minmax[0], pops, inc, numberOfBins, invalid));
     default:
       cout << "UpdateFromFile: Unknown data type" << endl;
   }
@@ -127,7 +134,12 @@ void Populate2DHistogram(vtkImageData* input, vtkImageData* output)
   vtkSmartPointer<vtkDataArray> arrayPtr = input->GetPointData()->GetScalars();
 
   // The bin values are the centers, extending +/- half an inc either side
-  arrayPtr->GetFiniteRange(minmax, -1);
+  switch (arrayPtr->GetDataType()) {
+    vtkTemplateMacro(tomviz::CalculateFiniteRange(
+      reinterpret_cast<VTK_TT*>(arrayPtr->GetVoidPointer(0)),
+      arrayPtr->GetNumberOfTuples(), arrayPtr->GetNumberOfComponents(),
+      -1 /* Magnitude */, minmax));
+  }
   if (minmax[0] == minmax[1]) {
     minmax[1] = minmax[0] + 1.0;
   }
@@ -0,0 +1,159 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "CheckpointCache.h"
+
+#include "Utilities.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkImageData.h>
+
+#include <QMutexLocker>
+
+namespace tomviz {
+
+CheckpointCache::CheckpointCache() : m_budget(defaultBudget())
+{
+}
+
+void CheckpointCache::setBudget(qint64 bytes)
+{
+  QMutexLocker locker(&m_mutex);
+  m_budget = qMax(bytes, static_cast<qint64>(0));
+  makeRoom(0);
+}
+
+qint64 CheckpointCache::budget() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_budget;
+}
+
+qint64 CheckpointCache::size() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_size;
+}
+
+int CheckpointCache::generation() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_generation;
+}
+
+bool CheckpointCache::insert(Operator* op, vtkImageData* data, int generation)
+{
+  if (!op || !data) {
+    return false;
+  }
+
+  // GetActualMemorySize() is in kibibytes.
+  qint64 bytes = static_cast<qint64>(data->GetActualMemorySize()) * 1024;
+  {
+    QMutexLocker locker(&m_mutex);
+    if (generation != m_generation || bytes > m_budget) {
+      return false;
+    }
+  }
+
+  // The checkpoint shares its arrays with data, the pipeline detaches them
+  // before an operator writes to them.
+  vtkSmartPointer<vtkImageData> copy = vtkSmartPointer<vtkImageData>::New();
+  copyOnWrite(data, copy);
+
+  QMutexLocker locker(&m_mutex);
+  // The pipeline may have been modified while we were copying.
+  if (generation != m_generation) {
+    return false;
+  }
+  if (m_entries.contains(op)) {
+    m_size -= m_entries[op].bytes;
+    m_entries.remove(op);
+  }
+  makeRoom(bytes);
+
+  Entry entry;
+  entry.data = copy;
+  entry.bytes = bytes;
+  entry.lastUsed = ++m_clock;
+  m_entries[op] = entry;
+  m_size += bytes;
+
+  return true;
+}
+
+vtkSmartPointer<vtkImageData> CheckpointCache::find(Operator* op)
+{
+  QMutexLocker locker(&m_mutex);
+  auto itr = m_entries.find(op);
+  if (itr == m_entries.end()) {
+    return nullptr;
+  }
+  itr->lastUsed = ++m_clock;
+
+  return itr->data;
+}
+
+void CheckpointCache::invalidate(const QList<Operator*>& ops)
+{
+  QMutexLocker locker(&m_mutex);
+  ++m_generation;
+  foreach (Operator* op, ops) {
+    auto itr = m_entries.find(op);
+    if (itr != m_entries.end()) {
+      m_size -= itr->bytes;
+      m_entries.erase(itr);
+    }
+  }
+}
+
+void CheckpointCache::clear()
+{
+  QMutexLocker locker(&m_mutex);
+  ++m_generation;
+  m_entries.clear();
+  m_size = 0;
+}
+
+qint64 CheckpointCache::defaultBudget()
+{
+  // In megabytes
+  int budget = 2048;
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    budget = core->settings()
+               ->value("tomviz/pipeline/CheckpointCacheSize", budget)
+               .toInt();
+  }
+
+  return static_cast<qint64>(budget) * 1024 * 1024;
+}
+
+void CheckpointCache::makeRoom(qint64 bytes)
+{
+  while (!m_entries.isEmpty() && m_size + bytes > m_budget) {
+    auto lru = m_entries.begin();
+    for (auto itr = m_entries.begin(); itr != m_entries.end(); ++itr) {
+      if (itr->lastUsed < lru->lastUsed) {
+        lru = itr;
+      }
+    }
+    m_size -= lru->bytes;
+    m_entries.erase(lru);
+  }
+}
+}
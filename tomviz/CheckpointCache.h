@@ -0,0 +1,102 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizCheckpointCache_h
+#define tomvizCheckpointCache_h
+
+#include <QList>
+#include <QMap>
+#include <QMutex>
+
+#include <vtkSmartPointer.h>
+
+class vtkImageData;
+
+namespace tomviz {
+
+class Operator;
+
+/// Memory budgeted store of intermediate pipeline results. When an operator
+/// completes, the PipelineWorker records a copy of its output keyed by the
+/// operator (the "checkpoint" for that operator). When a downstream operator is
+/// modified the DataSource restarts the pipeline from the nearest valid
+/// checkpoint upstream of it rather than from the original data. Entries are
+/// evicted least recently used first once the budget is exceeded.
+///
+/// The cache is filled from the worker threads and queried from the UI thread,
+/// all methods are thread safe.
+class CheckpointCache
+{
+public:
+  /// The budget is initialized from the application settings, see
+  /// defaultBudget().
+  CheckpointCache();
+
+  /// Set the memory budget in bytes, entries are evicted until the cache fits.
+  /// A budget of zero disables checkpointing.
+  void setBudget(qint64 bytes);
+  qint64 budget() const;
+
+  /// Returns the number of bytes currently held by the cache.
+  qint64 size() const;
+
+  /// Returns the current generation of the cache. Every invalidation bumps the
+  /// generation, a pipeline run captures it when it starts so that results
+  /// computed from now stale parameters are rejected by insert().
+  int generation() const;
+
+  /// Record a copy of data as the checkpoint for op, the copy shares its
+  /// arrays with data (see copyOnWrite()). Returns false if the data was
+  /// rejected, because it doesn't fit the budget or because the cache has been
+  /// invalidated since the given generation.
+  bool insert(Operator* op, vtkImageData* data, int generation);
+
+  /// Returns the checkpoint for op, or nullptr if there is none. The caller
+  /// must not modify the returned data, copy it first.
+  vtkSmartPointer<vtkImageData> find(Operator* op);
+
+  /// Drop the checkpoints for the given operators.
+  void invalidate(const QList<Operator*>& ops);
+
+  /// Drop all checkpoints.
+  void clear();
+
+  /// The budget configured in the application settings, in bytes.
+  static qint64 defaultBudget();
+
+private:
+  Q_DISABLE_COPY(CheckpointCache)
+
+  struct Entry
+  {
+    vtkSmartPointer<vtkImageData> data;
+    qint64 bytes = 0;
+    quint64 lastUsed = 0;
+  };
+
+  // Evict least recently used entries until bytes more fit in the budget.
+  // Must be called with m_mutex locked.
+  void makeRoom(qint64 bytes);
+
+  mutable QMutex m_mutex;
+  QMap<Operator*, Entry> m_entries;
+  qint64 m_budget = 0;
+  qint64 m_size = 0;
+  quint64 m_clock = 0;
+  int m_generation = 0;
+};
+}
+
+#endif
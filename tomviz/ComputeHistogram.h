@@ -4,9 +4,120 @@
 #include <vtkMath.h>
 #include <vtkDoubleArray.h>
 #include <vtkImageData.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace tomviz {
 
+/// The number of tuples in a block of the parallel passes over the values,
+/// a block of float values fits in the L2 cache.
+const vtkIdType HistogramBlockSize = 65536;
+
+/// Returns true if value is neither NaN nor infinite, integers always are.
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+IsFiniteValue(T)
+{
+  return true;
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_integral<T>::value, bool>::type
+IsFiniteValue(T value)
+{
+  return std::isfinite(value);
+}
+
+/// Computes the L2 norm of a tuple, returns false if a component is not
+/// finite.
+template <typename T>
+inline bool TupleMagnitude(const T* tuple, vtkIdType numComponents,
+                           double& magnitude)
+{
+  double squaredSum = 0.0;
+  for (vtkIdType c = 0; c < numComponents; ++c) {
+    T value = tuple[c];
+    if (!IsFiniteValue(value)) {
+      return false;
+    }
+    squaredSum += static_cast<double>(value) * value;
+  }
+  magnitude = std::sqrt(squaredSum);
+  return true;
+}
+
+/// Returns the bin of a value known to be in the histogram range.
+inline int HistogramBin(double value, double min, double invInc, int maxBin)
+{
+  int index = static_cast<int>((value - min) * invInc);
+  return std::min(std::max(index, 0), maxBin);
+}
+
+/**
+ * Computes the range of the finite values of an array, in parallel over
+ * blocks of HistogramBlockSize tuples. It is the first pass of a histogram,
+ * CalculateHistogram() then bins the same blocks.
+ * \param component The component to use, -1 for the L2 norm of each tuple.
+ * \return false if the array has no finite value, range is then untouched.
+ */
+template <typename T>
+bool CalculateFiniteRange(const T* values, const vtkIdType numTuples,
+                          const vtkIdType numComponents, int component,
+                          double range[2])
+{
+  if (component == -1 && numComponents == 1) {
+    component = 0;
+  }
+
+  struct Range
+  {
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+  };
+  vtkSMPThreadLocal<Range> ranges;
+  vtkSMPTools::For(0, numTuples, HistogramBlockSize, [&](vtkIdType begin,
+                                                         vtkIdType end) {
+    Range& local = ranges.Local();
+    const T* tuple = values + begin * numComponents;
+    if (component >= 0) {
+      tuple += component;
+      for (vtkIdType j = begin; j < end; ++j, tuple += numComponents) {
+        T value = *tuple;
+        if (IsFiniteValue(value)) {
+          local.min = std::min(local.min, static_cast<double>(value));
+          local.max = std::max(local.max, static_cast<double>(value));
+        }
+      }
+    } else {
+      for (vtkIdType j = begin; j < end; ++j, tuple += numComponents) {
+        double magnitude;
+        if (TupleMagnitude(tuple, numComponents, magnitude)) {
+          local.min = std::min(local.min, magnitude);
+          local.max = std::max(local.max, magnitude);
+        }
+      }
+    }
+  });
+
+  Range merged;
+  for (const Range& local : ranges) {
+    merged.min = std::min(merged.min, local.min);
+    merged.max = std::max(merged.max, local.max);
+  }
+  if (merged.min > merged.max) {
+    return false;
+  }
+  range[0] = merged.min;
+  range[1] = merged.max;
+  return true;
+}
+
 /**
  * Computes a histogram from an array of values.
  * \param values The array from which to compute the histogram.
@@ -18,6 +129,9 @@ namespace tomviz {
  * \param inc Bin size, numBins is the number of bins
  * in the histogram (or length of the pops array), and invalid is a return
  * parameter indicating how many values in the array had a non-finite value.
+ *
+ * The blocks of HistogramBlockSize tuples are binned in parallel, each thread
+ * counting into its own bins that are added to pops at the end.
  */
 template <typename T>
 void CalculateHistogram(T* values, const vtkIdType numTuples,
@@ -26,6 +140,7 @@ void CalculateHistogram(T* values, const vtkIdType numTuples,
                         const int numBins, int& invalid)
 {
   const int maxBin(numBins - 1);
+  const double invInc = 1.0 / inc;
 
   // Simplify the case where tuple magnitude is requested but the number of
   // components is only 1.
@@ -33,43 +148,136 @@ void CalculateHistogram(T* values, const vtkIdType numTuples,
     component = 0;
   }
 
-  if (component >= 0) {
-    // Single scalar value
-    for (vtkIdType j = 0; j < numTuples; ++j) {
-      // This code does not handle NaN or Inf values, so check for them and
-      // handle
-      // them specially
-      T value = *(values + component);
-      if (vtkMath::IsFinite(value)) {
-        int index = std::min(static_cast<int>((value - min) / inc), maxBin);
-        ++pops[index];
-      } else {
-        ++invalid;
-      }
-      values += numComponents;
+  struct Bins
+  {
+    std::vector<int> pops;
+    int invalid = 0;
+  };
+  vtkSMPThreadLocal<Bins> bins;
+  vtkSMPTools::For(0, numTuples, HistogramBlockSize, [&](vtkIdType begin,
+                                                         vtkIdType end) {
+    Bins& local = bins.Local();
+    if (local.pops.empty()) {
+      local.pops.resize(numBins, 0);
     }
-  } else {
-    // Multicomponent magnitude
-    for (vtkIdType j = 0; j < numTuples; ++j) {
-      // Check that all components are valid.
-      bool valid = true;
-      double squaredSum = 0.0;
-      for (vtkIdType c = 0; c < numComponents; ++c) {
-        T value = *(values + c);
-        if (!vtkMath::IsFinite(value)) {
-          valid = false;
-          break;
+    int* counts = local.pops.data();
+    const T* tuple = values + begin * numComponents;
+    if (component >= 0) {
+      // Single scalar value
+      tuple += component;
+      for (vtkIdType j = begin; j < end; ++j, tuple += numComponents) {
+        T value = *tuple;
+        if (IsFiniteValue(value)) {
+          ++counts[HistogramBin(value, min, invInc, maxBin)];
+        } else {
+          ++local.invalid;
         }
-        squaredSum += (value * value);
       }
-      if (valid) {
-        int index =
-          std::min(static_cast<int>((sqrt(squaredSum) - min) / inc), maxBin);
-        ++pops[index];
-      } else {
-        ++invalid;
+    } else {
+      // Multicomponent magnitude
+      for (vtkIdType j = begin; j < end; ++j, tuple += numComponents) {
+        double magnitude;
+        if (TupleMagnitude(tuple, numComponents, magnitude)) {
+          ++counts[HistogramBin(magnitude, min, invInc, maxBin)];
+        } else {
+          ++local.invalid;
+        }
       }
-      values += numComponents;
+    }
+  });
+
+  for (const Bins& local : bins) {
+    for (size_t i = 0; i < local.pops.size(); ++i) {
+      pops[i] += local.pops[i];
+    }
+    invalid += local.invalid;
+  }
+}
+
+/**
+ * Computes the 2D histogram of the values and gradient magnitudes of the
+ * first component of a volume, into bins[0] x bins[1] counts of histogram.
+ * The value axis spans range and the gradient axis [0, range[1] / 4], the
+ * gradient normalization the GPU mapper's fragment shader expects. Gradients
+ * are central differences, so the voxels on the boundary of the volume are
+ * left out, as are the non finite ones.
+ *
+ * Slabs of Z slices are binned in parallel, each thread counting into its own
+ * bins that are added to histogram at the end. The neighbouring slices are
+ * read in place.
+ */
+template <typename T>
+void CalculateGradientHistogram(const T* values, const int* dim,
+                                const int numComp, const double* range,
+                                const double spacing[3], const int bins[2],
+                                double* histogram)
+{
+  const size_t sizeBins = static_cast<size_t>(bins[0]) * bins[1];
+  std::fill(histogram, histogram + sizeBins, 0.0);
+  if (dim[0] < 3 || dim[1] < 3 || dim[2] < 3) {
+    return;
+  }
+
+  // Central differences delta (2 * h)
+  const double avgSpacing = (spacing[0] + spacing[1] + spacing[2]) / 3.0;
+  const double invDelta[3] = { avgSpacing / (spacing[0] * 2),
+                               avgSpacing / (spacing[1] * 2),
+                               avgSpacing / (spacing[2] * 2) };
+
+  // Normalize to RangeMax/4. This is what the gradient computation in the
+  // GPUMapper's fragment shader expects.
+  const double maxGradMag = range[1] * 0.25;
+  const double gradScale = maxGradMag > 0 ? (bins[1] - 1) / maxGradMag : 0.0;
+  const double valueWidth = range[1] - range[0];
+  const double valueScale = valueWidth > 0 ? (bins[0] - 1) / valueWidth : 0.0;
+  const int maxValueBin = bins[0] - 1;
+
+  // Index assumes alignment order in  x -> y -> z.
+  const vtkIdType strideX = numComp;
+  const vtkIdType strideY = strideX * dim[0];
+  const vtkIdType strideZ = strideY * dim[1];
+
+  vtkSMPThreadLocal<std::vector<vtkIdType>> counts;
+  vtkSMPTools::For(1, dim[2] - 1, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<vtkIdType>& local = counts.Local();
+    if (local.empty()) {
+      local.resize(sizeBins, 0);
+    }
+    vtkIdType* localBins = local.data();
+    for (vtkIdType k = begin; k < end; ++k) {
+      for (int j = 1; j < dim[1] - 1; ++j) {
+        const T* center = values + k * strideZ + j * strideY + strideX;
+        for (int i = 1; i < dim[0] - 1; ++i, center += strideX) {
+          const double value = center[0];
+          const double Dx =
+            (static_cast<double>(center[strideX]) - center[-strideX]) *
+            invDelta[0];
+          const double Dy =
+            (static_cast<double>(center[strideY]) - center[-strideY]) *
+            invDelta[1];
+          const double Dz =
+            (static_cast<double>(center[strideZ]) - center[-strideZ]) *
+            invDelta[2];
+          const double gradMag = std::sqrt(Dx * Dx + Dy * Dy + Dz * Dz);
+          if (!IsFiniteValue(value) || !IsFiniteValue(gradMag)) {
+            continue;
+          }
+
+          const double roundedMag =
+            std::min(std::floor(gradMag + 0.5), maxGradMag);
+          const vtkIdType gradIndex =
+            static_cast<vtkIdType>(roundedMag * gradScale);
+          const int valueIndex = HistogramBin(value, range[0], valueScale,
+                                              maxValueBin);
+          ++localBins[gradIndex * bins[0] + valueIndex];
+        }
+      }
+    }
+  });
+
+  for (const std::vector<vtkIdType>& local : counts) {
+    for (size_t i = 0; i < local.size(); ++i) {
+      histogram[i] += static_cast<double>(local[i]);
     }
   }
 }
@@ -81,13 +289,8 @@ void Calculate2DHistogram(T* values, const int* dim, const int numComp,
 {
   // Assumes all inputs are valid
   // Expects histogram image to be 1C double
-  vtkDataArray* arr = histogram->GetPointData()->GetScalars();
-  using ArrDouble = vtkAOSDataArrayTemplate<double>;
-  ArrDouble* histogramArr = ArrDouble::SafeDownCast(arr);
-
   int bins[3];
   histogram->GetDimensions(bins);
-  const size_t sizeBins = static_cast<size_t>(bins[0] * bins[1]);
 
   // Adjust histogram's spacing so that the axis show the actual range in the
   // chart
@@ -95,79 +298,9 @@ void Calculate2DHistogram(T* values, const int* dim, const int numComp,
                            (range[1] * 0.25) / bins[1], 1.0 };
   histogram->SetSpacing(binSpacing);
 
-  memset(histogramArr->GetVoidPointer(0), 0x0, sizeBins * sizeof(double));
-
-  const size_t sizeSlice = static_cast<size_t>(dim[0] * dim[1] * numComp);
-  std::vector<T> sliceLast(sizeSlice, 0);
-  std::vector<T> sliceCurrent(sizeSlice, 0);
-  std::vector<T> sliceNext(sizeSlice, 0);
-
-  double gradMagMax = std::numeric_limits<double>::min();
-  double gradMagMin = std::numeric_limits<double>::max();
-
-  // Central differences delta (2 * h)
-  const double avgSpacing = (spacing[0] + spacing[1] + spacing[2]) / 3.0;
-  const double delta[3] = { spacing[0] * 2 / avgSpacing,
-                            spacing[1] * 2 / avgSpacing,
-                            spacing[2] * 2 / avgSpacing };
-
-  for (int kIndex = 0; kIndex < dim[2]; kIndex++) {
-    // Index assumes alignment order in  x -> y -> z.
-    // ( z0 * Dx * Dy + y0 * Dx + x0 ) * numComp
-    const size_t strideSlice =
-      static_cast<size_t>(dim[0] * dim[1] * kIndex * numComp);
-    memcpy(&(sliceNext[0]), values + strideSlice, sizeSlice * sizeof(T));
-
-    // Fill up temporary slices during the first two iterations
-    if (kIndex >= 2) {
-      for (int jIndex = 1; jIndex < dim[1] - 1; jIndex++) {
-        for (int iIndex = 1; iIndex < dim[0] - 1; iIndex++) {
-          const size_t centerIndex = dim[0] * jIndex + iIndex;
-          const size_t deltaXFront = centerIndex + 1;
-          const size_t deltaXBack = centerIndex - 1;
-
-          const double Dx = static_cast<double>(sliceCurrent[deltaXFront] -
-                                                sliceCurrent[deltaXBack]) /
-                            delta[0];
-
-          const size_t deltaYFront = dim[0] * (jIndex + 1) + iIndex;
-          const size_t deltaYBack = dim[0] * (jIndex - 1) + iIndex;
-          const double Dy = static_cast<double>(sliceCurrent[deltaYFront] -
-                                                sliceCurrent[deltaYBack]) /
-                            delta[1];
-
-          const double Dz = static_cast<double>(sliceNext[centerIndex] -
-                                                sliceLast[centerIndex]) /
-                            delta[2];
-
-          double gradMag = sqrt(Dx * Dx + Dy * Dy + Dz * Dz);
-          gradMagMax = vtkMath::Max(gradMag, gradMagMax);
-          gradMagMin = vtkMath::Min(gradMag, gradMagMin);
-
-          // Normalize to RangeMax/4. This is what the gradient computation in
-          // the
-          // GPUMapper's fragment shader expects.
-          const double maxGradMag = range[1] * 0.25;
-          gradMag = floor(gradMag + 0.5);
-          gradMag = vtkMath::ClampValue(gradMag, 0.0, maxGradMag);
-          const vtkIdType gradIndex =
-            static_cast<vtkIdType>(gradMag * (bins[1] - 1) / maxGradMag);
-
-          const T value = values[strideSlice + centerIndex * numComp];
-          const vtkIdType valueIndex = static_cast<vtkIdType>(
-            (value - range[0]) * (bins[1] - 1) / (range[1] - range[0]));
-
-          // Update histogram array
-          const vtkIdType tupleIndex = gradIndex * bins[0] + valueIndex;
-          double histogramValue = histogramArr->GetValue(tupleIndex);
-          histogramArr->SetValue(tupleIndex, ++histogramValue);
-        }
-      }
-    }
-
-    std::swap(sliceLast, sliceCurrent);
-    std::swap(sliceCurrent, sliceNext);
-  }
+  auto histogramArr = static_cast<double*>(histogram->GetScalarPointer());
+  CalculateGradientHistogram(values, dim, numComp, range, spacing, bins,
+                             histogramArr);
 }
 
 }
@@ -33,6 +33,8 @@ public:
   bool serialize(pugi::xml_node& ns) const override;
   bool deserialize(const pugi::xml_node& ns) override;
   bool hasCustomUI() const override { return false; }
+  bool modifiesDataInPlace() const override { return false; }
+  bool supportsSlabs() const override { return true; }
 
   bool applyTransform(vtkDataObject* data) override;
 
@@ -39,6 +39,8 @@ public:
   EditOperatorWidget* getEditorContentsWithData(
     QWidget* parent, vtkSmartPointer<vtkImageData> data) override;
   bool hasCustomUI() const override { return true; }
+  bool modifiesDataInPlace() const override { return false; }
+  bool supportsPreview() const override { return false; }
 
   void setCropBounds(const int bounds[6]);
   const int* cropBounds() const { return m_bounds; }
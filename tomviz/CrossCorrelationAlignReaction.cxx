@@ -0,0 +1,145 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "CrossCorrelationAlignReaction.h"
+
+#include "ActiveObjects.h"
+#include "CrossCorrelationAlignment.h"
+#include "DataSource.h"
+#include "PipelineScheduler.h"
+#include "TomographyTiltSeries.h"
+#include "TranslateAlignOperator.h"
+
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTrivialProducer.h>
+
+#include <QPointer>
+#include <QRunnable>
+
+#include <vector>
+
+Q_DECLARE_METATYPE(std::vector<vtkVector2d>)
+
+namespace tomviz {
+
+namespace {
+
+/// Computes the offsets of the tilt images on the PipelineScheduler.
+class AlignmentJob : public QObject, public QRunnable
+{
+  Q_OBJECT
+
+public:
+  AlignmentJob(vtkImageData* tiltSeries, int reference)
+    : m_tiltSeries(tiltSeries), m_reference(reference)
+  {
+  }
+
+  void run() override
+  {
+    int dims[3];
+    m_tiltSeries->GetDimensions(dims);
+    auto scalars = TomographyTiltSeries::convertToFloat(m_tiltSeries);
+    CrossCorrelationAlignment alignment(dims[0], dims[1]);
+    emit aligned(
+      alignment.align(scalars->GetPointer(0), dims[2], m_reference));
+  }
+
+signals:
+  void aligned(std::vector<vtkVector2d> offsets);
+
+private:
+  vtkSmartPointer<vtkImageData> m_tiltSeries;
+  int m_reference;
+};
+}
+
+CrossCorrelationAlignReaction::CrossCorrelationAlignReaction(
+  QAction* parentObject)
+  : pqReaction(parentObject)
+{
+  qRegisterMetaType<std::vector<vtkVector2d>>();
+  connect(&ActiveObjects::instance(), SIGNAL(dataSourceChanged(DataSource*)),
+          SLOT(updateEnableState()));
+  updateEnableState();
+}
+
+void CrossCorrelationAlignReaction::updateEnableState()
+{
+  parentAction()->setEnabled(
+    !m_running && ActiveObjects::instance().activeDataSource() != nullptr &&
+    ActiveObjects::instance().activeDataSource()->type() ==
+      DataSource::TiltSeries);
+}
+
+void CrossCorrelationAlignReaction::align(DataSource* source)
+{
+  source = source ? source : ActiveObjects::instance().activeDataSource();
+  if (!source) {
+    return;
+  }
+  auto t = vtkTrivialProducer::SafeDownCast(
+    source->producer()->GetClientSideObject());
+  if (!t) {
+    return;
+  }
+  vtkImageData* tiltSeries =
+    vtkImageData::SafeDownCast(t->GetOutputDataObject(0));
+  if (!tiltSeries || !tiltSeries->GetPointData()->GetScalars()) {
+    return;
+  }
+
+  // Align with the image at zero degrees, or the middle one.
+  int dims[3];
+  tiltSeries->GetDimensions(dims);
+  int reference = dims[2] / 2;
+  auto angles = tiltSeries->GetFieldData()->GetArray("tilt_angles");
+  for (vtkIdType i = 0; angles && i < angles->GetNumberOfTuples(); ++i) {
+    if (angles->GetTuple1(i) == 0.0 && i < dims[2]) {
+      reference = static_cast<int>(i);
+      break;
+    }
+  }
+
+  auto job = new AlignmentJob(tiltSeries, reference);
+  QPointer<DataSource> target(source);
+  connect(job, &AlignmentJob::aligned, this,
+          [this, target](std::vector<vtkVector2d> offsets) {
+            m_running = false;
+            updateEnableState();
+            if (!target) {
+              return;
+            }
+            QVector<vtkVector2f> shifts(static_cast<int>(offsets.size()));
+            for (int i = 0; i < shifts.size(); ++i) {
+              shifts[i] = vtkVector2f(static_cast<float>(offsets[i][0]),
+                                      static_cast<float>(offsets[i][1]));
+            }
+            auto op = new TranslateAlignOperator(target);
+            op->setAlignOffsets(shifts);
+            target->addOperator(op);
+          });
+  m_running = true;
+  updateEnableState();
+  PipelineScheduler::instance().submit(job, source);
+}
+}
+
+#include "CrossCorrelationAlignReaction.moc"
@@ -0,0 +1,48 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizCrossCorrelationAlignReaction_h
+#define tomvizCrossCorrelationAlignReaction_h
+
+#include <pqReaction.h>
+
+namespace tomviz {
+class DataSource;
+
+/// Aligns the images of the active tilt series by cross correlation. The
+/// offsets are computed in the background with CrossCorrelationAlignment,
+/// then applied by a TranslateAlignOperator added to the data source, where
+/// they can be reviewed and edited like manual ones.
+class CrossCorrelationAlignReaction : public pqReaction
+{
+  Q_OBJECT
+
+public:
+  CrossCorrelationAlignReaction(QAction* parent);
+
+  void align(DataSource* source = nullptr);
+
+protected:
+  void updateEnableState() override;
+  void onTriggered() override { align(); }
+
+private:
+  Q_DISABLE_COPY(CrossCorrelationAlignReaction)
+
+  bool m_running = false;
+};
+}
+
+#endif
@@ -0,0 +1,264 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "CrossCorrelationAlignment.h"
+
+#include "FFT.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// Images correlated by each thread at a time, each of them is transformed once
+// and correlated with its neighbor in the same block.
+const int blockSize = 8;
+
+// The frequency of index k of a transform of size n, in cycles per sample.
+double frequency(int k, int n)
+{
+  return static_cast<double>(k <= (n - 1) / 2 ? k : k - n) / n;
+}
+
+// Weight of sample i of n, one but for a cosine taper to zero over the outer
+// eighth on each side.
+double taper(int i, int n)
+{
+  int edge = std::max(n / 8, 1);
+  int distance = std::min(i + 1, n - i);
+  if (distance >= edge) {
+    return 1;
+  }
+  double weight = std::sin(0.5 * pi * distance / edge);
+  return weight * weight;
+}
+
+// Offset of the vertex of the parabola through (-1, before), (0, peak) and
+// (1, after).
+double vertex(double before, double peak, double after)
+{
+  double curvature = before - 2 * peak + after;
+  if (curvature >= 0) {
+    return 0;
+  }
+  double offset = 0.5 * (before - after) / curvature;
+  return std::max(-0.5, std::min(offset, 0.5));
+}
+}
+
+namespace tomviz {
+
+CrossCorrelationAlignment::CrossCorrelationAlignment(int Nx, int Ny,
+                                                     int filterCutoff)
+  : m_Nx(Nx), m_Ny(Ny)
+{
+  // Taper the images to zero at the edges, so that the periodic correlation
+  // doesn't see the discontinuities. The window is flat elsewhere, a window
+  // sloping over the whole image biases the offsets toward zero.
+  m_window.resize(static_cast<size_t>(m_Nx) * m_Ny);
+  for (int y = 0; y < m_Ny; ++y) {
+    double wy = taper(y, m_Ny);
+    for (int x = 0; x < m_Nx; ++x) {
+      m_window[y * m_Nx + x] = static_cast<float>(taper(x, m_Nx) * wy);
+    }
+  }
+
+  // Band pass filter of the half spectrum.
+  int half = m_Nx / 2 + 1;
+  double cutoff = 0.5 / filterCutoff;
+  m_filter.resize(spectrumSize());
+  for (int y = 0; y < m_Ny; ++y) {
+    double ky = frequency(y, m_Ny);
+    for (int k = 0; k < half; ++k) {
+      double kx = static_cast<double>(k) / m_Nx;
+      double radius = std::sqrt(kx * kx + ky * ky);
+      double value = std::sin(2 * filterCutoff * pi * radius);
+      m_filter[y * half + k] =
+        radius <= cutoff ? static_cast<float>(value * value) : 0.0f;
+    }
+  }
+}
+
+void CrossCorrelationAlignment::transform(const float* image,
+                                          std::complex<float>* spectrum) const
+{
+  int half = m_Nx / 2 + 1;
+  size_t size = static_cast<size_t>(m_Nx) * m_Ny;
+  float mean = static_cast<float>(std::accumulate(image, image + size, 0.0) /
+                                  static_cast<double>(size));
+
+  // Transform two real rows at once as the real and imaginary parts of a
+  // complex row, then separate them using the symmetry of real transforms.
+  std::vector<std::complex<float>> row(m_Nx);
+  for (int y = 0; y < m_Ny; y += 2) {
+    bool pair = y + 1 < m_Ny;
+    const float* a = image + y * m_Nx;
+    const float* b = a + m_Nx;
+    const float* wa = &m_window[y * m_Nx];
+    const float* wb = wa + m_Nx;
+    for (int x = 0; x < m_Nx; ++x) {
+      row[x] = std::complex<float>((a[x] - mean) * wa[x],
+                                   pair ? (b[x] - mean) * wb[x] : 0.0f);
+    }
+    FFT::transform(&row[0], m_Nx);
+    for (int k = 0; k < half; ++k) {
+      std::complex<float> z = row[k];
+      std::complex<float> mirror = std::conj(row[(m_Nx - k) % m_Nx]);
+      spectrum[y * half + k] = 0.5f * (z + mirror);
+      if (pair) {
+        spectrum[(y + 1) * half + k] =
+          std::complex<float>(0.0f, -0.5f) * (z - mirror);
+      }
+    }
+  }
+
+  std::vector<std::complex<float>> column(m_Ny);
+  for (int k = 0; k < half; ++k) {
+    for (int y = 0; y < m_Ny; ++y) {
+      column[y] = spectrum[y * half + k];
+    }
+    FFT::transform(&column[0], m_Ny);
+    for (int y = 0; y < m_Ny; ++y) {
+      spectrum[y * half + k] = column[y];
+    }
+  }
+}
+
+void CrossCorrelationAlignment::inverse(std::complex<float>* spectrum,
+                                        float* data) const
+{
+  int half = m_Nx / 2 + 1;
+  std::vector<std::complex<float>> column(m_Ny);
+  for (int k = 0; k < half; ++k) {
+    for (int y = 0; y < m_Ny; ++y) {
+      column[y] = spectrum[y * half + k];
+    }
+    FFT::transform(&column[0], m_Ny, true);
+    for (int y = 0; y < m_Ny; ++y) {
+      spectrum[y * half + k] = column[y];
+    }
+  }
+
+  // Two real rows at once again, as the real and imaginary parts of the
+  // inverse of their combined full spectra.
+  std::vector<std::complex<float>> row(m_Nx);
+  const std::complex<float> i(0.0f, 1.0f);
+  for (int y = 0; y < m_Ny; y += 2) {
+    bool pair = y + 1 < m_Ny;
+    const std::complex<float>* a = spectrum + y * half;
+    const std::complex<float>* b = a + half;
+    for (int x = 0; x < m_Nx; ++x) {
+      bool mirrored = x >= half;
+      int k = mirrored ? m_Nx - x : x;
+      std::complex<float> valueA = mirrored ? std::conj(a[k]) : a[k];
+      std::complex<float> valueB = 0;
+      if (pair) {
+        valueB = mirrored ? std::conj(b[k]) : b[k];
+      }
+      row[x] = valueA + i * valueB;
+    }
+    FFT::transform(&row[0], m_Nx, true);
+    for (int x = 0; x < m_Nx; ++x) {
+      data[y * m_Nx + x] = row[x].real();
+      if (pair) {
+        data[(y + 1) * m_Nx + x] = row[x].imag();
+      }
+    }
+  }
+}
+
+vtkVector2d CrossCorrelationAlignment::offset(
+  const std::complex<float>* image, const std::complex<float>* reference) const
+{
+  std::vector<std::complex<float>> product(spectrumSize());
+  for (int j = 0; j < spectrumSize(); ++j) {
+    product[j] = std::conj(image[j]) * reference[j] * m_filter[j];
+  }
+  std::vector<float> correlation(static_cast<size_t>(m_Nx) * m_Ny);
+  inverse(&product[0], &correlation[0]);
+  for (float& value : correlation) {
+    value = std::abs(value);
+  }
+
+  size_t peak = std::max_element(correlation.begin(), correlation.end()) -
+                correlation.begin();
+  int px = static_cast<int>(peak % m_Nx);
+  int py = static_cast<int>(peak / m_Nx);
+  auto at = [&](int x, int y) {
+    return correlation[((y + m_Ny) % m_Ny) * m_Nx + (x + m_Nx) % m_Nx];
+  };
+  double x = px + vertex(at(px - 1, py), at(px, py), at(px + 1, py));
+  double y = py + vertex(at(px, py - 1), at(px, py), at(px, py + 1));
+
+  // The correlation is periodic, past the middle the offsets are negative.
+  if (x > m_Nx / 2) {
+    x -= m_Nx;
+  }
+  if (y > m_Ny / 2) {
+    y -= m_Ny;
+  }
+  return vtkVector2d(x, y);
+}
+
+std::vector<vtkVector2d> CrossCorrelationAlignment::align(const float* images,
+                                                          int count,
+                                                          int reference) const
+{
+  size_t imageSize = static_cast<size_t>(m_Nx) * m_Ny;
+  std::vector<vtkVector2d> relative(count, vtkVector2d(0, 0));
+  vtkSMPTools::For(0, count, blockSize, [&](vtkIdType begin, vtkIdType end) {
+    // The images of the block and their neighbors toward the reference,
+    // transformed when first needed.
+    vtkIdType first = std::max<vtkIdType>(begin - 1, 0);
+    vtkIdType last = std::min<vtkIdType>(end + 1, count);
+    std::vector<std::complex<float>> spectra((last - first) * spectrumSize());
+    std::vector<bool> transformed(last - first, false);
+    auto spectrum = [&](vtkIdType index) {
+      std::complex<float>* result = &spectra[(index - first) * spectrumSize()];
+      if (!transformed[index - first]) {
+        transform(images + index * imageSize, result);
+        transformed[index - first] = true;
+      }
+      return result;
+    };
+    for (vtkIdType index = begin; index < end; ++index) {
+      if (index == reference) {
+        continue;
+      }
+      vtkIdType neighbor = index > reference ? index - 1 : index + 1;
+      relative[index] = offset(spectrum(index), spectrum(neighbor));
+    }
+  });
+
+  // Each image moves with its neighbor, plus its offset to it.
+  std::vector<vtkVector2d> offsets(count, vtkVector2d(0, 0));
+  for (int index = reference + 1; index < count; ++index) {
+    offsets[index] =
+      vtkVector2d(offsets[index - 1][0] + relative[index][0],
+                  offsets[index - 1][1] + relative[index][1]);
+  }
+  for (int index = reference - 1; index >= 0; --index) {
+    offsets[index] =
+      vtkVector2d(offsets[index + 1][0] + relative[index][0],
+                  offsets[index + 1][1] + relative[index][1]);
+  }
+  return offsets;
+}
+}
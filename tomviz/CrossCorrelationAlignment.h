@@ -0,0 +1,75 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizCrossCorrelationAlignment_h
+#define tomvizCrossCorrelationAlignment_h
+
+#include <vtkVector.h>
+
+#include <complex>
+#include <vector>
+
+namespace tomviz {
+
+/// Aligns the images of a tilt series by cross correlation, the native
+/// counterpart of AutoCrossCorrelationTiltImageAlignment.py. Every image is
+/// windowed, transformed once and correlated with both of its neighbors, the
+/// pairs are correlated in parallel with vtkSMPTools. The peak of each
+/// correlation is refined to subpixel precision with a parabola through its
+/// neighbors on each axis.
+///
+/// The images are Nx by Ny, x fastest. The window, the band pass filter and
+/// the FFT twiddle factors only depend on the size and are computed once, the
+/// real images are transformed two rows at a time into half spectra of Ny rows
+/// of Nx / 2 + 1 values.
+class CrossCorrelationAlignment
+{
+public:
+  /// Frequencies above 0.5 / filterCutoff cycles per pixel are filtered out
+  /// of the correlation, as in the Python operator.
+  CrossCorrelationAlignment(int Nx, int Ny, int filterCutoff = 4);
+
+  /// The size of a half spectrum.
+  int spectrumSize() const { return m_Ny * (m_Nx / 2 + 1); }
+
+  /// Compute the half spectrum of the windowed image, after subtracting its
+  /// mean.
+  void transform(const float* image, std::complex<float>* spectrum) const;
+
+  /// The offset that aligns the image with the reference, given their half
+  /// spectra. Moving the image by the offset, as TranslateAlignOperator does,
+  /// overlays it on the reference.
+  vtkVector2d offset(const std::complex<float>* image,
+                     const std::complex<float>* reference) const;
+
+  /// Align count images stored one after the other with the image at index
+  /// reference, each image is aligned with its neighbor toward the reference.
+  /// Returns the offset of every image.
+  std::vector<vtkVector2d> align(const float* images, int count,
+                                 int reference) const;
+
+private:
+  // In place inverse transform of a half spectrum, the real result is stored
+  // in the first Nx * Ny floats of data.
+  void inverse(std::complex<float>* spectrum, float* data) const;
+
+  int m_Nx;
+  int m_Ny;
+  std::vector<float> m_window;
+  std::vector<float> m_filter;
+};
+}
+
+#endif
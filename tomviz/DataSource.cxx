@@ -15,6 +15,9 @@
 ******************************************************************************/
 #include "DataSource.h"
 
+#include "CheckpointCache.h"
+#include "DiskCache.h"
+#include "MemoStore.h"
 #include "ModuleManager.h"
 #include "Operator.h"
 #include "OperatorFactory.h"
@@ -25,6 +28,7 @@
 #include <vtkDoubleArray.h>
 #include <vtkFieldData.h>
 #include <vtkImageData.h>
+#include <vtkImageShrink3D.h>
 #include <vtkNew.h>
 #include <vtkPiecewiseFunction.h>
 #include <vtkSmartPointer.h>
@@ -33,6 +37,8 @@
 #include <vtkTypeInt8Array.h>
 #include <vtkVector.h>
 
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
 #include <vtkPVArrayInformation.h>
 #include <vtkPVDataInformation.h>
 #include <vtkPVDataSetAttributesInformation.h>
@@ -43,7 +49,9 @@
 #include <vtkSMSourceProxy.h>
 #include <vtkSMTransferFunctionManager.h>
 
+#include <QDateTime>
 #include <QDebug>
+#include <QFileInfo>
 #include <QMap>
 #include <QTimer>
 
@@ -65,10 +73,17 @@ public:
   vtkSmartPointer<vtkDataArray> TiltAngles;
   vtkSmartPointer<vtkStringArray> Units;
   vtkVector3d DisplayPosition;
-  QMap<Operator*, vtkWeakPointer<vtkImageData>> CachedPreOpStates;
+  CheckpointCache Checkpoints;
   PipelineWorker* Worker;
+  PipelineWorker* PreviewWorker;
   PipelineWorker::Future* Future;
   bool PipelinePaused = false;
+  vtkSmartPointer<vtkImageData> Preview;
+  bool ProgressivePreview = true;
+  // Set while Future computes a preview, the full resolution run starts from
+  // the operator at RefineFrom once it is done.
+  bool Previewing = false;
+  int RefineFrom = 0;
   PersistenceState PersistState = PersistenceState::Saved;
   double m_scaleOriginalSpacingBy = 1;
 
@@ -132,6 +147,29 @@ void deserializeDataArray(const pugi::xml_node& ns, vtkDataArray* array)
   }
   delete[] data;
 }
+
+// Downsample the image 4x into output for previews. The projections of a tilt
+// series are kept, the type recorded in the image by the operators wins over
+// the given one.
+void downsampleForPreview(vtkImageData* image, DataSource::DataSourceType type,
+                          vtkImageData* output)
+{
+  vtkFieldData* fd = image->GetFieldData();
+  auto typeArray =
+    vtkTypeInt8Array::SafeDownCast(fd->GetArray("tomviz_data_source_type"));
+  if (typeArray) {
+    type = static_cast<DataSource::DataSourceType>(
+      static_cast<int>(typeArray->GetTuple1(0)));
+  }
+
+  vtkNew<vtkImageShrink3D> shrink;
+  shrink->SetShrinkFactors(4, 4, type == DataSource::TiltSeries ? 1 : 4);
+  shrink->AveragingOff();
+  shrink->SetInputData(image);
+  shrink->Update();
+  output->ShallowCopy(shrink->GetOutput());
+  output->GetFieldData()->DeepCopy(fd);
+}
 }
 
 DataSource::ImageFuture::ImageFuture(Operator* op,
@@ -238,6 +276,19 @@ DataSource::DataSource(vtkSMSourceProxy* dataSource, DataSourceType dataType,
   resetData();
 
   this->Internals->Worker = new PipelineWorker(this);
+  this->Internals->Worker->setCheckpointCache(&this->Internals->Checkpoints);
+  // Previews are small and the user is waiting for them.
+  this->Internals->PreviewWorker = new PipelineWorker(this);
+  this->Internals->PreviewWorker->setPriority(
+    PipelineScheduler::Priority::Interactive);
+
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    this->Internals->ProgressivePreview =
+      core->settings()
+        ->value("tomviz/pipeline/ProgressivePreview", true)
+        .toBool();
+  }
 }
 
 DataSource::~DataSource()
@@ -329,6 +380,7 @@ bool DataSource::deserialize(const pugi::xml_node& ns)
   }
 
   this->Internals->Operators.clear();
+  this->Internals->Checkpoints.clear();
   resetData();
 
   // load the color map here to avoid resetData clobbering its range
@@ -367,6 +419,9 @@ bool DataSource::deserialize(const pugi::xml_node& ns)
     this->Internals->Units->SetValue(2, unit_node.attribute("z").value());
   }
 
+  // Add all the operators before deciding whether they need to be executed.
+  bool paused = this->Internals->PipelinePaused;
+  this->Internals->PipelinePaused = true;
   for (pugi::xml_node node = ns.child("Operator"); node;
        node = node.next_sibling("Operator")) {
     Operator* op(OperatorFactory::createOperator(
@@ -377,6 +432,13 @@ bool DataSource::deserialize(const pugi::xml_node& ns)
       }
     }
   }
+  this->Internals->PipelinePaused = paused;
+
+  if (!this->Internals->Operators.isEmpty() && !paused &&
+      !restoreFromDiskCache()) {
+    emit operatorStarted();
+    executeOperators();
+  }
   return true;
 }
 
@@ -501,6 +563,9 @@ void DataSource::setSpacing(const double spacing[3])
       data->SetSpacing(mySpacing);
     }
   }
+  // Checkpoints and the preview carry the old spacing.
+  this->Internals->Checkpoints.clear();
+  this->Internals->Preview = nullptr;
   emit dataPropertiesChanged();
 }
 
@@ -550,7 +615,13 @@ int DataSource::addOperator(Operator* op)
 bool DataSource::removeOperator(Operator* op)
 {
   if (op) {
-    // TODO Should remove any cache entries?
+    // The checkpoints of the operator and everything downstream of it are no
+    // longer valid.
+    auto index = this->Internals->Operators.indexOf(op);
+    if (index >= 0) {
+      this->Internals->Checkpoints.invalidate(
+        this->Internals->Operators.mid(index));
+    }
 
     // We should emit that the operator was removed...
     this->Internals->Operators.removeAll(op);
@@ -584,6 +655,8 @@ bool DataSource::removeAllOperators()
   // TODO - return false if the pipeline is running
   bool success = true;
 
+  this->Internals->Checkpoints.clear();
+
   while (this->Internals->Operators.size() > 0) {
     Operator* lastOperator = this->Internals->Operators.takeLast();
 
@@ -651,17 +724,29 @@ DataSource::ImageFuture* DataSource::getCopyOfImagePriorTo(Operator* op)
   ImageFuture* imageFuture;
   if (this->Internals->Operators.contains(op)) {
     if (this->Internals->Operators.size() > 1) {
-      vtkAlgorithm* alg = vtkAlgorithm::SafeDownCast(
-        this->Internals->OriginalDataSource->GetClientSideObject());
-      result->DeepCopy(alg->GetOutputDataObject(0));
-
       auto index = this->Internals->Operators.indexOf(op);
       // Only run operators if we have some to run
       if (index > 0) {
+        auto generation = this->Internals->Checkpoints.generation();
+        auto start = nearestCheckpoint(index, result);
+        // The checkpoint of the operator just before this one is exactly what
+        // we need.
+        if (start == index) {
+          imageFuture = new ImageFuture(op, result);
+          QTimer::singleShot(0, [=] { emit imageFuture->finished(true); });
+          return imageFuture;
+        }
+        if (start == 0) {
+          vtkAlgorithm* alg = vtkAlgorithm::SafeDownCast(
+            this->Internals->OriginalDataSource->GetClientSideObject());
+          copyOnWrite(alg->GetOutputDataObject(0), result);
+        }
+
         auto future = this->Internals->Worker->run(
-          result, this->Internals->Operators.mid(0, index));
+          result, this->Internals->Operators.mid(start, index - start));
 
         imageFuture = new ImageFuture(op, result, future);
+        imageFuture->m_checkpointGeneration = generation;
         connect(imageFuture, SIGNAL(finished(bool)), this, SLOT(updateCache()));
 
         return imageFuture;
@@ -676,7 +761,7 @@ DataSource::ImageFuture* DataSource::getCopyOfImagePriorTo(Operator* op)
 
   vtkTrivialProducer* tp = vtkTrivialProducer::SafeDownCast(
     this->Internals->Producer->GetClientSideObject());
-  result->DeepCopy(tp->GetOutputDataObject(0));
+  copyOnWrite(tp->GetOutputDataObject(0), result);
   imageFuture = new ImageFuture(op, result);
   // Delay emitting signal until next event loop
   QTimer::singleShot(0, [=] { emit imageFuture->finished(true); });
@@ -688,7 +773,14 @@ void DataSource::updateCache()
 {
   DataSource::ImageFuture* future =
     qobject_cast<DataSource::ImageFuture*>(sender());
-  this->Internals->CachedPreOpStates[future->op()] = future->result();
+  // The last operator of the run is not checkpointed by the worker, but its
+  // output is the image we just computed.
+  auto index = this->Internals->Operators.indexOf(future->op());
+  if (index > 0) {
+    this->Internals->Checkpoints.insert(this->Internals->Operators[index - 1],
+                                        future->result(),
+                                        future->m_checkpointGeneration);
+  }
 }
 
 void DataSource::dataModified()
@@ -771,7 +863,7 @@ vtkDataObject* DataSource::copyData()
   Q_ASSERT(tp);
   vtkDataObject* data = tp->GetOutputDataObject(0);
   vtkDataObject* copy = data->NewInstance();
-  copy->DeepCopy(data);
+  copyOnWrite(data, copy);
 
   return copy;
 }
@@ -790,10 +882,10 @@ vtkDataObject* DataSource::copyOriginalData()
   vtkSMSourceProxy* source = this->Internals->Producer;
   Q_ASSERT(source != nullptr);
 
-  // Create a clone and release the reader data.
+  // Create a clone sharing the reader's arrays and release the reader data.
   vtkDataObject* data = vtkalgorithm->GetOutputDataObject(0);
   vtkDataObject* dataClone = data->NewInstance();
-  dataClone->DeepCopy(data);
+  copyOnWrite(data, dataClone);
   // data->ReleaseData();  FIXME: how it this supposed to work? I get errors on
   // attempting to re-execute the reader pipeline in clone().
 
@@ -815,6 +907,8 @@ void DataSource::resetData()
     }
     image->SetSpacing(spacing);
   }
+  this->Internals->Checkpoints.clear();
+  this->Internals->Preview = nullptr;
   setData(data);
   this->Internals->GradientOpacityMap->RemoveAllPoints();
   this->Internals->m_transfer2D->SetDimensions(1, 1, 1);
@@ -859,40 +953,107 @@ void DataSource::setData(vtkDataObject* newData)
 
 void DataSource::operatorTransformModified()
 {
+  Operator* srcOp = qobject_cast<Operator*>(sender());
+  int index = srcOp ? this->Internals->Operators.indexOf(srcOp) : -1;
+  if (index < 0) {
+    index = 0;
+  }
+
+  // Invalidate even if the pipeline is paused, the operator has changed and
+  // the checkpoints downstream of it are stale.
+  this->Internals->Checkpoints.invalidate(
+    this->Internals->Operators.mid(index));
+
   if (this->Internals->PipelinePaused) {
     return;
   }
 
-  Operator* srcOp = qobject_cast<Operator*>(sender());
+  executeOperatorsFrom(index);
+}
 
-  vtkSmartPointer<vtkImageData> cachedState;
-  if (srcOp && this->Internals->CachedPreOpStates.contains(srcOp)) {
-    cachedState = this->Internals->CachedPreOpStates[srcOp];
+int DataSource::nearestCheckpoint(int index,
+                                  vtkSmartPointer<vtkImageData> data)
+{
+  for (int i = qMin(index, this->Internals->Operators.size()) - 1; i >= 0;
+       --i) {
+    auto checkpoint =
+      this->Internals->Checkpoints.find(this->Internals->Operators[i]);
+    if (checkpoint) {
+      // Operators transform in place, hand out a copy that shares the arrays
+      // until they are written to.
+      copyOnWrite(checkpoint, data);
+      return i + 1;
+    }
   }
+
+  return 0;
+}
+
+void DataSource::executeOperatorsFrom(int index)
+{
   // Cancel any running operators
   if (this->Internals->Future != nullptr &&
       this->Internals->Future->isRunning()) {
     this->Internals->Future->cancel();
   }
 
-  // Disable caching for now, issue #1133.
-  if (false && cachedState) {
-    vtkTrivialProducer* tp = vtkTrivialProducer::SafeDownCast(
-      this->Internals->Producer->GetClientSideObject());
-    // TODO Should we not copy this?
-    tp->SetOutput(cachedState);
-
-    // Use cached result and run the pipeline from the operator which we have
-    // the data before it was applied.
-    this->Internals->Future = this->Internals->Worker->run(
-      cachedState, this->Internals->Operators.mid(
-                     this->Internals->Operators.indexOf(srcOp)));
+  this->Internals->Previewing = false;
+  // The preview starts from the nearest checkpoint, downsampled like the
+  // original data.
+  vtkSmartPointer<vtkImageData> checkpoint =
+    vtkSmartPointer<vtkImageData>::New();
+  int start = nearestCheckpoint(index, checkpoint);
+  if (shouldPreview(start)) {
+    vtkImageData* data = nullptr;
+    if (start > 0) {
+      data = vtkImageData::New();
+      downsampleForPreview(checkpoint, type(), data);
+    } else if (auto preview = previewData()) {
+      data = vtkImageData::New();
+      copyOnWrite(preview, data);
+    }
+    if (data) {
+      this->Internals->Previewing = true;
+      this->Internals->RefineFrom = index;
+      this->Internals->Future = this->Internals->PreviewWorker->run(
+        data, this->Internals->Operators.mid(start));
+      connect(this->Internals->Future, SIGNAL(finished(bool)), this,
+              SLOT(pipelineFinished(bool)));
+      connect(this->Internals->Future, SIGNAL(canceled()), this,
+              SLOT(pipelineCanceled()));
+      return;
+    }
+  }
+
+  refineOperatorsFrom(index);
+}
+
+void DataSource::refineOperatorsFrom(int index)
+{
+  vtkSmartPointer<vtkImageData> checkpoint =
+    vtkSmartPointer<vtkImageData>::New();
+  int start = nearestCheckpoint(index, checkpoint);
+  vtkDataObject* data = nullptr;
+  if (start > 0) {
+    // The caller takes ownership of the data, as for copyOriginalData()
+    data = checkpoint;
+    data->Register(nullptr);
+  } else {
+    data = copyOriginalData();
+  }
+
+  auto operators = this->Internals->Operators.mid(start);
+  // We have no operators to run so just update the data and signal that
+  // data has changed
+  if (operators.isEmpty()) {
+    setData(data);
+    dataModified();
+  } else {
+    this->Internals->Future = this->Internals->Worker->run(data, operators);
     connect(this->Internals->Future, SIGNAL(finished(bool)), this,
             SLOT(pipelineFinished(bool)));
     connect(this->Internals->Future, SIGNAL(canceled()), this,
             SLOT(pipelineCanceled()));
-  } else {
-    executeOperators();
   }
 }
 
@@ -900,6 +1061,22 @@ void DataSource::pipelineFinished(bool result)
 {
   PipelineWorker::Future* future =
     qobject_cast<PipelineWorker::Future*>(sender());
+  if (this->Internals->Previewing && this->Internals->Future == future) {
+    // Show the preview while the full resolution result is computed. A failed
+    // preview isn't reported, the full resolution run has the final word.
+    this->Internals->Previewing = false;
+    this->Internals->Future = nullptr;
+    future->deleteLater();
+    if (result) {
+      setData(future->result());
+      dataModified();
+    } else {
+      future->result()->Delete();
+    }
+    refineOperatorsFrom(this->Internals->RefineFrom);
+    return;
+  }
+
   if (result) {
     setData(future->result());
   } else {
@@ -908,12 +1085,136 @@ void DataSource::pipelineFinished(bool result)
   future->deleteLater();
   if (this->Internals->Future == future) {
     this->Internals->Future = nullptr;
+    if (result) {
+      storeInDiskCache();
+    }
     emit allOperatorsFinished();
   }
 
   dataModified();
 }
 
+QByteArray DataSource::diskCacheKey(int count)
+{
+  // Only data read from files can be cached.
+  vtkSMSourceProxy* reader = this->Internals->OriginalDataSource;
+  QStringList fileNames;
+  const char* property = vtkSMCoreUtilities::GetFileNameProperty(reader);
+  if (property) {
+    vtkSMPropertyHelper helper(reader, property);
+    for (unsigned int i = 0; i < helper.GetNumberOfElements(); ++i) {
+      fileNames << QString(helper.GetAsString(i));
+    }
+  } else if (reader->HasAnnotation(Attributes::FILENAME)) {
+    fileNames << QString(reader->GetAnnotation(Attributes::FILENAME));
+  }
+  if (fileNames.isEmpty()) {
+    return QByteArray();
+  }
+
+  QByteArray key;
+  foreach (const QString& fileName, fileNames) {
+    QFileInfo info(fileName);
+    if (!info.isFile()) {
+      return QByteArray();
+    }
+    key += info.absoluteFilePath().toUtf8() + '\n';
+    key += QByteArray::number(info.size()) + '\n';
+    key += QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + '\n';
+  }
+
+  // The files identify the voxels, but the spacing and tilt angles are
+  // edited on the original data. Only those are hashed, hashing the voxels
+  // would stall the UI on large data.
+  reader->UpdatePipeline();
+  vtkDataObject* original =
+    vtkAlgorithm::SafeDownCast(reader->GetClientSideObject())
+      ->GetOutputDataObject(0);
+  key += QByteArray::number(MemoStore::hashMetadata(original), 16) + '\n';
+
+  for (int i = 0; i < count && i < this->Internals->Operators.size(); ++i) {
+    QByteArray state =
+      MemoStore::operatorState(this->Internals->Operators[i]);
+    if (state.isEmpty()) {
+      return QByteArray();
+    }
+    key += state + '\n';
+  }
+  return key;
+}
+
+bool DataSource::restoreFromDiskCache()
+{
+  auto& cache = DiskCache::instance();
+  auto& operators = this->Internals->Operators;
+  if (!cache.isEnabled() || operators.isEmpty()) {
+    return false;
+  }
+
+  QByteArray key = diskCacheKey(operators.size());
+  auto output = cache.find(key);
+  if (!output) {
+    return false;
+  }
+
+  // Every child data source the pipeline would create has to be there too.
+  QList<vtkSmartPointer<vtkImageData>> children;
+  QStringList labels;
+  for (int i = 0; i < operators.size(); ++i) {
+    vtkSmartPointer<vtkImageData> child;
+    QString label;
+    if (operators[i]->hasChildDataSource() &&
+        !operators[i]->childDataSource()) {
+      child = cache.find(diskCacheKey(i + 1) + "child", &label);
+      if (!child) {
+        return false;
+      }
+    }
+    children.append(child);
+    labels.append(label);
+  }
+
+  for (int i = 0; i < operators.size(); ++i) {
+    operators[i]->restore(children[i], labels[i]);
+  }
+  vtkImageData* data = vtkImageData::New();
+  copyOnWrite(output, data);
+  setData(data);
+  dataModified();
+  emit allOperatorsFinished();
+
+  return true;
+}
+
+void DataSource::storeInDiskCache()
+{
+  auto& cache = DiskCache::instance();
+  auto& operators = this->Internals->Operators;
+  if (!cache.isEnabled() || operators.isEmpty()) {
+    return;
+  }
+
+  QByteArray key = diskCacheKey(operators.size());
+  if (key.isEmpty() || cache.contains(key)) {
+    return;
+  }
+  vtkTrivialProducer* tp = vtkTrivialProducer::SafeDownCast(
+    this->Internals->Producer->GetClientSideObject());
+  cache.insertLater(key,
+                    vtkImageData::SafeDownCast(tp->GetOutputDataObject(0)));
+
+  for (int i = 0; i < operators.size(); ++i) {
+    DataSource* child = operators[i]->childDataSource();
+    if (operators[i]->hasChildDataSource() && child) {
+      vtkSmartPointer<vtkDataObject> childData;
+      childData.TakeReference(child->copyData());
+      cache.insertLater(diskCacheKey(i + 1) + "child",
+                        vtkImageData::SafeDownCast(childData),
+                        child->filename());
+    }
+  }
+}
+
 void DataSource::pipelineCanceled()
 {
   PipelineWorker::Future* future =
@@ -922,6 +1223,7 @@ void DataSource::pipelineCanceled()
   future->deleteLater();
   if (this->Internals->Future == future) {
     this->Internals->Future = nullptr;
+    this->Internals->Previewing = false;
   }
 }
 
@@ -995,6 +1297,8 @@ void DataSource::setTiltAngles(const QVector<double>& angles)
       tiltAngles->SetTuple1(i, angles[i]);
     }
   }
+  this->Internals->Checkpoints.clear();
+  this->Internals->Preview = nullptr;
   emit dataChanged();
 }
 
@@ -1047,27 +1351,66 @@ void DataSource::executeOperators()
     return;
   }
 
-  // Cancel any running operators
-  if (this->Internals->Future != nullptr &&
-      this->Internals->Future->isRunning()) {
-    this->Internals->Future->cancel();
+  // This is an explicit request to run the whole pipeline again.
+  this->Internals->Checkpoints.clear();
+  executeOperatorsFrom(0);
+}
+
+void DataSource::setProgressivePreview(bool enable)
+{
+  this->Internals->ProgressivePreview = enable;
+}
+
+bool DataSource::progressivePreview() const
+{
+  return this->Internals->ProgressivePreview;
+}
+
+bool DataSource::shouldPreview(int start) const
+{
+  if (!this->Internals->ProgressivePreview ||
+      start >= this->Internals->Operators.size()) {
+    return false;
+  }
+  foreach (Operator* op, this->Internals->Operators.mid(start)) {
+    if (!op->supportsPreview()) {
+      return false;
+    }
   }
 
-  auto data = copyOriginalData();
+  // Small data sets are processed quickly enough at full resolution, in MB.
+  int threshold = 256;
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    threshold = core->settings()
+                  ->value("tomviz/pipeline/PreviewThreshold", threshold)
+                  .toInt();
+  }
+  vtkAlgorithm* reader = vtkAlgorithm::SafeDownCast(
+    this->Internals->OriginalDataSource->GetClientSideObject());
+  vtkDataObject* original = reader->GetOutputDataObject(0);
 
-  // We have no operators to run so just update the data and signal that
-  // data has changed
-  if (this->Internals->Operators.isEmpty()) {
-    setData(data);
-    dataModified();
-  } else {
-    this->Internals->Future =
-      this->Internals->Worker->run(data, this->Internals->Operators);
-    connect(this->Internals->Future, SIGNAL(finished(bool)), this,
-            SLOT(pipelineFinished(bool)));
-    connect(this->Internals->Future, SIGNAL(canceled()), this,
-            SLOT(pipelineCanceled()));
+  // GetActualMemorySize() is in kibibytes.
+  return original &&
+         static_cast<qint64>(original->GetActualMemorySize()) >=
+           static_cast<qint64>(threshold) * 1024;
+}
+
+vtkImageData* DataSource::previewData()
+{
+  if (!this->Internals->Preview) {
+    vtkSmartPointer<vtkDataObject> original;
+    original.TakeReference(copyOriginalData());
+    vtkImageData* image = vtkImageData::SafeDownCast(original);
+    if (!image) {
+      return nullptr;
+    }
+
+    this->Internals->Preview = vtkSmartPointer<vtkImageData>::New();
+    downsampleForPreview(image, type(), this->Internals->Preview);
   }
+
+  return this->Internals->Preview;
 }
 
 bool DataSource::isImageStack()
@@ -1094,7 +1437,9 @@ void DataSource::resumePipeline(bool execute)
 {
   this->Internals->PipelinePaused = false;
   if (execute) {
-    executeOperators();
+    // Any operator modified while paused has invalidated its checkpoints, so
+    // we can resume from the last valid one.
+    executeOperatorsFrom(this->Internals->Operators.size());
   }
 }
 
@@ -156,6 +156,14 @@ public:
   /// Execute the operator pipeline associate with the datasource
   void executeOperators();
 
+  /// Set whether edits to the pipeline first show a preview computed on a
+  /// downsampled copy of the data, before the full resolution result. Only
+  /// used for data sets above the size configured in the application settings
+  /// and if every operator supports previews. Enabled by default, see the
+  /// "tomviz/pipeline/ProgressivePreview" setting.
+  void setProgressivePreview(bool enable);
+  bool progressivePreview() const;
+
   /// Return true is datasource is an image stack, false otherwise
   bool isImageStack();
 
@@ -224,9 +232,42 @@ protected:
   /// Create copy of original data object, caller is responsible for ownership
   vtkDataObject* copyOriginalData();
 
+  /// Execute the operator pipeline starting at the given operator index. The
+  /// pipeline is restarted from the nearest valid checkpoint upstream of it,
+  /// or from the original data if there is none. A preview of the whole
+  /// pipeline is computed first when progressive previews apply.
+  void executeOperatorsFrom(int index);
+
+  /// Execute the operator pipeline at full resolution from the given index.
+  void refineOperatorsFrom(int index);
+
+  /// Returns true if running the operators from the given index should be
+  /// previewed first.
+  bool shouldPreview(int start) const;
+
+  /// Returns the downsampled copy of the original data used for previews.
+  vtkImageData* previewData();
+
+  /// Copy the nearest valid checkpoint prior to the operator at index into
+  /// data. Returns the index of the first operator that still needs to be
+  /// applied to data, 0 if no checkpoint was found and data was not touched.
+  int nearestCheckpoint(int index, vtkSmartPointer<vtkImageData> data);
+
   /// Sets the type of data in the DataSource
   void setType(DataSourceType t);
 
+  /// Returns the DiskCache key of the output of the first count operators,
+  /// or an empty key if the data wasn't read from files.
+  QByteArray diskCacheKey(int count);
+
+  /// Restore the output of the pipeline and of the child data sources of its
+  /// operators from the DiskCache. Returns false if any is missing.
+  bool restoreFromDiskCache();
+
+  /// Write the output of the pipeline and of the child data sources of its
+  /// operators to the DiskCache, in the background.
+  void storeInDiskCache();
+
 protected slots:
   void operatorTransformModified();
 
@@ -270,6 +311,7 @@ private:
   Operator* m_operator;
   vtkSmartPointer<vtkImageData> m_imageData;
   PipelineWorker::Future* m_future;
+  int m_checkpointGeneration = 0;
 };
 }
 
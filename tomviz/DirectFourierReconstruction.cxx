@@ -0,0 +1,194 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "DirectFourierReconstruction.h"
+
+#include "FFT.h"
+
+#include <vtkSMPTools.h>
+
+#include <cmath>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// Weight of the radial frequency column of a projection on a point of the
+// grid, see bilinear() in Recon_DFT.py.
+struct GridWeight
+{
+  int column;
+  int ky;
+  int kz;
+  double weight;
+};
+}
+
+namespace tomviz {
+
+DirectFourierReconstruction::DirectFourierReconstruction(int Nx, int Ny)
+  : m_Nx(Nx), m_Ny(Ny)
+{
+  size_t planes = static_cast<size_t>(Ny / 2 + 1) * Ny;
+  m_spectrum.assign(planes * Nx, std::complex<double>(0, 0));
+  m_weights.assign(planes, 0.0);
+}
+
+void DirectFourierReconstruction::addProjection(const double* projection,
+                                                double angle)
+{
+  const int Nx = m_Nx;
+  const int Ny = m_Ny;
+  const int Nz = Ny;
+  // Zero padded to twice the width, and only the non negative frequencies of
+  // the padded rows are needed as the projection is real.
+  const int Npad = 2 * Ny;
+  const int padBefore = (Npad - Ny + 1) / 2;
+  const int columns = Npad / 2 + 1;
+
+  // The 2D transform of the ifftshift-ed projection, stored as
+  // [column][kx]. Rows along y first, then the columns along x.
+  std::vector<std::complex<double>> transform(
+    static_cast<size_t>(columns) * Nx);
+  vtkSMPTools::For(0, Nx, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<std::complex<double>> row(Npad);
+    for (vtkIdType x = begin; x < end; ++x) {
+      const double* source = projection + (x + Nx / 2) % Nx;
+      for (int k = 0; k < Npad; ++k) {
+        int y = (k + Npad / 2) % Npad - padBefore;
+        row[k] = y >= 0 && y < Ny ? source[static_cast<size_t>(y) * Nx] : 0.0;
+      }
+      FFT::transform(&row[0], Npad);
+      for (int i = 0; i < columns; ++i) {
+        transform[static_cast<size_t>(i) * Nx + x] = row[i];
+      }
+    }
+  });
+  vtkSMPTools::For(0, columns, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i) {
+      FFT::transform(&transform[i * Nx], Nx);
+    }
+  });
+
+  // Negative angles use the conjugate symmetric half of the plane, which is
+  // the conjugate with kx negated.
+  double radians = angle * pi / 180.0;
+  bool mirrored = radians < 0;
+  if (mirrored) {
+    radians += pi;
+  }
+
+  // Bilinear extrapolation of the columns onto the (ky, kz) grid
+  double dk = static_cast<double>(Ny) / Npad;
+  std::vector<GridWeight> weights;
+  for (int i = 0; i < columns; ++i) {
+    double ky = std::cos(radians) * i * dk;
+    double kz = std::sin(radians) * i * dk;
+    double sy = std::abs(std::floor(ky) - ky);
+    double sz = std::abs(std::floor(kz) - kz);
+    const double corners[4][3] = {
+      { std::floor(ky), std::floor(kz), (1 - sy) * (1 - sz) },
+      { std::ceil(ky), std::floor(kz), sy * (1 - sz) },
+      { std::floor(ky), std::ceil(kz), (1 - sy) * sz },
+      { std::ceil(ky), std::ceil(kz), sy * sz }
+    };
+    for (const auto& corner : corners) {
+      int py = static_cast<int>(corner[0]);
+      int pz = static_cast<int>(corner[1]);
+      if (py < 0) {
+        py += Ny;
+      }
+      if (py >= 0 && py < Ny && pz >= 0 && pz <= Nz / 2) {
+        weights.push_back({ i, py, pz, corner[2] });
+        m_weights[static_cast<size_t>(pz) * Ny + py] += corner[2];
+      }
+    }
+  }
+
+  // Every kx is independent
+  vtkSMPTools::For(0, Nx, [&](vtkIdType begin, vtkIdType end) {
+    for (const auto& w : weights) {
+      const std::complex<double>* column =
+        &transform[static_cast<size_t>(w.column) * Nx];
+      std::complex<double>* grid =
+        &m_spectrum[(static_cast<size_t>(w.kz) * Ny + w.ky) * Nx];
+      for (vtkIdType x = begin; x < end; ++x) {
+        std::complex<double> value =
+          mirrored ? std::conj(column[(Nx - x) % Nx]) : column[x];
+        grid[x] += w.weight * value;
+      }
+    }
+  });
+}
+
+void DirectFourierReconstruction::reconstruct(double* volume)
+{
+  const int Nx = m_Nx;
+  const int Ny = m_Ny;
+  const int Nz = Ny;
+  const int planes = Nz / 2 + 1;
+
+  // Average, then invert the transform along x and y in each kz plane
+  vtkSMPTools::For(0, planes, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<std::complex<double>> column(Ny);
+    for (vtkIdType z = begin; z < end; ++z) {
+      std::complex<double>* plane = &m_spectrum[z * Ny * Nx];
+      for (int y = 0; y < Ny; ++y) {
+        double weight = m_weights[z * Ny + y];
+        std::complex<double>* row = plane + static_cast<size_t>(y) * Nx;
+        if (weight != 0) {
+          for (int x = 0; x < Nx; ++x) {
+            row[x] /= weight;
+          }
+        }
+        FFT::transform(row, Nx, true);
+      }
+      for (int x = 0; x < Nx; ++x) {
+        for (int y = 0; y < Ny; ++y) {
+          column[y] = plane[static_cast<size_t>(y) * Nx + x];
+        }
+        FFT::transform(&column[0], Ny, true);
+        for (int y = 0; y < Ny; ++y) {
+          plane[static_cast<size_t>(y) * Nx + x] = column[y];
+        }
+      }
+    }
+  });
+
+  // Real inverse transform along z from the half spectrum, written fftshift-ed
+  // to the volume.
+  size_t planeSize = static_cast<size_t>(Ny) * Nx;
+  vtkSMPTools::For(0, Ny, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<std::complex<double>> line(Nz);
+    for (vtkIdType y = begin; y < end; ++y) {
+      for (int x = 0; x < Nx; ++x) {
+        size_t offset = y * Nx + x;
+        for (int z = 0; z < planes; ++z) {
+          line[z] = m_spectrum[z * planeSize + offset];
+        }
+        for (int z = planes; z < Nz; ++z) {
+          line[z] = std::conj(line[Nz - z]);
+        }
+        FFT::transform(&line[0], Nz, true);
+        size_t shifted = ((y + Ny / 2) % Ny) * static_cast<size_t>(Nx) +
+                         (x + Nx / 2) % Nx;
+        for (int z = 0; z < Nz; ++z) {
+          volume[((z + Nz / 2) % Nz) * planeSize + shifted] = line[z].real();
+        }
+      }
+    }
+  });
+}
+}
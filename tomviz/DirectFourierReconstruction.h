@@ -0,0 +1,57 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizDirectFourierReconstruction_h
+#define tomvizDirectFourierReconstruction_h
+
+#include <complex>
+#include <vector>
+
+namespace tomviz {
+
+/// Direct Fourier reconstruction, the native counterpart of Recon_DFT.py. By
+/// the central slice theorem the Fourier transform of each projection is a
+/// plane of the Fourier transform of the volume: every projection is
+/// transformed and spread onto the grid of the volume's half spectrum with
+/// bilinear weights, and the inverse transform of the averaged grid is the
+/// reconstruction.
+///
+/// The tilt axis is x and must be centered in y. The projections are Nx by Ny
+/// images and the reconstruction is Nx by Ny by Ny, all stored x fastest and
+/// in double precision like the Python operator. Uses vtkSMPTools.
+class DirectFourierReconstruction
+{
+public:
+  DirectFourierReconstruction(int Nx, int Ny);
+
+  /// Add a projection taken at angle (in degrees).
+  void addProjection(const double* projection, double angle);
+
+  /// Compute the reconstruction from the projections added so far into
+  /// volume, of Nx * Ny * Ny values. Modifies the accumulated spectrum, so it
+  /// can only be called once.
+  void reconstruct(double* volume);
+
+private:
+  int m_Nx;
+  int m_Ny;
+  // The half spectrum of the volume, stored as [kz][ky][kx] with
+  // Ny / 2 + 1 planes of kz, and the sum of the weights of each (kz, ky).
+  std::vector<std::complex<double>> m_spectrum;
+  std::vector<double> m_weights;
+};
+}
+
+#endif
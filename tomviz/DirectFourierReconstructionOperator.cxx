@@ -0,0 +1,181 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "DirectFourierReconstructionOperator.h"
+
+#include "DataSource.h"
+#include "DirectFourierReconstruction.h"
+
+#include <pqSMProxy.h>
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSMProxyManager.h>
+#include <vtkSMSessionProxyManager.h>
+#include <vtkSMSourceProxy.h>
+#include <vtkTrivialProducer.h>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTime>
+
+#include <vector>
+
+namespace {
+
+// Copy the projection of the given index, as doubles.
+template <typename T>
+void copyProjection(const T* data, size_t size, int index, double* projection)
+{
+  const T* source = data + size * index;
+  for (size_t i = 0; i < size; ++i) {
+    projection[i] = static_cast<double>(source[i]);
+  }
+}
+}
+
+namespace tomviz {
+
+DirectFourierReconstructionOperator::DirectFourierReconstructionOperator(
+  QObject* p)
+  : Operator(p)
+{
+  setSupportsCancel(true);
+  setHasChildDataSource(true);
+  connect(this, &DirectFourierReconstructionOperator::newChildDataSource, this,
+          &DirectFourierReconstructionOperator::createNewChildDataSource);
+}
+
+QIcon DirectFourierReconstructionOperator::icon() const
+{
+  return QIcon(":/pqWidgets/Icons/pqExtractGrid24.png");
+}
+
+Operator* DirectFourierReconstructionOperator::clone() const
+{
+  return new DirectFourierReconstructionOperator;
+}
+
+bool DirectFourierReconstructionOperator::serialize(pugi::xml_node&) const
+{
+  return true;
+}
+
+bool DirectFourierReconstructionOperator::deserialize(const pugi::xml_node&)
+{
+  return true;
+}
+
+bool DirectFourierReconstructionOperator::applyTransform(
+  vtkDataObject* dataObject)
+{
+  auto imageData = vtkImageData::SafeDownCast(dataObject);
+  if (!imageData || !imageData->GetPointData()->GetScalars()) {
+    return false;
+  }
+
+  int extent[6];
+  imageData->GetExtent(extent);
+  int Nx = extent[1] - extent[0] + 1;
+  int Ny = extent[3] - extent[2] + 1;
+  int numTilts = extent[5] - extent[4] + 1;
+
+  vtkDataArray* tiltAngles =
+    dataObject->GetFieldData()->GetArray("tilt_angles");
+  if (!tiltAngles || tiltAngles->GetNumberOfTuples() < numTilts) {
+    qWarning() << "Incorrect number of tilt angles for" << numTilts
+               << "projections";
+    return false;
+  }
+
+  setTotalProgressSteps(numTilts + 1);
+  setProgressStep(0);
+  setProgressMessage("Initialization");
+
+  DirectFourierReconstruction reconstruction(Nx, Ny);
+  vtkDataArray* scalars = imageData->GetPointData()->GetScalars();
+  size_t projectionSize = static_cast<size_t>(Nx) * Ny;
+  std::vector<double> projection(projectionSize);
+  QElapsedTimer timer;
+  timer.start();
+  QString estimate = "n/a";
+  for (int i = 0; i < numTilts; ++i) {
+    if (isCanceled()) {
+      return false;
+    }
+    setProgressMessage(QString("Tilt image No.%1/%2. Estimated time to "
+                               "complete: %3")
+                         .arg(i + 1)
+                         .arg(numTilts)
+                         .arg(estimate));
+    switch (scalars->GetDataType()) {
+      vtkTemplateMacro(copyProjection(
+        static_cast<VTK_TT*>(scalars->GetVoidPointer(0)), projectionSize, i,
+        &projection[0]));
+    }
+    reconstruction.addProjection(&projection[0], tiltAngles->GetTuple1(i));
+    setProgressStep(i + 1);
+    qint64 left = timer.elapsed() / (i + 1) * (numTilts - i - 1) / 1000;
+    estimate = QTime(0, 0).addSecs(static_cast<int>(left)).toString("hh:mm:ss");
+  }
+
+  setProgressMessage("Inverse Fourier transform");
+  vtkNew<vtkImageData> reconstructionImage;
+  int extent2[6] = { extent[0], extent[1], extent[2],
+                     extent[3], extent[2], extent[3] };
+  reconstructionImage->SetExtent(extent2);
+  reconstructionImage->SetSpacing(imageData->GetSpacing());
+  reconstructionImage->SetOrigin(imageData->GetOrigin());
+  reconstructionImage->AllocateScalars(VTK_DOUBLE, 1);
+  vtkDataArray* darray = reconstructionImage->GetPointData()->GetScalars();
+  darray->SetName("scalars");
+  reconstruction.reconstruct(static_cast<double*>(darray->GetVoidPointer(0)));
+  setProgressStep(numTilts + 1);
+
+  emit newChildDataSource("Reconstruction", reconstructionImage.Get());
+  return true;
+}
+
+void DirectFourierReconstructionOperator::createNewChildDataSource(
+  const QString& label, vtkSmartPointer<vtkDataObject> childData)
+{
+  vtkSMProxyManager* proxyManager = vtkSMProxyManager::GetProxyManager();
+  vtkSMSessionProxyManager* sessionProxyManager =
+    proxyManager->GetActiveSessionProxyManager();
+
+  pqSMProxy producerProxy;
+  producerProxy.TakeReference(
+    sessionProxyManager->NewProxy("sources", "TrivialProducer"));
+  producerProxy->UpdateVTKObjects();
+
+  vtkTrivialProducer* producer =
+    vtkTrivialProducer::SafeDownCast(producerProxy->GetClientSideObject());
+  if (!producer) {
+    qWarning() << "Could not get TrivialProducer from proxy";
+    return;
+  }
+
+  producer->SetOutput(childData);
+
+  DataSource* childDS = new DataSource(
+    vtkSMSourceProxy::SafeDownCast(producerProxy), DataSource::Volume, this,
+    DataSource::PersistenceState::Transient);
+
+  childDS->setFilename(label.toLatin1().data());
+  setChildDataSource(childDS);
+}
+}
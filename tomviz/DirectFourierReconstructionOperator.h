@@ -0,0 +1,62 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizDirectFourierReconstructionOperator_h
+#define tomvizDirectFourierReconstructionOperator_h
+
+#include "Operator.h"
+
+namespace tomviz {
+
+/// Native direct Fourier reconstruction, replacing the Recon_DFT Python
+/// operator and its pyfftw dependency. The tilt axis must be parallel to x and
+/// centered in y, the Nx by Ny by Ny reconstruction becomes a child data
+/// source.
+class DirectFourierReconstructionOperator : public Operator
+{
+  Q_OBJECT
+
+public:
+  DirectFourierReconstructionOperator(QObject* parent = nullptr);
+
+  QString label() const override { return "Reconstruct (Direct Fourier)"; }
+  QIcon icon() const override;
+  Operator* clone() const override;
+
+  bool serialize(pugi::xml_node& ns) const override;
+  bool deserialize(const pugi::xml_node& ns) override;
+
+  bool modifiesDataInPlace() const override { return false; }
+  bool supportsPreview() const override { return false; }
+
+protected:
+  bool applyTransform(vtkDataObject* data) override;
+
+signals:
+  // Signal used to request the creation of a new data source. Needed to
+  // ensure the initialization of the new DataSource is performed on UI thread
+  void newChildDataSource(const QString&, vtkSmartPointer<vtkDataObject>);
+
+private slots:
+  // Create a new child datasource and set it on this operator
+  void createNewChildDataSource(const QString& label,
+                                vtkSmartPointer<vtkDataObject>);
+
+private:
+  Q_DISABLE_COPY(DirectFourierReconstructionOperator)
+};
+}
+
+#endif
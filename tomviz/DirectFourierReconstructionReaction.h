@@ -0,0 +1,43 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizDirectFourierReconstructionReaction_h
+#define tomvizDirectFourierReconstructionReaction_h
+
+#include <pqReaction.h>
+
+namespace tomviz {
+class DataSource;
+
+/// Adds a DirectFourierReconstructionOperator to the active tilt series.
+class DirectFourierReconstructionReaction : public pqReaction
+{
+  Q_OBJECT
+
+public:
+  DirectFourierReconstructionReaction(QAction* parent);
+
+  void recon(DataSource* input = nullptr);
+
+protected:
+  void updateEnableState() override;
+  void onTriggered() override { recon(); }
+
+private:
+  Q_DISABLE_COPY(DirectFourierReconstructionReaction)
+};
+}
+
+#endif
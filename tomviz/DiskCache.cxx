@@ -0,0 +1,307 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "DiskCache.h"
+
+#include "PipelineScheduler.h"
+#include "Utilities.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkStringArray.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkXMLImageDataWriter.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QUuid>
+
+#if defined(Q_OS_WIN)
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace {
+
+const char* keyArrayName = "tomviz_cache_key";
+const char* labelArrayName = "tomviz_cache_label";
+
+// Mark the entry as used now, eviction removes the oldest entries first.
+void touch(const QString& fileName)
+{
+#if defined(Q_OS_WIN)
+  _wutime(reinterpret_cast<const wchar_t*>(fileName.utf16()), nullptr);
+#else
+  utime(QFile::encodeName(fileName).constData(), nullptr);
+#endif
+}
+
+QString stringValue(vtkFieldData* fieldData, const char* name)
+{
+  auto array = vtkStringArray::SafeDownCast(fieldData->GetAbstractArray(name));
+  if (!array || array->GetNumberOfValues() < 1) {
+    return QString();
+  }
+  return QString::fromUtf8(array->GetValue(0).c_str());
+}
+
+void setStringValue(vtkFieldData* fieldData, const char* name,
+                    const QString& value)
+{
+  vtkNew<vtkStringArray> array;
+  array->SetName(name);
+  array->InsertNextValue(value.toUtf8().constData());
+  fieldData->AddArray(array.Get());
+}
+}
+
+namespace tomviz {
+
+class DiskCache::Writer : public QRunnable
+{
+public:
+  Writer(const QByteArray& key, vtkImageData* data, const QString& label)
+    : m_key(key), m_data(vtkSmartPointer<vtkImageData>::New()), m_label(label)
+  {
+    copyOnWrite(data, m_data);
+  }
+
+  void run() override { DiskCache::instance().insert(m_key, m_data, m_label); }
+
+private:
+  QByteArray m_key;
+  vtkSmartPointer<vtkImageData> m_data;
+  QString m_label;
+};
+
+DiskCache::DiskCache() : m_budget(defaultBudget())
+{
+  setDirectory(defaultDirectory());
+}
+
+DiskCache& DiskCache::instance()
+{
+  static DiskCache theInstance;
+  return theInstance;
+}
+
+void DiskCache::setDirectory(const QString& directory)
+{
+  QMutexLocker locker(&m_mutex);
+  m_directory = directory;
+  if (!m_directory.isEmpty() && !QDir().mkpath(m_directory)) {
+    qWarning("Unable to create the cache directory %s, the disk cache is "
+             "disabled.",
+             qPrintable(m_directory));
+    m_directory.clear();
+  }
+}
+
+QString DiskCache::directory() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_directory;
+}
+
+bool DiskCache::isEnabled() const
+{
+  QMutexLocker locker(&m_mutex);
+  return !m_directory.isEmpty() && m_budget > 0;
+}
+
+void DiskCache::setBudget(qint64 bytes)
+{
+  {
+    QMutexLocker locker(&m_mutex);
+    m_budget = qMax(bytes, static_cast<qint64>(0));
+  }
+  evict();
+}
+
+qint64 DiskCache::budget() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_budget;
+}
+
+vtkSmartPointer<vtkImageData> DiskCache::find(const QByteArray& key,
+                                              QString* label)
+{
+  if (!isEnabled() || key.isEmpty()) {
+    return nullptr;
+  }
+  QString path = fileName(key);
+  if (!QFile::exists(path)) {
+    return nullptr;
+  }
+
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(path.toLocal8Bit().constData());
+  reader->Update();
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->ShallowCopy(reader->GetOutput());
+
+  // The file name is a hash of the key, make sure it is the right entry.
+  vtkFieldData* fieldData = image->GetFieldData();
+  if (stringValue(fieldData, keyArrayName) != QString::fromUtf8(key)) {
+    return nullptr;
+  }
+  if (label) {
+    *label = stringValue(fieldData, labelArrayName);
+  }
+  fieldData->RemoveArray(keyArrayName);
+  fieldData->RemoveArray(labelArrayName);
+  touch(path);
+
+  return image;
+}
+
+bool DiskCache::contains(const QByteArray& key) const
+{
+  return isEnabled() && !key.isEmpty() && QFile::exists(fileName(key));
+}
+
+void DiskCache::insertLater(const QByteArray& key, vtkImageData* data,
+                            const QString& label)
+{
+  if (!isEnabled() || key.isEmpty() || !data) {
+    return;
+  }
+  PipelineScheduler::instance().submit(new Writer(key, data, label), nullptr,
+                                       PipelineScheduler::Priority::Background);
+}
+
+bool DiskCache::insert(const QByteArray& key, vtkImageData* data,
+                       const QString& label)
+{
+  if (!isEnabled() || key.isEmpty() || !data) {
+    return false;
+  }
+
+  QString path = fileName(key);
+  if (QFile::exists(path)) {
+    touch(path);
+    return true;
+  }
+
+  vtkNew<vtkImageData> copy;
+  copyOnWrite(data, copy.Get());
+  setStringValue(copy->GetFieldData(), keyArrayName, QString::fromUtf8(key));
+  setStringValue(copy->GetFieldData(), labelArrayName, label);
+
+  // Write under a unique name and rename, readers never see partial files.
+  QString partial =
+    QString("%1.%2.part").arg(path).arg(QUuid::createUuid().toString());
+  vtkNew<vtkXMLImageDataWriter> writer;
+  writer->SetInputData(copy.Get());
+  writer->SetFileName(partial.toLocal8Bit().constData());
+  writer->SetDataModeToAppended();
+  writer->EncodeAppendedDataOff();
+  writer->SetCompressorTypeToNone();
+  writer->SetHeaderTypeToUInt64();
+  if (!writer->Write()) {
+    QFile::remove(partial);
+    return false;
+  }
+  QFile::remove(path);
+  if (!QFile::rename(partial, path)) {
+    QFile::remove(partial);
+    return false;
+  }
+
+  evict();
+  return true;
+}
+
+void DiskCache::clear()
+{
+  QMutexLocker locker(&m_mutex);
+  if (m_directory.isEmpty()) {
+    return;
+  }
+  QDir dir(m_directory);
+  foreach (const QString& entry,
+           dir.entryList(QStringList() << "*.vti", QDir::Files)) {
+    dir.remove(entry);
+  }
+}
+
+QString DiskCache::defaultDirectory()
+{
+  QString directory;
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    directory =
+      core->settings()->value("tomviz/pipeline/DiskCacheDirectory").toString();
+  }
+
+  return directory;
+}
+
+qint64 DiskCache::defaultBudget()
+{
+  // In megabytes
+  int budget = 20480;
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    budget =
+      core->settings()->value("tomviz/pipeline/DiskCacheSize", budget).toInt();
+  }
+
+  return static_cast<qint64>(budget) * 1024 * 1024;
+}
+
+QString DiskCache::fileName(const QByteArray& key) const
+{
+  quint64 hash = fnv1aHash(key.constData(), key.size());
+  QMutexLocker locker(&m_mutex);
+  return QDir(m_directory)
+    .absoluteFilePath(QString("%1.vti").arg(hash, 16, 16, QChar('0')));
+}
+
+void DiskCache::evict()
+{
+  QMutexLocker locker(&m_mutex);
+  if (m_directory.isEmpty()) {
+    return;
+  }
+
+  // Oldest first
+  QFileInfoList entries =
+    QDir(m_directory)
+      .entryInfoList(QStringList() << "*.vti", QDir::Files,
+                     QDir::Time | QDir::Reversed);
+  qint64 size = 0;
+  foreach (const QFileInfo& entry, entries) {
+    size += entry.size();
+  }
+  foreach (const QFileInfo& entry, entries) {
+    if (size <= m_budget) {
+      break;
+    }
+    if (QFile::remove(entry.absoluteFilePath())) {
+      size -= entry.size();
+    }
+  }
+}
+}
@@ -0,0 +1,96 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizDiskCache_h
+#define tomvizDiskCache_h
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+#include <vtkSmartPointer.h>
+
+class vtkImageData;
+
+namespace tomviz {
+
+/// Opt-in store of pipeline outputs on disk, so that reopening a state file
+/// reads the output of the pipelines instead of executing the operators again.
+/// The DataSource records its output and the outputs of the child data sources
+/// of its operators, keyed by the files the data was read from (name, size and
+/// modification time), the edited spacing and tilt angles and the chain of
+/// operators, see DataSource.
+///
+/// Entries are VTK XML image files with uncompressed appended raw data in the
+/// cache directory. The least recently used entries are removed once the size
+/// cap is exceeded. Several processes may share a cache directory.
+class DiskCache
+{
+public:
+  /// Returns reference to the singleton instance.
+  static DiskCache& instance();
+
+  /// Set the cache directory, an empty directory disables the cache.
+  void setDirectory(const QString& directory);
+  QString directory() const;
+  bool isEnabled() const;
+
+  /// Set the size cap of the directory in bytes.
+  void setBudget(qint64 bytes);
+  qint64 budget() const;
+
+  /// Returns the entry stored for key, or nullptr. If label is given it is
+  /// set to the label the entry was stored with.
+  vtkSmartPointer<vtkImageData> find(const QByteArray& key,
+                                     QString* label = nullptr);
+
+  /// Returns true if an entry is stored for key, without reading it.
+  bool contains(const QByteArray& key) const;
+
+  /// Write data as the entry for key on the PipelineScheduler, at background
+  /// priority. The data is shared with the writer (see copyOnWrite()).
+  void insertLater(const QByteArray& key, vtkImageData* data,
+                   const QString& label = QString());
+
+  /// Write data as the entry for key on the calling thread.
+  bool insert(const QByteArray& key, vtkImageData* data,
+              const QString& label = QString());
+
+  /// Remove all the entries.
+  void clear();
+
+  /// The directory and size cap configured in the application settings.
+  static QString defaultDirectory();
+  static qint64 defaultBudget();
+
+private:
+  DiskCache();
+  Q_DISABLE_COPY(DiskCache)
+
+  class Writer;
+
+  QString fileName(const QByteArray& key) const;
+
+  // Remove the least recently used entries until the directory fits the
+  // budget.
+  void evict();
+
+  mutable QMutex m_mutex;
+  QString m_directory;
+  qint64 m_budget = 0;
+};
+}
+
+#endif
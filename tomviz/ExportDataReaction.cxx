@@ -203,7 +203,7 @@ bool ExportDataReaction::exportData(const QString& filename)
     auto imageType = imageData->GetPointData()->GetScalars()->GetDataType();
     if (strcmp(writerName, "vtkTIFFWriter") == 0 && imageType == VTK_DOUBLE) {
       vtkNew<vtkImageData> fImage;
-      fImage->DeepCopy(imageData);
+      copyOnWrite(imageData, fImage.Get());
       ConvertToFloatOperator convertFloat;
       convertFloat.applyTransform(fImage);
 
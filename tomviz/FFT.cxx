@@ -0,0 +1,206 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "FFT.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// The twiddle factors exp(-2 pi i k / n) for k < n / 2, computed once per size
+// and never released, the reconstructions use a handful of sizes. Each thread
+// remembers the factors it has used, so that the lock is only taken the first
+// time a thread uses a size rather than on every transform.
+template <typename T>
+const std::vector<std::complex<T>>& twiddles(int n)
+{
+  thread_local std::map<int, const std::vector<std::complex<T>>*> local;
+  auto& localFactors = local[n];
+  if (localFactors) {
+    return *localFactors;
+  }
+
+  static QMutex mutex;
+  static std::map<int, std::vector<std::complex<T>>> cache;
+
+  QMutexLocker locker(&mutex);
+  auto& factors = cache[n];
+  if (factors.empty()) {
+    factors.resize(std::max(n / 2, 1));
+    for (int k = 0; k < n / 2; ++k) {
+      double angle = -2.0 * pi * k / n;
+      factors[k] = std::complex<T>(static_cast<T>(std::cos(angle)),
+                                   static_cast<T>(std::sin(angle)));
+    }
+  }
+  // The elements of a map never move.
+  localFactors = &factors;
+  return factors;
+}
+
+// Unscaled transform, n must be a power of two.
+template <typename T>
+void radix2(std::complex<T>* data, int n, bool inverse)
+{
+  // Bit reversal permutation
+  for (int i = 1, j = 0; i < n; ++i) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(data[i], data[j]);
+    }
+  }
+
+  const auto& factors = twiddles<T>(n);
+  for (int length = 2; length <= n; length <<= 1) {
+    int half = length / 2;
+    int stride = n / length;
+    for (int start = 0; start < n; start += length) {
+      for (int k = 0; k < half; ++k) {
+        std::complex<T> w = factors[k * stride];
+        if (inverse) {
+          w = std::conj(w);
+        }
+        std::complex<T> even = data[start + k];
+        std::complex<T> odd = data[start + k + half] * w;
+        data[start + k] = even + odd;
+        data[start + k + half] = even - odd;
+      }
+    }
+  }
+}
+
+// Bluestein's algorithm turns a transform of any size n into a convolution
+// with the chirp exp(-pi i k^2 / n), computed with power of two transforms of
+// size m.
+template <typename T>
+struct Chirp
+{
+  int m = 0;
+  std::vector<std::complex<T>> chirp;
+  // The transform of the conjugate chirp wrapped around m, scaled by 1/m
+  std::vector<std::complex<T>> filter;
+};
+
+// Cached like the twiddle factors.
+template <typename T>
+const Chirp<T>& chirp(int n)
+{
+  thread_local std::map<int, const Chirp<T>*> local;
+  auto& localPlan = local[n];
+  if (localPlan) {
+    return *localPlan;
+  }
+
+  static QMutex mutex;
+  static std::map<int, Chirp<T>> cache;
+
+  QMutexLocker locker(&mutex);
+  auto& plan = cache[n];
+  if (plan.m == 0) {
+    int m = tomviz::FFT::nextPowerOfTwo(2 * n - 1);
+    plan.chirp.resize(n);
+    plan.filter.assign(m, std::complex<T>(0, 0));
+    for (int k = 0; k < n; ++k) {
+      // k^2 mod 2n keeps the angle small
+      long long square = static_cast<long long>(k) * k % (2 * n);
+      double angle = -pi * square / n;
+      plan.chirp[k] = std::complex<T>(static_cast<T>(std::cos(angle)),
+                                      static_cast<T>(std::sin(angle)));
+      plan.filter[k] = std::conj(plan.chirp[k]) / static_cast<T>(m);
+      if (k > 0) {
+        plan.filter[m - k] = plan.filter[k];
+      }
+    }
+    radix2(&plan.filter[0], m, false);
+    plan.m = m;
+  }
+  localPlan = &plan;
+  return plan;
+}
+
+template <typename T>
+void transform(std::complex<T>* data, int n, bool inverse)
+{
+  if (n < 2) {
+    return;
+  }
+
+  if (tomviz::FFT::nextPowerOfTwo(n) == n) {
+    radix2(data, n, inverse);
+  } else {
+    // The inverse is the conjugate of the transform of the conjugate
+    const auto& plan = chirp<T>(n);
+    std::vector<std::complex<T>> a(plan.m, std::complex<T>(0, 0));
+    for (int k = 0; k < n; ++k) {
+      auto value = inverse ? std::conj(data[k]) : data[k];
+      a[k] = value * plan.chirp[k];
+    }
+    radix2(&a[0], plan.m, false);
+    for (int k = 0; k < plan.m; ++k) {
+      a[k] *= plan.filter[k];
+    }
+    radix2(&a[0], plan.m, true);
+    for (int k = 0; k < n; ++k) {
+      auto value = a[k] * plan.chirp[k];
+      data[k] = inverse ? std::conj(value) : value;
+    }
+  }
+
+  if (inverse) {
+    T scale = static_cast<T>(1) / n;
+    for (int i = 0; i < n; ++i) {
+      data[i] *= scale;
+    }
+  }
+}
+}
+
+namespace tomviz {
+
+namespace FFT {
+
+int nextPowerOfTwo(int n)
+{
+  int power = 1;
+  while (power < n) {
+    power <<= 1;
+  }
+  return power;
+}
+
+void transform(std::complex<float>* data, int n, bool inverse)
+{
+  ::transform(data, n, inverse);
+}
+
+void transform(std::complex<double>* data, int n, bool inverse)
+{
+  ::transform(data, n, inverse);
+}
+}
+}
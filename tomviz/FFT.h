@@ -0,0 +1,40 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizFFT_h
+#define tomvizFFT_h
+
+#include <complex>
+
+namespace tomviz {
+
+/// A small FFT for the native reconstruction code, which only needs 1D
+/// transforms. Powers of two use a radix-2 transform, other sizes Bluestein's
+/// algorithm on top of it. The twiddle factors and chirps are computed once per
+/// size and cached, each thread looks them up without locking once it has used
+/// a size.
+namespace FFT {
+
+/// Returns the smallest power of two greater or equal to n.
+int nextPowerOfTwo(int n);
+
+/// In place transform of n complex values. The inverse transform is scaled by
+/// 1/n so that a round trip is the identity. Thread safe.
+void transform(std::complex<float>* data, int n, bool inverse = false);
+void transform(std::complex<double>* data, int n, bool inverse = false);
+}
+}
+
+#endif
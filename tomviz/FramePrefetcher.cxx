@@ -0,0 +1,310 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+
+#include "FramePrefetcher.h"
+
+#include "PipelineScheduler.h"
+
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkScalarsToColors.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <QAtomicInt>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cstdlib>
+
+Q_DECLARE_METATYPE(vtkSmartPointer<vtkImageData>)
+
+namespace tomviz {
+
+/// The generation and the ring of the latest request, so that the jobs can
+/// skip the frames no longer wanted by the time they start.
+struct FramePrefetcher::Request
+{
+  QAtomicInt generation;
+  QAtomicInt current;
+  QAtomicInt radius;
+  int count = 1;
+
+  // Returns true if slice is still in the ring, which wraps around.
+  bool inRing(int slice) const
+  {
+    int distance = std::abs(slice - current.load()) % count;
+    return std::min(distance, count - distance) <= radius.load();
+  }
+};
+
+namespace {
+
+template <typename T>
+void mapValues(const T* values, vtkIdType count,
+               const FramePrefetcher::ColorTable& table, unsigned char* rgb)
+{
+  int last = table.size() - 1;
+  double width = table.range[1] - table.range[0];
+  double scale = width > 0 ? last / width : 0.0;
+  double minimum = table.range[0];
+  const unsigned char* colors = table.rgb.data();
+  vtkSMPTools::For(0, count, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i) {
+      double t = (values[i] - minimum) * scale;
+      // Also sends NaN to the first color.
+      int index = 0;
+      if (t >= last) {
+        index = last;
+      } else if (t > 0) {
+        index = static_cast<int>(t + 0.5);
+      }
+      const unsigned char* color = colors + 3 * index;
+      unsigned char* out = rgb + 3 * i;
+      out[0] = color[0];
+      out[1] = color[1];
+      out[2] = color[2];
+    }
+  });
+}
+}
+
+/// Maps one image of the tilt series on the PipelineScheduler. Nothing is
+/// computed once the color map has changed again. A slice of the ring that
+/// has left it is skipped too, and reported with a null frame.
+class FramePrefetcher::FrameJob : public QObject, public QRunnable
+{
+  Q_OBJECT
+
+public:
+  FrameJob(vtkImageData* tiltSeries, int slice, bool ring,
+           QSharedPointer<const ColorTable> table, int generation,
+           QSharedPointer<Request> latest)
+    : m_tiltSeries(tiltSeries), m_slice(slice), m_ring(ring), m_table(table),
+      m_generation(generation), m_latest(latest)
+  {
+  }
+
+  void run() override
+  {
+    if (m_latest->generation.load() != m_generation) {
+      return;
+    }
+    vtkSmartPointer<vtkImageData> frame;
+    if (!m_ring || m_latest->inRing(m_slice)) {
+      frame = FramePrefetcher::mapSlice(m_tiltSeries, m_slice, *m_table);
+    }
+    emit computed(m_slice, m_generation, frame);
+  }
+
+signals:
+  void computed(int slice, int generation,
+                vtkSmartPointer<vtkImageData> frame);
+
+private:
+  vtkSmartPointer<vtkImageData> m_tiltSeries;
+  int m_slice;
+  bool m_ring;
+  QSharedPointer<const ColorTable> m_table;
+  int m_generation;
+  QSharedPointer<Request> m_latest;
+};
+
+FramePrefetcher::FramePrefetcher(vtkImageData* tiltSeries, DataSource* source,
+                                 QObject* p)
+  : QObject(p), m_tiltSeries(tiltSeries), m_source(source),
+    m_request(new Request)
+{
+  qRegisterMetaType<vtkSmartPointer<vtkImageData>>();
+  int extent[6];
+  tiltSeries->GetExtent(extent);
+  m_minSlice = extent[4];
+  m_maxSlice = extent[5];
+  m_request->count = m_maxSlice - m_minSlice + 1;
+}
+
+FramePrefetcher::~FramePrefetcher() = default;
+
+void FramePrefetcher::setRadius(int radius)
+{
+  m_radius = std::max(radius, 0);
+  prefetch();
+}
+
+void FramePrefetcher::setLookupTable(vtkScalarsToColors* lut)
+{
+  if (!lut || (lut == m_lut && lut->GetMTime() == m_tableTime)) {
+    return;
+  }
+  m_lut = lut;
+  m_tableTime = lut->GetMTime();
+  m_table = QSharedPointer<const ColorTable>(new ColorTable(colorTable(lut)));
+  m_request->generation.store(++m_generation);
+  m_frames.clear();
+  prefetch();
+}
+
+void FramePrefetcher::setCurrent(int slice, const QList<int>& extra)
+{
+  if (slice == m_current && extra == m_extra) {
+    return;
+  }
+  m_current = slice;
+  m_extra = extra;
+  prefetch();
+}
+
+vtkImageData* FramePrefetcher::frame(int slice) const
+{
+  return m_frames.value(slice);
+}
+
+FramePrefetcher::ColorTable FramePrefetcher::colorTable(
+  vtkScalarsToColors* lut, int size)
+{
+  ColorTable table;
+  double* range = lut->GetRange();
+  table.range[0] = range[0];
+  table.range[1] = range[1];
+
+  size = std::max(size, 2);
+  vtkNew<vtkDoubleArray> ramp;
+  ramp->SetNumberOfTuples(size);
+  for (int i = 0; i < size; ++i) {
+    ramp->SetValue(i, range[0] + (range[1] - range[0]) * i / (size - 1));
+  }
+  vtkSmartPointer<vtkUnsignedCharArray> colors;
+  colors.TakeReference(
+    lut->MapScalars(ramp.Get(), VTK_COLOR_MODE_MAP_SCALARS, -1));
+  table.rgb.resize(3 * size);
+  int components = colors->GetNumberOfComponents();
+  for (int i = 0; i < size; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      // Luminance tables give one or two components.
+      table.rgb[3 * i + c] =
+        colors->GetValue(i * components + std::min(c, components - 1));
+    }
+  }
+  return table;
+}
+
+vtkSmartPointer<vtkImageData> FramePrefetcher::mapSlice(
+  vtkImageData* tiltSeries, int slice, const ColorTable& table)
+{
+  int extent[6];
+  tiltSeries->GetExtent(extent);
+  extent[4] = extent[5] = slice;
+
+  auto frame = vtkSmartPointer<vtkImageData>::New();
+  frame->SetOrigin(tiltSeries->GetOrigin());
+  frame->SetSpacing(tiltSeries->GetSpacing());
+  frame->SetExtent(extent);
+  frame->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+
+  vtkIdType count = static_cast<vtkIdType>(extent[1] - extent[0] + 1) *
+                    (extent[3] - extent[2] + 1);
+  auto rgb = static_cast<unsigned char*>(frame->GetScalarPointer());
+  void* values = tiltSeries->GetScalarPointer(extent[0], extent[2], slice);
+  switch (tiltSeries->GetScalarType()) {
+    vtkTemplateMacro(
+      mapValues(static_cast<VTK_TT*>(values), count, table, rgb));
+  }
+  return frame;
+}
+
+void FramePrefetcher::frameComputed(int slice, int generation,
+                                    vtkSmartPointer<vtkImageData> frame)
+{
+  if (m_pending.value(slice, -1) == generation) {
+    m_pending.remove(slice);
+  }
+  if (generation != m_generation || !wantedSlices().contains(slice)) {
+    return;
+  }
+  if (!frame) {
+    // Skipped while out of the ring, which has come back to it since.
+    prefetch();
+    return;
+  }
+  m_frames[slice] = frame;
+  emit frameReady(slice);
+}
+
+QList<int> FramePrefetcher::wantedSlices() const
+{
+  QList<int> slices;
+  if (m_current < 0) {
+    return slices;
+  }
+  int count = m_maxSlice - m_minSlice + 1;
+  auto wrap = [this, count](int slice) {
+    return m_minSlice + ((slice - m_minSlice) % count + count) % count;
+  };
+  slices << wrap(m_current);
+  for (int slice : m_extra) {
+    if (!slices.contains(wrap(slice))) {
+      slices << wrap(slice);
+    }
+  }
+  for (int d = 1; d <= m_radius; ++d) {
+    for (int slice : { wrap(m_current + d), wrap(m_current - d) }) {
+      if (!slices.contains(slice)) {
+        slices << slice;
+      }
+    }
+  }
+  return slices;
+}
+
+void FramePrefetcher::prefetch()
+{
+  m_request->current.store(m_current);
+  m_request->radius.store(m_radius);
+  QList<int> wanted = wantedSlices();
+  for (int slice : m_frames.keys()) {
+    if (!wanted.contains(slice)) {
+      m_frames.remove(slice);
+    }
+  }
+  if (!m_table) {
+    return;
+  }
+
+  int important = 1 + m_extra.size();
+  for (int i = 0; i < wanted.size(); ++i) {
+    int slice = wanted[i];
+    if (m_frames.contains(slice) ||
+        m_pending.value(slice, -1) == m_generation) {
+      continue;
+    }
+    m_pending[slice] = m_generation;
+    // The current slice and the extra ones come first, then the ring.
+    bool ring = i == 0 || i >= important;
+    auto job = new FrameJob(m_tiltSeries, slice, ring, m_table, m_generation,
+                            m_request);
+    connect(job, &FrameJob::computed, this, &FramePrefetcher::frameComputed);
+    // The images on screen come before the rest of the ring.
+    PipelineScheduler::instance().submit(
+      job, m_source, i < important ? PipelineScheduler::Priority::Interactive
+                                   : PipelineScheduler::Priority::Normal);
+  }
+}
+}
+
+#include "FramePrefetcher.moc"
@@ -0,0 +1,127 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizFramePrefetcher_h
+#define tomvizFramePrefetcher_h
+
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+
+#include <vector>
+
+class vtkImageData;
+class vtkScalarsToColors;
+
+namespace tomviz {
+
+class DataSource;
+
+/// Keeps a ring of display ready frames around the current image of a tilt
+/// series, for the playback of the AlignWidget. A frame is one image mapped to
+/// RGB through a snapshot of the color map, so showing it is a texture upload
+/// rather than a reslice and a color mapping of the whole image. The frames
+/// are computed on the PipelineScheduler ahead of the current image.
+///
+/// The frames have the geometry of their slice in the tilt series, the
+/// alignment offsets are left to the position of the actor showing them.
+class FramePrefetcher : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// The colors of a snapshot of a lookup table, size RGB triplets spread
+  /// evenly over range.
+  struct ColorTable
+  {
+    std::vector<unsigned char> rgb;
+    double range[2] = { 0, 1 };
+
+    int size() const { return static_cast<int>(rgb.size() / 3); }
+  };
+
+  FramePrefetcher(vtkImageData* tiltSeries, DataSource* source,
+                  QObject* parent = nullptr);
+  ~FramePrefetcher() override;
+
+  /// The number of images kept on each side of the current image, 2 by
+  /// default. The ring wraps around like the slices of the AlignWidget.
+  void setRadius(int radius);
+  int radius() const { return m_radius; }
+
+  /// Map the frames through lut. The frames are computed again when lut has
+  /// been modified since the last call, which is cheap otherwise.
+  void setLookupTable(vtkScalarsToColors* lut);
+
+  /// Move the ring to slice. The extra slices, e.g. the reference image, are
+  /// kept along with the ring and the frames outside of both are released.
+  void setCurrent(int slice, const QList<int>& extra = QList<int>());
+
+  /// Returns the frame of slice, nullptr if it isn't ready yet.
+  vtkImageData* frame(int slice) const;
+
+  /// Sample lut over its range.
+  static ColorTable colorTable(vtkScalarsToColors* lut, int size = 1024);
+
+  /// Map one image of tiltSeries through table. Values outside of the table
+  /// range get the color of the nearest end.
+  static vtkSmartPointer<vtkImageData> mapSlice(vtkImageData* tiltSeries,
+                                                int slice,
+                                                const ColorTable& table);
+
+signals:
+  /// Emitted when the frame of slice becomes available.
+  void frameReady(int slice);
+
+private:
+  Q_DISABLE_COPY(FramePrefetcher)
+
+  class FrameJob;
+  struct Request;
+
+  void frameComputed(int slice, int generation,
+                     vtkSmartPointer<vtkImageData> frame);
+  // The slices to keep, most wanted first.
+  QList<int> wantedSlices() const;
+  void prefetch();
+
+  vtkSmartPointer<vtkImageData> m_tiltSeries;
+  QPointer<DataSource> m_source;
+  int m_minSlice = 0;
+  int m_maxSlice = 0;
+  int m_radius = 2;
+  int m_current = -1;
+  QList<int> m_extra;
+
+  QSharedPointer<const ColorTable> m_table;
+  vtkMTimeType m_tableTime = 0;
+  vtkScalarsToColors* m_lut = nullptr;
+  // Frames computed with an older table are dropped when they arrive.
+  int m_generation = 0;
+  // The latest generation and ring, shared with the jobs.
+  QSharedPointer<Request> m_request;
+
+  QMap<int, vtkSmartPointer<vtkImageData>> m_frames;
+  // The generation each pending slice was requested with.
+  QMap<int, int> m_pending;
+};
+}
+
+#endif
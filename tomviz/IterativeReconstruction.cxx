@@ -0,0 +1,182 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "IterativeReconstruction.h"
+
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace tomviz {
+
+IterativeReconstruction::IterativeReconstruction(const Projector& projector,
+                                                 Method method)
+  : m_projector(projector), m_method(method)
+{
+  m_rowWeights.assign(m_projector.rows(), 0.0);
+  std::vector<double> norms;
+  switch (m_method) {
+    case Method::Landweber:
+      std::fill(m_rowWeights.begin(), m_rowWeights.end(), 1.0);
+      return;
+    case Method::Cimmino:
+    case Method::ART:
+      norms = m_projector.rowSquaredNorms();
+      break;
+    case Method::ComponentAveraging:
+      // Rows weighted by the number of rays through each of their pixels
+      norms = m_projector.rowSquaredNorms(m_projector.columnCounts());
+      break;
+  }
+  for (int r = 0; r < m_projector.rows(); ++r) {
+    m_rowWeights[r] = norms[r] > 0 ? 1.0 / norms[r] : 0.0;
+  }
+}
+
+void IterativeReconstruction::iterate(const float* b, float* f,
+                                      double relaxation, int count) const
+{
+  if (m_method == Method::ART) {
+    std::vector<double> scales(count);
+    for (int r = 0; r < m_projector.rows(); ++r) {
+      if (m_rowWeights[r] > 0) {
+        m_projector.dot(r, f, &scales[0], count);
+        const float* rays = b + static_cast<size_t>(r) * count;
+        for (int k = 0; k < count; ++k) {
+          scales[k] = (rays[k] - scales[k]) * m_rowWeights[r] * relaxation;
+        }
+        m_projector.addRow(r, &scales[0], f, count);
+      }
+    }
+    return;
+  }
+
+  // f += relaxation * A^T W (b - A f), all the rays at once
+  size_t rays = static_cast<size_t>(m_projector.rows()) * count;
+  std::vector<float> residual(rays);
+  m_projector.forward(f, &residual[0], count);
+  for (size_t n = 0; n < rays; ++n) {
+    residual[n] =
+      static_cast<float>((b[n] - residual[n]) * m_rowWeights[n / count]);
+  }
+  if (m_method == Method::Cimmino) {
+    relaxation /= m_projector.rows();
+  }
+  size_t pixels = static_cast<size_t>(m_projector.columns()) * count;
+  std::vector<float> update(pixels);
+  m_projector.back(&residual[0], &update[0], count);
+  for (size_t n = 0; n < pixels; ++n) {
+    f[n] += static_cast<float>(relaxation * update[n]);
+  }
+}
+
+namespace {
+
+// The voxel at (i, j, k) with the indices clamped to the volume, as numpy's
+// edge padding does.
+class ClampedVolume
+{
+public:
+  ClampedVolume(const float* data, const int dims[3]) : m_data(data)
+  {
+    std::copy(dims, dims + 3, m_dims);
+  }
+
+  float operator()(int i, int j, int k) const
+  {
+    i = std::min(std::max(i, 0), m_dims[0] - 1);
+    j = std::min(std::max(j, 0), m_dims[1] - 1);
+    k = std::min(std::max(k, 0), m_dims[2] - 1);
+    return m_data[(static_cast<size_t>(i) * m_dims[1] + j) * m_dims[2] + k];
+  }
+
+private:
+  const float* m_data;
+  int m_dims[3];
+};
+
+// The derivative of the (smoothed) total variation with respect to r(i, j, k)
+double totalVariationGradient(const ClampedVolume& r, int i, int j, int k)
+{
+  const double epsilon = 1e-8;
+  auto square = [](double value) { return value * value; };
+
+  double center = r(i, j, k);
+  double di = r(i - 1, j, k);
+  double dj = r(i, j - 1, k);
+  double dk = r(i, j, k - 1);
+  double v = (3 * center - di - dj - dk) /
+             std::sqrt(epsilon + square(center - di) + square(center - dj) +
+                       square(center - dk));
+
+  double ni = r(i + 1, j, k);
+  v += (center - ni) /
+       std::sqrt(epsilon + square(ni - center) +
+                 square(ni - r(i + 1, j - 1, k)) +
+                 square(ni - r(i + 1, j, k - 1)));
+
+  double nj = r(i, j + 1, k);
+  v += (center - nj) /
+       std::sqrt(epsilon + square(nj - r(i - 1, j + 1, k)) +
+                 square(nj - center) + square(nj - r(i, j + 1, k - 1)));
+
+  double nk = r(i, j, k + 1);
+  v += (center - nk) /
+       std::sqrt(epsilon + square(nk - r(i - 1, j, k + 1)) +
+                 square(nk - r(i, j - 1, k + 1)) + square(nk - center));
+  return v;
+}
+}
+
+void minimizeTotalVariation(float* volume, const int dims[3], int iterations,
+                            double alpha)
+{
+  size_t sliceSize = static_cast<size_t>(dims[1]) * dims[2];
+  std::vector<float> gradient(sliceSize * dims[0]);
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    ClampedVolume r(volume, dims);
+    vtkSMPThreadLocal<double> squaredNorms(0.0);
+    vtkSMPTools::For(0, dims[0], [&](vtkIdType begin, vtkIdType end) {
+      double& squaredNorm = squaredNorms.Local();
+      for (vtkIdType i = begin; i < end; ++i) {
+        float* slice = &gradient[i * sliceSize];
+        for (int j = 0; j < dims[1]; ++j) {
+          for (int k = 0; k < dims[2]; ++k) {
+            double v = totalVariationGradient(r, i, j, k);
+            slice[j * dims[2] + k] = static_cast<float>(v);
+            squaredNorm += v * v;
+          }
+        }
+      }
+    });
+
+    double squaredNorm = 0;
+    for (double value : squaredNorms) {
+      squaredNorm += value;
+    }
+    if (squaredNorm <= 0) {
+      return;
+    }
+    float scale = static_cast<float>(alpha / std::sqrt(squaredNorm));
+    vtkSMPTools::For(0, dims[0], [&](vtkIdType begin, vtkIdType end) {
+      for (size_t n = begin * sliceSize; n < end * sliceSize; ++n) {
+        volume[n] -= scale * gradient[n];
+      }
+    });
+  }
+}
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizIterativeReconstruction_h
+#define tomvizIterativeReconstruction_h
+
+#include "Projector.h"
+
+#include <vector>
+
+namespace tomviz {
+
+/// Iterative reconstruction of the slices of a tilt series, the native
+/// counterpart of Recon_SIRT.py and Recon_ART.py. It is built once from the
+/// projector shared by all the slices (a ProjectionMatrix or, for large sizes,
+/// a matrix free ParallelProjector) and is read only afterwards, so several
+/// slices can be reconstructed in parallel.
+class IterativeReconstruction
+{
+public:
+  enum class Method
+  {
+    /// SIRT updates, L. Landweber, Amer. J. Math., 73 (1951), pp. 615–624
+    Landweber,
+    /// G. Cimmino, La Ric. Sci., XVI, Ser. II, Anno IX, 1 (1938), pp. 326–333
+    Cimmino,
+    /// Y. Censor et al, Parallel Comput., 27 (2001), pp. 777–808
+    ComponentAveraging,
+    /// Algebraic Reconstruction Technique (Kaczmarz), one ray at a time
+    ART
+  };
+
+  /// The projector must outlive the reconstruction, it is not copied.
+  IterativeReconstruction(const Projector& projector, Method method);
+
+  Method method() const { return m_method; }
+
+  /// Run one iteration on the slice f given its sinogram b, stored as
+  /// [tilt][ray]. The relaxation is the step size of the SIRT methods and the
+  /// relaxation parameter (beta) of ART.
+  ///
+  /// With count > 1, iterate on that many slices at once, interleaved as
+  /// described in Projector. Each entry of the projector is then loaded once
+  /// for all the slices instead of once per slice.
+  void iterate(const float* b, float* f, double relaxation,
+               int count = 1) const;
+
+private:
+  const Projector& m_projector;
+  Method m_method;
+  // 1 / weight of the residual of each ray, 0 for rays outside of the slice.
+  std::vector<double> m_rowWeights;
+};
+
+/// Total variation minimization of a volume stored as [slice][y][z], the
+/// gradient descent of Recon_TV_minimization.py: iterations steps of size
+/// alpha along the normalized TV gradient. Uses vtkSMPTools.
+void minimizeTotalVariation(float* volume, const int dims[3], int iterations,
+                            double alpha);
+}
+
+#endif
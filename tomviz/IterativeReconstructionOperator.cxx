@@ -0,0 +1,435 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "IterativeReconstructionOperator.h"
+
+#include "DataSource.h"
+#include "EditOperatorWidget.h"
+#include "IterativeReconstruction.h"
+#include "OperatorWidget.h"
+#include "ParallelProjector.h"
+#include "ProjectionMatrix.h"
+#include "TomographyTiltSeries.h"
+#include "Utilities.h"
+
+#include <pqSMProxy.h>
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkSMProxyManager.h>
+#include <vtkSMSessionProxyManager.h>
+#include <vtkSMSourceProxy.h>
+#include <vtkTrivialProducer.h>
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QTime>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Above this size the projection matrix isn't stored, the projections are
+// computed on the fly instead.
+const double maxProjectionMatrixBytes = 1024.0 * 1024.0 * 1024.0;
+
+// The slices are reconstructed in blocks of this many, interleaved so that
+// each entry of the projector is loaded once for the whole block.
+const int sliceBlockSize = 8;
+
+// The sinograms of slices [first, first + count), interleaved.
+std::vector<float> interleavedSinograms(
+  const tomviz::TomographyTiltSeries::SinogramStack& sinograms, int first,
+  int count)
+{
+  std::vector<const float*> slices;
+  for (int k = 0; k < count; ++k) {
+    slices.push_back(sinograms.sinogram(first + k));
+  }
+  size_t size =
+    static_cast<size_t>(sinograms.numberOfTilts()) * sinograms.numberOfRays();
+  std::vector<float> result(size * count);
+  tomviz::interleaveSlices(&slices[0], count, size, &result[0]);
+  return result;
+}
+
+class EditIterativeReconstructionWidget : public tomviz::EditOperatorWidget
+{
+  Q_OBJECT
+
+public:
+  EditIterativeReconstructionWidget(
+    tomviz::IterativeReconstructionOperator* source, QWidget* p)
+    : tomviz::EditOperatorWidget(p), m_operator(source)
+  {
+    m_widget = new tomviz::OperatorWidget(this);
+    m_widget->setupUI(source->JSONDescription(), source->arguments());
+    QVBoxLayout* layout = new QVBoxLayout;
+    layout->addWidget(m_widget);
+    setLayout(layout);
+  }
+
+  void applyChangesToOperator() override
+  {
+    if (m_operator) {
+      m_operator->setArguments(m_widget->values());
+    }
+  }
+
+private:
+  QPointer<tomviz::IterativeReconstructionOperator> m_operator;
+  tomviz::OperatorWidget* m_widget;
+};
+
+// The Python operator the algorithm replaces
+QString scriptName(tomviz::IterativeReconstructionOperator::Algorithm algorithm)
+{
+  switch (algorithm) {
+    case tomviz::IterativeReconstructionOperator::Algorithm::ART:
+      return "Recon_ART";
+    case tomviz::IterativeReconstructionOperator::Algorithm::TV:
+      return "Recon_TV_minimization";
+    case tomviz::IterativeReconstructionOperator::Algorithm::SIRT:
+      break;
+  }
+  return "Recon_SIRT";
+}
+}
+
+#include "IterativeReconstructionOperator.moc"
+
+namespace tomviz {
+
+IterativeReconstructionOperator::IterativeReconstructionOperator(
+  Algorithm algorithm, QObject* p)
+  : Operator(p), m_algorithm(algorithm),
+    m_iterations(algorithm == Algorithm::SIRT ? 10 : 1)
+{
+  setSupportsCancel(true);
+  setHasChildDataSource(true);
+  connect(this, &IterativeReconstructionOperator::newChildDataSource, this,
+          &IterativeReconstructionOperator::createNewChildDataSource);
+}
+
+QString IterativeReconstructionOperator::label() const
+{
+  switch (m_algorithm) {
+    case Algorithm::ART:
+      return "Reconstruct (ART)";
+    case Algorithm::TV:
+      return "Reconstruct (TV Minimization)";
+    case Algorithm::SIRT:
+      break;
+  }
+  return "Reconstruct (SIRT)";
+}
+
+QIcon IterativeReconstructionOperator::icon() const
+{
+  return QIcon(":/pqWidgets/Icons/pqExtractGrid24.png");
+}
+
+Operator* IterativeReconstructionOperator::clone() const
+{
+  auto op = new IterativeReconstructionOperator(m_algorithm);
+  op->setArguments(arguments());
+  return op;
+}
+
+bool IterativeReconstructionOperator::serialize(pugi::xml_node& ns) const
+{
+  ns.append_attribute("algorithm").set_value(static_cast<int>(m_algorithm));
+  ns.append_attribute("Niter").set_value(m_iterations);
+  ns.append_attribute("stepSize").set_value(m_stepSize);
+  ns.append_attribute("updateMethodIndex").set_value(m_updateMethod);
+  return true;
+}
+
+bool IterativeReconstructionOperator::deserialize(const pugi::xml_node& ns)
+{
+  int algorithm = ns.attribute("algorithm").as_int(0);
+  if (algorithm < static_cast<int>(Algorithm::SIRT) ||
+      algorithm > static_cast<int>(Algorithm::TV)) {
+    qWarning() << "Unknown iterative reconstruction" << algorithm;
+    return false;
+  }
+  m_algorithm = static_cast<Algorithm>(algorithm);
+  m_iterations = ns.attribute("Niter").as_int(m_iterations);
+  m_stepSize = ns.attribute("stepSize").as_double(m_stepSize);
+  m_updateMethod = ns.attribute("updateMethodIndex").as_int(m_updateMethod);
+  return true;
+}
+
+EditOperatorWidget* IterativeReconstructionOperator::getEditorContents(
+  QWidget* p)
+{
+  return new EditIterativeReconstructionWidget(this, p);
+}
+
+QString IterativeReconstructionOperator::JSONDescription() const
+{
+  return readInJSONDescription(scriptName(m_algorithm));
+}
+
+QMap<QString, QVariant> IterativeReconstructionOperator::arguments() const
+{
+  QMap<QString, QVariant> values;
+  values["Niter"] = m_iterations;
+  if (m_algorithm == Algorithm::SIRT) {
+    values["stepSize"] = m_stepSize;
+    values["updateMethodIndex"] = m_updateMethod;
+  }
+  return values;
+}
+
+void IterativeReconstructionOperator::setArguments(
+  const QMap<QString, QVariant>& values)
+{
+  m_iterations = values.value("Niter", m_iterations).toInt();
+  m_stepSize = values.value("stepSize", m_stepSize).toDouble();
+  m_updateMethod = values.value("updateMethodIndex", m_updateMethod).toInt();
+  emit transformModified();
+}
+
+void IterativeReconstructionOperator::updateProgress(int step,
+                                                     const QString& message)
+{
+  QMutexLocker locker(&m_progressMutex);
+  QString estimate = "n/a";
+  int done = step - m_firstTimedStep;
+  if (done > 0) {
+    qint64 left =
+      m_timer.elapsed() / done * (totalProgressSteps() - step) / 1000;
+    estimate = QTime(0, 0).addSecs(static_cast<int>(left)).toString("hh:mm:ss");
+  }
+  setProgressMessage(message + " Estimated time to complete: " + estimate);
+  setProgressStep(step);
+}
+
+bool IterativeReconstructionOperator::applyTransform(vtkDataObject* dataObject)
+{
+  auto imageData = vtkImageData::SafeDownCast(dataObject);
+  if (!imageData) {
+    return false;
+  }
+
+  int extent[6];
+  imageData->GetExtent(extent);
+  int numSlices = extent[1] - extent[0] + 1;
+  int numRays = extent[3] - extent[2] + 1;
+  int numTilts = extent[5] - extent[4] + 1;
+
+  std::vector<double> tiltAngles;
+  vtkDataArray* tiltAnglesArray =
+    dataObject->GetFieldData()->GetArray("tilt_angles");
+  if (tiltAnglesArray) {
+    for (vtkIdType i = 0; i < tiltAnglesArray->GetNumberOfTuples(); ++i) {
+      tiltAngles.push_back(tiltAnglesArray->GetTuple1(i));
+    }
+  }
+  if (static_cast<int>(tiltAngles.size()) < numTilts) {
+    qWarning() << "Incorrect number of tilt angles. There are"
+               << tiltAngles.size() << "and there should be" << numTilts;
+    return false;
+  }
+  tiltAngles.resize(numTilts);
+
+  // The matrix counts as a step of the SIRT progress, like in Recon_SIRT.py
+  int firstStep = m_algorithm == Algorithm::SIRT ? 1 : 0;
+  setTotalProgressSteps(m_algorithm == Algorithm::TV ? m_iterations
+                                                     : numSlices + firstStep);
+  setProgressStep(0);
+  setProgressMessage("Generating measurement matrix");
+  // About 2 Nray entries per ray, each a float value and an int column
+  double matrixBytes = 2.0 * numRays * numRays * numTilts * 8;
+  QScopedPointer<Projector> projector;
+  if (matrixBytes > maxProjectionMatrixBytes) {
+    projector.reset(
+      new ParallelProjector(numRays, 1.0, tiltAngles, numRays, 1.0));
+  } else {
+    projector.reset(new ProjectionMatrix(
+      ProjectionMatrix::parallelRay(numRays, 1.0, tiltAngles, numRays, 1.0)));
+  }
+  TomographyTiltSeries::SinogramStack sinograms(imageData);
+  if (isCanceled()) {
+    return false;
+  }
+
+  // The reconstruction as [slice][y][z], each slice is the image of
+  // Nray by Nray pixels of the projector.
+  size_t sliceSize = static_cast<size_t>(numRays) * numRays;
+  std::vector<float> recon(sliceSize * numSlices, 0.0f);
+  m_timer.start();
+  m_firstTimedStep = firstStep;
+  setProgressStep(firstStep);
+
+  if (m_algorithm == Algorithm::TV) {
+    // Alternate ART and positivity (the POCS step) with a TV minimization
+    // scaled by the change the POCS step made.
+    const int tvIterations = 30;
+    const double alpha = 0.2;
+    const double betaReduction = 0.995;
+    double beta = 1.0;
+    IterativeReconstruction art(*projector,
+                                IterativeReconstruction::Method::ART);
+    std::vector<float> previous;
+    int dims[3] = { numSlices, numRays, numRays };
+    int numBlocks = (numSlices + sliceBlockSize - 1) / sliceBlockSize;
+    std::vector<std::vector<float>> blockSinograms(numBlocks);
+    vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType block = begin; block < end; ++block) {
+        int first = block * sliceBlockSize;
+        int count = std::min(sliceBlockSize, numSlices - first);
+        blockSinograms[block] = interleavedSinograms(sinograms, first, count);
+      }
+    });
+    for (int i = 0; i < m_iterations; ++i) {
+      if (isCanceled()) {
+        return false;
+      }
+      previous = recon;
+      vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+        std::vector<float> slices(sliceSize * sliceBlockSize);
+        for (vtkIdType block = begin; block < end && !isCanceled(); ++block) {
+          int first = block * sliceBlockSize;
+          int count = std::min(sliceBlockSize, numSlices - first);
+          std::vector<float*> reconSlices;
+          for (int k = 0; k < count; ++k) {
+            reconSlices.push_back(&recon[(first + k) * sliceSize]);
+          }
+          interleaveSlices(&reconSlices[0], count, sliceSize, &slices[0]);
+          art.iterate(&blockSinograms[block][0], &slices[0], beta, count);
+          for (size_t n = 0; n < sliceSize * count; ++n) {
+            slices[n] = std::max(slices[n], 0.0f);
+          }
+          deinterleaveSlices(&slices[0], count, sliceSize, &reconSlices[0]);
+        }
+      });
+
+      double change = 0;
+      for (size_t n = 0; n < recon.size(); ++n) {
+        double difference = recon[n] - previous[n];
+        change += difference * difference;
+      }
+      minimizeTotalVariation(&recon[0], dims, tvIterations,
+                             alpha * std::sqrt(change));
+      beta *= betaReduction;
+      updateProgress(i + 1, QString("Iteration No.%1/%2.")
+                              .arg(i + 1)
+                              .arg(m_iterations));
+    }
+  } else {
+    auto method = IterativeReconstruction::Method::ART;
+    if (m_algorithm == Algorithm::SIRT) {
+      const IterativeReconstruction::Method methods[] = {
+        IterativeReconstruction::Method::Landweber,
+        IterativeReconstruction::Method::Cimmino,
+        IterativeReconstruction::Method::ComponentAveraging
+      };
+      if (m_updateMethod < 0 || m_updateMethod > 2) {
+        qWarning() << "Invalid update method" << m_updateMethod;
+        return false;
+      }
+      method = methods[m_updateMethod];
+    }
+    double relaxation = m_algorithm == Algorithm::SIRT ? m_stepSize : 1.0;
+    IterativeReconstruction reconstruction(*projector, method);
+    std::atomic<int> slicesDone(0);
+    int numBlocks = (numSlices + sliceBlockSize - 1) / sliceBlockSize;
+    vtkSMPTools::For(0, numBlocks, [&](vtkIdType begin, vtkIdType end) {
+      std::vector<float> slices(sliceSize * sliceBlockSize);
+      for (vtkIdType block = begin; block < end && !isCanceled(); ++block) {
+        int first = block * sliceBlockSize;
+        int count = std::min(sliceBlockSize, numSlices - first);
+        auto b = interleavedSinograms(sinograms, first, count);
+        std::fill(slices.begin(), slices.end(), 0.0f);
+        for (int i = 0; i < m_iterations && !isCanceled(); ++i) {
+          reconstruction.iterate(&b[0], &slices[0], relaxation, count);
+        }
+        std::vector<float*> reconSlices;
+        for (int k = 0; k < count; ++k) {
+          reconSlices.push_back(&recon[(first + k) * sliceSize]);
+        }
+        deinterleaveSlices(&slices[0], count, sliceSize, &reconSlices[0]);
+        int done = slicesDone += count;
+        updateProgress(firstStep + done,
+                       QString("Slice No.%1/%2.").arg(done).arg(numSlices));
+      }
+    });
+  }
+  if (isCanceled()) {
+    return false;
+  }
+
+  // Pixel (y, z) of slice s goes to voxel (s, y, z)
+  vtkNew<vtkImageData> reconstructionImage;
+  int extent2[6] = { extent[0], extent[1], extent[2],
+                     extent[3], extent[2], extent[3] };
+  reconstructionImage->SetExtent(extent2);
+  reconstructionImage->AllocateScalars(VTK_FLOAT, 1);
+  vtkDataArray* darray = reconstructionImage->GetPointData()->GetScalars();
+  darray->SetName("scalars");
+  float* output = static_cast<float*>(darray->GetVoidPointer(0));
+  for (int z = 0; z < numRays; ++z) {
+    for (int y = 0; y < numRays; ++y) {
+      for (int s = 0; s < numSlices; ++s) {
+        output[(static_cast<size_t>(z) * numRays + y) * numSlices + s] =
+          recon[s * sliceSize + y * numRays + z];
+      }
+    }
+  }
+
+  emit newChildDataSource("Reconstruction", reconstructionImage.Get());
+  return true;
+}
+
+void IterativeReconstructionOperator::createNewChildDataSource(
+  const QString& label, vtkSmartPointer<vtkDataObject> childData)
+{
+  vtkSMProxyManager* proxyManager = vtkSMProxyManager::GetProxyManager();
+  vtkSMSessionProxyManager* sessionProxyManager =
+    proxyManager->GetActiveSessionProxyManager();
+
+  pqSMProxy producerProxy;
+  producerProxy.TakeReference(
+    sessionProxyManager->NewProxy("sources", "TrivialProducer"));
+  producerProxy->UpdateVTKObjects();
+
+  vtkTrivialProducer* producer =
+    vtkTrivialProducer::SafeDownCast(producerProxy->GetClientSideObject());
+  if (!producer) {
+    qWarning() << "Could not get TrivialProducer from proxy";
+    return;
+  }
+
+  producer->SetOutput(childData);
+
+  DataSource* childDS = new DataSource(
+    vtkSMSourceProxy::SafeDownCast(producerProxy), DataSource::Volume, this,
+    DataSource::PersistenceState::Transient);
+
+  childDS->setFilename(label.toLatin1().data());
+  setChildDataSource(childDS);
+}
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizIterativeReconstructionOperator_h
+#define tomvizIterativeReconstructionOperator_h
+
+#include "Operator.h"
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QVariant>
+
+namespace tomviz {
+
+/// Native SIRT, ART and TV minimization reconstructions, taking the same
+/// parameters as the Recon_SIRT, Recon_ART and Recon_TV_minimization Python
+/// operators. The projection matrix is built once per reconstruction and
+/// shared by the slices, which are reconstructed in parallel. The
+/// reconstruction becomes a child data source.
+class IterativeReconstructionOperator : public Operator
+{
+  Q_OBJECT
+
+public:
+  enum class Algorithm
+  {
+    SIRT,
+    ART,
+    TV
+  };
+
+  IterativeReconstructionOperator(Algorithm algorithm = Algorithm::SIRT,
+                                  QObject* parent = nullptr);
+
+  QString label() const override;
+  QIcon icon() const override;
+  Operator* clone() const override;
+
+  bool serialize(pugi::xml_node& ns) const override;
+  bool deserialize(const pugi::xml_node& ns) override;
+
+  EditOperatorWidget* getEditorContents(QWidget* parent) override;
+  bool hasCustomUI() const override { return true; }
+  bool modifiesDataInPlace() const override { return false; }
+  bool supportsPreview() const override { return false; }
+
+  Algorithm algorithm() const { return m_algorithm; }
+
+  /// The JSON description of the parameters, the one of the Python operator.
+  QString JSONDescription() const;
+
+  /// The parameter values, named as in the JSON description (Niter, stepSize
+  /// and updateMethodIndex).
+  QMap<QString, QVariant> arguments() const;
+  void setArguments(const QMap<QString, QVariant>& arguments);
+
+protected:
+  bool applyTransform(vtkDataObject* data) override;
+
+signals:
+  // Signal used to request the creation of a new data source. Needed to
+  // ensure the initialization of the new DataSource is performed on UI thread
+  void newChildDataSource(const QString&, vtkSmartPointer<vtkDataObject>);
+
+private slots:
+  // Create a new child datasource and set it on this operator
+  void createNewChildDataSource(const QString& label,
+                                vtkSmartPointer<vtkDataObject>);
+
+private:
+  Q_DISABLE_COPY(IterativeReconstructionOperator)
+
+  // Report step out of the total steps, with the estimated time left in the
+  // message. Called from the threads reconstructing the slices.
+  void updateProgress(int step, const QString& message);
+
+  Algorithm m_algorithm;
+  int m_iterations;
+  double m_stepSize = 0.0001;
+  int m_updateMethod = 0;
+  QMutex m_progressMutex;
+  QElapsedTimer m_timer;
+  int m_firstTimedStep = 0;
+};
+}
+
+#endif
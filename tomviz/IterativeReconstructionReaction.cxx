@@ -0,0 +1,59 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "IterativeReconstructionReaction.h"
+
+#include "ActiveObjects.h"
+#include "DataSource.h"
+#include "OperatorDialog.h"
+
+#include <pqCoreUtilities.h>
+
+namespace tomviz {
+
+IterativeReconstructionReaction::IterativeReconstructionReaction(
+  QAction* parentObject, IterativeReconstructionOperator::Algorithm algorithm)
+  : pqReaction(parentObject), m_algorithm(algorithm)
+{
+  connect(&ActiveObjects::instance(), SIGNAL(dataSourceChanged(DataSource*)),
+          SLOT(updateEnableState()));
+  updateEnableState();
+}
+
+void IterativeReconstructionReaction::updateEnableState()
+{
+  DataSource* source = ActiveObjects::instance().activeDataSource();
+  parentAction()->setEnabled(source && source->type() == DataSource::TiltSeries);
+}
+
+void IterativeReconstructionReaction::recon(DataSource* input)
+{
+  input = input ? input : ActiveObjects::instance().activeDataSource();
+  if (!input) {
+    return;
+  }
+
+  auto op = new IterativeReconstructionOperator(m_algorithm);
+  OperatorDialog dialog(pqCoreUtilities::mainWidget());
+  dialog.setWindowTitle(op->label());
+  dialog.setJSONDescription(op->JSONDescription());
+  if (dialog.exec() != QDialog::Accepted) {
+    delete op;
+    return;
+  }
+  op->setArguments(dialog.values());
+  input->addOperator(op);
+}
+}
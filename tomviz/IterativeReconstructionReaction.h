@@ -0,0 +1,49 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizIterativeReconstructionReaction_h
+#define tomvizIterativeReconstructionReaction_h
+
+#include <pqReaction.h>
+
+#include "IterativeReconstructionOperator.h"
+
+namespace tomviz {
+class DataSource;
+
+/// Asks for the parameters and adds an IterativeReconstructionOperator to the
+/// active tilt series.
+class IterativeReconstructionReaction : public pqReaction
+{
+  Q_OBJECT
+
+public:
+  IterativeReconstructionReaction(
+    QAction* parent, IterativeReconstructionOperator::Algorithm algorithm);
+
+  void recon(DataSource* input = nullptr);
+
+protected:
+  void updateEnableState() override;
+  void onTriggered() override { recon(); }
+
+private:
+  Q_DISABLE_COPY(IterativeReconstructionReaction)
+
+  IterativeReconstructionOperator::Algorithm m_algorithm;
+};
+}
+
+#endif
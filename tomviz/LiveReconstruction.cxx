@@ -0,0 +1,199 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "LiveReconstruction.h"
+
+#include "BackProjectionKernels.h"
+
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// Copy the projection into its sinogram rows, one of Ny rays per x, averaging
+// bin by bin pixels. The pixels past the last whole bin are dropped.
+template <typename T>
+void copyRows(const T* data, int Nx, int bin, int nx, int ny, float* rows)
+{
+  std::fill(rows, rows + static_cast<size_t>(nx) * ny, 0.0f);
+  for (int y = 0; y < ny * bin; ++y) {
+    for (int x = 0; x < nx * bin; ++x) {
+      rows[static_cast<size_t>(x / bin) * ny + y / bin] +=
+        static_cast<float>(data[static_cast<size_t>(y) * Nx + x]);
+    }
+  }
+  if (bin > 1) {
+    float scale = 1.0f / (bin * bin);
+    for (size_t i = 0; i < static_cast<size_t>(nx) * ny; ++i) {
+      rows[i] *= scale;
+    }
+  }
+}
+}
+
+namespace tomviz {
+
+LiveReconstruction::LiveReconstruction(TomographyReconstruction::Filter filter)
+  : m_filter(filter)
+{
+}
+
+void LiveReconstruction::reset()
+{
+  m_volume = nullptr;
+  m_projections.clear();
+}
+
+bool LiveReconstruction::addProjection(vtkImageData* projection, double angle)
+{
+  if (!projection || !projection->GetPointData()->GetScalars()) {
+    return false;
+  }
+  vtkDataArray* scalars = projection->GetPointData()->GetScalars();
+  int dims[3];
+  projection->GetDimensions(dims);
+  if (dims[2] != 1 || dims[1] < 2 || scalars->GetNumberOfComponents() != 1) {
+    return false;
+  }
+  const int maximumSize = std::max(m_maximumSize, 2);
+  const int bin = (std::max(dims[0], dims[1]) + maximumSize - 1) / maximumSize;
+  const int Nx = dims[0] / bin;
+  const int Ny = dims[1] / bin;
+  if (Nx < 1 || Ny < 2) {
+    return false;
+  }
+
+  std::vector<float> rows(static_cast<size_t>(Nx) * Ny);
+  switch (scalars->GetDataType()) {
+    vtkTemplateMacro(copyRows(static_cast<VTK_TT*>(scalars->GetVoidPointer(0)),
+                              dims[0], bin, Nx, Ny, &rows[0]));
+    default:
+      return false;
+  }
+
+  int volumeDims[3] = { 0, 0, 0 };
+  if (m_volume) {
+    m_volume->GetDimensions(volumeDims);
+  }
+  if (volumeDims[0] != Nx || volumeDims[1] != Ny || m_bin != bin) {
+    reset();
+    m_bin = bin;
+    m_volume = vtkSmartPointer<vtkImageData>::New();
+    m_volume->SetDimensions(Nx, Ny, Ny);
+    m_volume->SetSpacing(bin, bin, bin);
+    m_volume->AllocateScalars(VTK_FLOAT, 1);
+    auto data = static_cast<float*>(m_volume->GetScalarPointer());
+    std::fill(data, data + static_cast<size_t>(Nx) * Ny * Ny, 0.0f);
+  }
+
+  // The rows of a range are filtered two at a time
+  vtkSMPTools::For(0, Nx, [&](vtkIdType begin, vtkIdType end) {
+    TomographyReconstruction::filterSinogram(&rows[begin * Ny], end - begin,
+                                             Ny, m_filter);
+  });
+
+  // Back projection is linear, a projection replacing a previous one at the
+  // same angle is added as the difference of the two.
+  std::vector<float> delta = rows;
+  auto previous = m_projections.find(angle);
+  if (previous != m_projections.end()) {
+    for (size_t i = 0; i < delta.size(); ++i) {
+      delta[i] -= previous->second[i];
+    }
+    previous->second.swap(rows);
+  } else {
+    m_projections[angle].swap(rows);
+  }
+
+  float cosine = static_cast<float>(std::cos(angle * pi / 180));
+  float sine = static_cast<float>(std::sin(angle * pi / 180));
+  float* volume = static_cast<float*>(m_volume->GetScalarPointer());
+  vtkSMPTools::For(0, Nx, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<float> image(static_cast<size_t>(Ny) * Ny);
+    for (vtkIdType x = begin; x < end; ++x) {
+      BackProjectionKernels::backProject(&delta[x * Ny], &cosine, &sine,
+                                         &image[0], 1, Ny);
+      // Pixel (y, z) of slice x is voxel (x, y, z)
+      for (int y = 0; y < Ny; ++y) {
+        for (int z = 0; z < Ny; ++z) {
+          volume[(static_cast<size_t>(z) * Ny + y) * Nx + x] +=
+            image[y * Ny + z];
+        }
+      }
+    }
+  });
+  m_volume->Modified();
+  return true;
+}
+
+float LiveReconstruction::scale() const
+{
+  // The normalization of TomographyReconstruction::unweightedBackProjection2,
+  // the binned voxels are bin times as long.
+  return static_cast<float>(pi / (2.0 * numberOfProjections() * m_bin));
+}
+
+vtkSmartPointer<vtkImageData> LiveReconstruction::reconstruction() const
+{
+  if (!m_volume) {
+    return nullptr;
+  }
+
+  auto result = vtkSmartPointer<vtkImageData>::New();
+  result->DeepCopy(m_volume);
+  result->GetPointData()->GetScalars()->SetName("scalars");
+
+  float scale = this->scale();
+  auto data = static_cast<float*>(result->GetScalarPointer());
+  vtkIdType size = result->GetNumberOfPoints();
+  vtkSMPTools::For(0, size, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i) {
+      data[i] *= scale;
+    }
+  });
+  return result;
+}
+
+vtkSmartPointer<vtkImageData> LiveReconstruction::centerSlice() const
+{
+  if (!m_volume) {
+    return nullptr;
+  }
+
+  int dims[3];
+  m_volume->GetDimensions(dims);
+  auto result = vtkSmartPointer<vtkImageData>::New();
+  result->SetDimensions(1, dims[1], dims[2]);
+  result->SetSpacing(m_volume->GetSpacing());
+  result->AllocateScalars(VTK_FLOAT, 1);
+  result->GetPointData()->GetScalars()->SetName("scalars");
+
+  float scale = this->scale();
+  auto volume = static_cast<float*>(m_volume->GetScalarPointer());
+  auto data = static_cast<float*>(result->GetScalarPointer());
+  const vtkIdType x = dims[0] / 2;
+  for (vtkIdType i = 0; i < static_cast<vtkIdType>(dims[1]) * dims[2]; ++i) {
+    data[i] = volume[i * dims[0] + x] * scale;
+  }
+  return result;
+}
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizLiveReconstruction_h
+#define tomvizLiveReconstruction_h
+
+#include "TomographyReconstruction.h"
+
+#include <vtkSmartPointer.h>
+
+#include <map>
+#include <vector>
+
+class vtkImageData;
+
+namespace tomviz {
+
+/// Reconstructs a tilt series while it is being acquired. Back projection is
+/// additive, so each projection is filtered and back projected into a running
+/// sum as soon as it arrives, and the sum is a weighted back projection of the
+/// projections received so far. The projections are Nx by Ny images with the
+/// tilt axis along x, the volume is Nx by Ny by Ny like the one of
+/// TomographyReconstruction::weightedBackProjection3().
+///
+/// Large projections are binned so that the volume stays small enough to be
+/// updated for every projection. The class is not thread safe, but may be
+/// used from any single thread at a time.
+class LiveReconstruction
+{
+public:
+  LiveReconstruction(TomographyReconstruction::Filter filter =
+                       TomographyReconstruction::Filter::Ramp);
+
+  /// Discard the projections added so far.
+  void reset();
+
+  /// Projections larger than size in either dimension are binned by the
+  /// smallest integer factor that brings both to at most size, 256 by
+  /// default. Takes effect on the next reconstruction.
+  void setMaximumSize(int size) { m_maximumSize = size; }
+  int maximumSize() const { return m_maximumSize; }
+
+  /// Back project a projection taken at angle (in degrees) into the volume,
+  /// using vtkSMPTools. A projection at an angle that already has one
+  /// replaces it, and a projection of a different size than the previous
+  /// ones starts a new reconstruction. Returns false if the image is not a 2D
+  /// image with scalars.
+  bool addProjection(vtkImageData* projection, double angle);
+
+  int numberOfProjections() const
+  {
+    return static_cast<int>(m_projections.size());
+  }
+
+  /// The running sum of the back projections, modified in place by
+  /// addProjection(). Null until the first projection is added.
+  vtkImageData* volume() const { return m_volume; }
+
+  /// A normalized copy of the volume, its spacing is the binning factor.
+  vtkSmartPointer<vtkImageData> reconstruction() const;
+
+  /// A normalized copy of the center slice of the volume across the tilt
+  /// axis, a 1 by Ny by Ny image.
+  vtkSmartPointer<vtkImageData> centerSlice() const;
+
+private:
+  // The factor from the running sum to the reconstruction.
+  float scale() const;
+
+  TomographyReconstruction::Filter m_filter;
+  int m_maximumSize = 256;
+  int m_bin = 1;
+  vtkSmartPointer<vtkImageData> m_volume;
+  // The filtered sinogram rows of each angle, to replace them.
+  std::map<double, std::vector<float>> m_projections;
+};
+}
+
+#endif
@@ -35,8 +35,11 @@
 #include "AddRotateAlignReaction.h"
 #include "AddRotateAlignReaction.h"
 #include "Behaviors.h"
+#include "CrossCorrelationAlignReaction.h"
 #include "DataPropertiesPanel.h"
 #include "DataTransformMenu.h"
+#include "DirectFourierReconstructionReaction.h"
+#include "IterativeReconstructionReaction.h"
 #include "LoadDataReaction.h"
 #include "LoadPaletteReaction.h"
 #include "ModuleManager.h"
@@ -62,6 +65,7 @@
 #include "tomvizConfig.h"
 
 #include "PipelineModel.h"
+#include "PipelineTraceDialog.h"
 
 #include <QAction>
 #include <QCloseEvent>
@@ -262,6 +266,8 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
     m_ui->menuTomography->addAction("Weighted Back Projection");
   QAction* reconWBP_CAction =
     m_ui->menuTomography->addAction("Simple Back Projection (C++)");
+  QAction* reconFilteredWBP_CAction =
+    m_ui->menuTomography->addAction("Weighted Back Projection (C++)");
   QAction* reconARTAction =
     m_ui->menuTomography->addAction("Algebraic Reconstruction Technique (ART)");
   QAction* reconSIRTAction = m_ui->menuTomography->addAction(
@@ -270,6 +276,12 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
     m_ui->menuTomography->addAction("Constraint-based Direct Fourier Method");
   QAction* reconTVMinimizationAction =
     m_ui->menuTomography->addAction("TV Minimization Method");
+  QAction* reconART_CAction = m_ui->menuTomography->addAction(
+    "Algebraic Reconstruction Technique (ART, C++)");
+  QAction* reconSIRT_CAction = m_ui->menuTomography->addAction(
+    "Simultaneous Iterative Recon. Technique (SIRT, C++)");
+  QAction* reconTVMinimization_CAction =
+    m_ui->menuTomography->addAction("TV Minimization Method (C++)");
   m_ui->menuTomography->addSeparator();
 
   QAction* simulationLabel = m_ui->menuTomography->addAction("Simulation:");
@@ -323,15 +335,11 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
     autoRotateAlignShiftAction, "Auto Tilt Axis Shift Align",
     readInPythonScript("AutoTiltAxisShiftAlignment"), true);
 
-  new AddPythonTransformReaction(
-    autoAlignCCAction, "Auto Tilt Image Align (XCORR)",
-    readInPythonScript("AutoCrossCorrelationTiltImageAlignment"), true);
+  new CrossCorrelationAlignReaction(autoAlignCCAction);
   new AddPythonTransformReaction(
     autoAlignCOMAction, "Auto Tilt Image Align (CoM)",
     readInPythonScript("AutoCenterOfMassTiltImageAlignment"), true);
-  new AddPythonTransformReaction(reconDFMAction, "Reconstruct (Direct Fourier)",
-                                 readInPythonScript("Recon_DFT"), true, false,
-                                 readInJSONDescription("Recon_DFT"));
+  new DirectFourierReconstructionReaction(reconDFMAction);
   new AddPythonTransformReaction(reconWBPAction,
                                  "Reconstruct (Back Projection)",
                                  readInPythonScript("Recon_WBP"), true, false,
@@ -352,6 +360,14 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
     readInJSONDescription("Recon_TV_minimization"));
 
   new ReconstructionReaction(reconWBP_CAction);
+  new ReconstructionReaction(reconFilteredWBP_CAction,
+                             TomographyReconstruction::Filter::Ramp);
+  new IterativeReconstructionReaction(
+    reconART_CAction, IterativeReconstructionOperator::Algorithm::ART);
+  new IterativeReconstructionReaction(
+    reconSIRT_CAction, IterativeReconstructionOperator::Algorithm::SIRT);
+  new IterativeReconstructionReaction(
+    reconTVMinimization_CAction, IterativeReconstructionOperator::Algorithm::TV);
 
   new AddPythonTransformReaction(
     randomShiftsAction, "Shift Tilt Series Randomly",
@@ -448,6 +464,10 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
   connect(acquisitionAction, SIGNAL(triggered(bool)), acquisitionWidget,
           SLOT(show()));
 
+  auto traceDialog = new PipelineTraceDialog(this);
+  auto traceAction = m_ui->menuTools->addAction("Pipeline Trace");
+  connect(traceAction, SIGNAL(triggered(bool)), traceDialog, SLOT(show()));
+
   registerCustomOperators();
 }
 
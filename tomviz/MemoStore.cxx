@@ -0,0 +1,385 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "MemoStore.h"
+
+#include "Operator.h"
+#include "Utilities.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkStringArray.h>
+
+#include <QMutexLocker>
+
+#include <vtk_pugixml.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+using tomviz::fnv1aHash;
+
+template <typename T>
+quint64 fnv1a(const T& value, quint64 hash)
+{
+  return fnv1aHash(&value, sizeof(T), hash);
+}
+
+// In sampled mode this many blocks of each array are hashed.
+const size_t sampleCount = 256;
+const size_t sampleSize = 4096;
+
+// Size of the blocks hashed in parallel in full mode.
+const size_t blockSize = 1 << 20;
+
+// FNV-1a over 64 bit words rather than bytes, the remaining bytes are hashed
+// one at a time.
+quint64 hashWords(const char* data, size_t bytes, quint64 hash)
+{
+  const quint64 prime = 1099511628211ULL;
+  size_t words = bytes / sizeof(quint64);
+  for (size_t i = 0; i < words; ++i) {
+    quint64 word;
+    std::memcpy(&word, data + i * sizeof(quint64), sizeof(quint64));
+    hash ^= word;
+    hash *= prime;
+  }
+  return fnv1aHash(data + words * sizeof(quint64),
+                   bytes - words * sizeof(quint64), hash);
+}
+
+// The blocks are hashed independently, then their hashes in order, so that
+// the result doesn't depend on the number of threads.
+quint64 hashBlocks(const char* data, size_t bytes, quint64 hash)
+{
+  size_t count = (bytes + blockSize - 1) / blockSize;
+  std::vector<quint64> hashes(count);
+  auto hashRange = [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i) {
+      size_t offset = static_cast<size_t>(i) * blockSize;
+      size_t length = std::min(blockSize, bytes - offset);
+      hashes[i] = hashWords(data + offset, length, fnv1aHash(nullptr, 0));
+    }
+  };
+  vtkSMPTools::For(0, static_cast<vtkIdType>(count), hashRange);
+  for (quint64 blockHash : hashes) {
+    hash = fnv1a(blockHash, hash);
+  }
+  return hash;
+}
+
+quint64 hashArray(vtkAbstractArray* array, bool full, quint64 hash)
+{
+  if (array->GetName()) {
+    hash = fnv1aHash(array->GetName(), strlen(array->GetName()), hash);
+  }
+  hash = fnv1a(array->GetDataType(), hash);
+  hash = fnv1a(array->GetNumberOfComponents(), hash);
+  hash = fnv1a(array->GetNumberOfTuples(), hash);
+
+  if (auto strings = vtkStringArray::SafeDownCast(array)) {
+    for (vtkIdType i = 0; i < strings->GetNumberOfValues(); ++i) {
+      const vtkStdString& value = strings->GetValue(i);
+      hash = fnv1aHash(value.c_str(), value.size(), hash);
+    }
+    return hash;
+  }
+  if (!vtkDataArray::SafeDownCast(array)) {
+    return hash;
+  }
+
+  auto data = static_cast<const char*>(array->GetVoidPointer(0));
+  size_t bytes = static_cast<size_t>(array->GetNumberOfValues()) *
+                 array->GetDataTypeSize();
+  if (full) {
+    return hashBlocks(data, bytes, hash);
+  }
+  if (bytes <= sampleCount * sampleSize) {
+    return hashWords(data, bytes, hash);
+  }
+
+  // The first and last blocks are always included.
+  size_t stride = (bytes - sampleSize) / (sampleCount - 1);
+  for (size_t i = 0; i < sampleCount; ++i) {
+    hash = hashWords(data + i * stride, sampleSize, hash);
+  }
+  return hash;
+}
+
+quint64 hashFieldData(vtkFieldData* fieldData, bool full, quint64 hash)
+{
+  hash = fnv1a(fieldData->GetNumberOfArrays(), hash);
+  for (int i = 0; i < fieldData->GetNumberOfArrays(); ++i) {
+    hash = hashArray(fieldData->GetAbstractArray(i), full, hash);
+  }
+  return hash;
+}
+}
+
+namespace tomviz {
+
+MemoStore::MemoStore()
+  : m_budget(defaultBudget()), m_hashMode(defaultHashMode())
+{
+}
+
+MemoStore& MemoStore::instance()
+{
+  static MemoStore theInstance;
+  return theInstance;
+}
+
+void MemoStore::setBudget(qint64 bytes)
+{
+  QMutexLocker locker(&m_mutex);
+  m_budget = qMax(bytes, static_cast<qint64>(0));
+  makeRoom(0);
+}
+
+qint64 MemoStore::budget() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_budget;
+}
+
+qint64 MemoStore::size() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_size;
+}
+
+void MemoStore::setHashMode(HashMode mode)
+{
+  QMutexLocker locker(&m_mutex);
+  if (mode != m_hashMode) {
+    m_hashMode = mode;
+    m_entries.clear();
+    m_size = 0;
+  }
+}
+
+MemoStore::HashMode MemoStore::hashMode() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_hashMode;
+}
+
+QByteArray MemoStore::key(Operator* op, vtkDataObject* data) const
+{
+  auto image = vtkImageData::SafeDownCast(data);
+  if (!op || !image || op->numberOfResults() > 0 ||
+      op->hasChildDataSource()) {
+    return QByteArray();
+  }
+
+  // The output of data that doesn't fit can't be stored, don't hash it.
+  // GetActualMemorySize() is in kibibytes.
+  qint64 bytes = static_cast<qint64>(image->GetActualMemorySize()) * 1024;
+  HashMode mode;
+  {
+    QMutexLocker locker(&m_mutex);
+    if (m_budget == 0 || bytes > m_budget) {
+      return QByteArray();
+    }
+    mode = m_hashMode;
+  }
+
+  QByteArray state = operatorState(op);
+  if (state.isEmpty()) {
+    return QByteArray();
+  }
+
+  // The parameters are part of the key verbatim, only the data is hashed.
+  QByteArray key = QByteArray::number(hash(data, mode), 16);
+  key += '\n';
+  key += state;
+  return key;
+}
+
+QByteArray MemoStore::operatorState(Operator* op)
+{
+  pugi::xml_document document;
+  pugi::xml_node node = document.append_child("Operator");
+  if (!op->serialize(node)) {
+    return QByteArray();
+  }
+  // The id of the child data source changes from session to session.
+  node.remove_attribute("childDataSource");
+  std::ostringstream stream;
+  document.print(stream, "", pugi::format_raw);
+
+  QByteArray state(op->metaObject()->className());
+  state += '\n';
+  state += QByteArray(stream.str().c_str());
+  return state;
+}
+
+vtkSmartPointer<vtkImageData> MemoStore::find(const QByteArray& key)
+{
+  QMutexLocker locker(&m_mutex);
+  auto itr = m_entries.find(key);
+  if (itr == m_entries.end()) {
+    ++m_misses;
+    return nullptr;
+  }
+  ++m_hits;
+  itr->lastUsed = ++m_clock;
+
+  return itr->data;
+}
+
+bool MemoStore::insert(const QByteArray& key, vtkDataObject* data)
+{
+  auto image = vtkImageData::SafeDownCast(data);
+  if (key.isEmpty() || !image) {
+    return false;
+  }
+
+  // GetActualMemorySize() is in kibibytes.
+  qint64 bytes = static_cast<qint64>(image->GetActualMemorySize()) * 1024;
+  {
+    QMutexLocker locker(&m_mutex);
+    if (bytes > m_budget) {
+      return false;
+    }
+  }
+
+  // The entry shares its arrays with data, the pipeline detaches them before
+  // an operator writes to them.
+  vtkSmartPointer<vtkImageData> copy = vtkSmartPointer<vtkImageData>::New();
+  copyOnWrite(image, copy);
+
+  QMutexLocker locker(&m_mutex);
+  if (m_entries.contains(key)) {
+    m_size -= m_entries[key].bytes;
+    m_entries.remove(key);
+  }
+  makeRoom(bytes);
+
+  Entry entry;
+  entry.data = copy;
+  entry.bytes = bytes;
+  entry.lastUsed = ++m_clock;
+  m_entries[key] = entry;
+  m_size += bytes;
+
+  return true;
+}
+
+void MemoStore::clear()
+{
+  QMutexLocker locker(&m_mutex);
+  m_entries.clear();
+  m_size = 0;
+}
+
+int MemoStore::hits() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_hits;
+}
+
+int MemoStore::misses() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_misses;
+}
+
+qint64 MemoStore::defaultBudget()
+{
+  // In megabytes, memoization is opt in.
+  int budget = 0;
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    budget =
+      core->settings()->value("tomviz/pipeline/MemoStoreSize", budget).toInt();
+  }
+
+  return static_cast<qint64>(budget) * 1024 * 1024;
+}
+
+MemoStore::HashMode MemoStore::defaultHashMode()
+{
+  QString mode = "full";
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    mode =
+      core->settings()->value("tomviz/pipeline/MemoHashMode", mode).toString();
+  }
+
+  return mode == "sampled" ? HashMode::Sampled : HashMode::Full;
+}
+
+quint64 MemoStore::hash(vtkDataObject* data, HashMode mode)
+{
+  quint64 hash = hashMetadata(data);
+  if (auto image = vtkImageData::SafeDownCast(data)) {
+    hash =
+      hashFieldData(image->GetPointData(), mode == HashMode::Full, hash);
+  }
+
+  return hash;
+}
+
+quint64 MemoStore::hashMetadata(vtkDataObject* data)
+{
+  quint64 hash = fnv1aHash(nullptr, 0);
+  if (auto image = vtkImageData::SafeDownCast(data)) {
+    int extent[6];
+    double origin[3], spacing[3];
+    image->GetExtent(extent);
+    image->GetOrigin(origin);
+    image->GetSpacing(spacing);
+    hash = fnv1a(extent, hash);
+    hash = fnv1a(origin, hash);
+    hash = fnv1a(spacing, hash);
+    auto scalars = image->GetPointData()->GetScalars();
+    if (scalars && scalars->GetName()) {
+      // Which array is active matters to the operators.
+      hash =
+        fnv1aHash(scalars->GetName(), strlen(scalars->GetName()), hash);
+    }
+  }
+  if (data && data->GetFieldData()) {
+    hash = hashFieldData(data->GetFieldData(), true, hash);
+  }
+
+  return hash;
+}
+
+void MemoStore::makeRoom(qint64 bytes)
+{
+  while (!m_entries.isEmpty() && m_size + bytes > m_budget) {
+    auto lru = m_entries.begin();
+    for (auto itr = m_entries.begin(); itr != m_entries.end(); ++itr) {
+      if (itr->lastUsed < lru->lastUsed) {
+        lru = itr;
+      }
+    }
+    m_size -= lru->bytes;
+    m_entries.erase(lru);
+  }
+}
+}
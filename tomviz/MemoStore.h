@@ -0,0 +1,138 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizMemoStore_h
+#define tomvizMemoStore_h
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+
+#include <vtkSmartPointer.h>
+
+class vtkDataObject;
+class vtkImageData;
+
+namespace tomviz {
+
+class Operator;
+
+/// Content addressed store of operator outputs. The key of an operator
+/// application combines a hash of the input data with the operator type and
+/// its serialized state, so an operator applied again to the same data with
+/// the same parameters (e.g. when reopening a state file, or when an operator
+/// is removed and added back) reuses the stored output instead of executing.
+/// Unlike the CheckpointCache the entries don't depend on the position of the
+/// operator in a pipeline or on the DataSource.
+///
+/// Operators producing results or child data sources are not memoized, their
+/// side effects can't be replayed. Entries are evicted least recently used
+/// first once the budget is exceeded. All methods are thread safe.
+///
+/// Memoization is opt in, the budget is zero unless configured. Every key
+/// hashes the operator input, and an entry shares its arrays with the data it
+/// was recorded from, so the next operator modifying that data in place
+/// copies the arrays first (see Operator::modifiesDataInPlace()). Data larger
+/// than the budget is neither hashed nor recorded, so both costs are bounded
+/// by the budget.
+class MemoStore
+{
+public:
+  /// How much of the input data is hashed.
+  enum class HashMode
+  {
+    /// Evenly spaced blocks of every array, cheap but blind to changes that
+    /// fall between the blocks, which then reuse a stale output.
+    Sampled,
+    /// Every byte, in parallel blocks.
+    Full
+  };
+
+  /// Returns reference to the singleton instance.
+  static MemoStore& instance();
+
+  /// Set the memory budget in bytes, a budget of zero disables memoization.
+  void setBudget(qint64 bytes);
+  qint64 budget() const;
+
+  /// Returns the number of bytes currently held by the store.
+  qint64 size() const;
+
+  /// Changing the hash mode clears the store.
+  void setHashMode(HashMode mode);
+  HashMode hashMode() const;
+
+  /// Returns the key of op applied to data, or an empty key if the operator
+  /// can't be memoized, the data is larger than the budget or memoization is
+  /// disabled.
+  QByteArray key(Operator* op, vtkDataObject* data) const;
+
+  /// Returns the output stored for key, or nullptr. The caller must not modify
+  /// the returned data, copy it first.
+  vtkSmartPointer<vtkImageData> find(const QByteArray& key);
+
+  /// Record a copy of data, sharing its arrays (see copyOnWrite()), as the
+  /// output for key. Returns false if it doesn't fit the budget.
+  bool insert(const QByteArray& key, vtkDataObject* data);
+
+  void clear();
+
+  /// Number of find() calls that returned an output or nothing.
+  int hits() const;
+  int misses() const;
+
+  /// The budget and hash mode configured in the application settings, zero
+  /// and full by default.
+  static qint64 defaultBudget();
+  static HashMode defaultHashMode();
+
+  /// Hash of the geometry and arrays of data.
+  static quint64 hash(vtkDataObject* data, HashMode mode = HashMode::Full);
+
+  /// Hash of the geometry, the name of the active scalars and the field data
+  /// (e.g. the tilt angles) of data, not of its point data arrays.
+  static quint64 hashMetadata(vtkDataObject* data);
+
+  /// The class and serialized parameters of op, or an empty array if the
+  /// operator fails to serialize.
+  static QByteArray operatorState(Operator* op);
+
+private:
+  MemoStore();
+  Q_DISABLE_COPY(MemoStore)
+
+  struct Entry
+  {
+    vtkSmartPointer<vtkImageData> data;
+    qint64 bytes = 0;
+    quint64 lastUsed = 0;
+  };
+
+  // Evict least recently used entries until bytes more fit in the budget.
+  // Must be called with m_mutex locked.
+  void makeRoom(qint64 bytes);
+
+  mutable QMutex m_mutex;
+  QMap<QByteArray, Entry> m_entries;
+  qint64 m_budget = 0;
+  qint64 m_size = 0;
+  quint64 m_clock = 0;
+  HashMode m_hashMode;
+  int m_hits = 0;
+  int m_misses = 0;
+};
+}
+
+#endif
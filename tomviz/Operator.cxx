@@ -16,10 +16,16 @@
 #include "Operator.h"
 
 #include "DataSource.h"
+#include "MemoStore.h"
 #include "ModuleManager.h"
 #include "OperatorResult.h"
+#include "Utilities.h"
 
-#include "vtkSMSourceProxy.h"
+#include <pqSMProxy.h>
+#include <vtkSMProxyManager.h>
+#include <vtkSMSessionProxyManager.h>
+#include <vtkSMSourceProxy.h>
+#include <vtkTrivialProducer.h>
 
 #include <QList>
 #include <QTimer>
@@ -60,6 +66,23 @@ TransformResult Operator::transform(vtkDataObject* data)
   m_state = OperatorState::Running;
   emit transformingStarted();
   setProgressStep(0);
+
+  // Reuse the output of an earlier application to the same data.
+  auto& memo = MemoStore::instance();
+  QByteArray key = memo.key(this, data);
+  if (!key.isEmpty()) {
+    auto output = memo.find(key);
+    if (output) {
+      copyOnWrite(output, data);
+      m_state = OperatorState::Complete;
+      emit transformingDone(TransformResult::Complete);
+      return TransformResult::Complete;
+    }
+  }
+
+  if (modifiesDataInPlace()) {
+    detachSharedArrays(data);
+  }
   bool result = this->applyTransform(data);
   TransformResult transformResult =
     result ? TransformResult::Complete : TransformResult::Error;
@@ -70,6 +93,9 @@ TransformResult Operator::transform(vtkDataObject* data)
   } else {
     m_state = static_cast<OperatorState>(transformResult);
   }
+  if (transformResult == TransformResult::Complete && !key.isEmpty()) {
+    memo.insert(key, data);
+  }
   emit transformingDone(transformResult);
 
   return transformResult;
@@ -156,6 +182,32 @@ DataSource* Operator::childDataSource() const
   return m_childDataSource;
 }
 
+void Operator::restore(vtkDataObject* childData, const QString& childLabel)
+{
+  if (childData && !childDataSource()) {
+    vtkSMSessionProxyManager* sessionProxyManager =
+      vtkSMProxyManager::GetProxyManager()->GetActiveSessionProxyManager();
+    pqSMProxy producerProxy;
+    producerProxy.TakeReference(
+      sessionProxyManager->NewProxy("sources", "TrivialProducer"));
+    producerProxy->UpdateVTKObjects();
+    vtkTrivialProducer* producer =
+      vtkTrivialProducer::SafeDownCast(producerProxy->GetClientSideObject());
+    producer->SetOutput(childData);
+
+    DataSource* childDS =
+      new DataSource(vtkSMSourceProxy::SafeDownCast(producerProxy),
+                     DataSource::Volume, this,
+                     DataSource::PersistenceState::Transient);
+    childDS->setFilename(childLabel);
+    setChildDataSource(childDS);
+    emit newChildDataSource(childDS);
+  }
+
+  m_state = OperatorState::Complete;
+  emit transformingDone(TransformResult::Complete);
+}
+
 bool Operator::serialize(pugi::xml_node& ns) const
 {
   if (hasChildDataSource()) {
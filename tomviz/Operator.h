@@ -101,6 +101,13 @@ public:
   /// Get the child DataSource.
   virtual DataSource* childDataSource() const;
 
+  /// Called instead of transform() when the output of the pipeline has been
+  /// restored from the DiskCache, marks the operator as complete. If given,
+  /// childData is the restored data of the child DataSource, which is created
+  /// with the given label.
+  virtual void restore(vtkDataObject* childData = nullptr,
+                       const QString& childLabel = QString());
+
   /// Save/Restore state.
   virtual bool serialize(pugi::xml_node& in) const = 0;
   virtual bool deserialize(const pugi::xml_node& ns) = 0;
@@ -120,8 +127,8 @@ public:
   /// operator or nullptr if there is nothing to edit.  The vtkImageData
   /// is a copy of the DataSource's image with all Operators prior in the
   /// pipeline applied to it.  This should be used if the widget needs to
-  /// display the VTK data, but modifications to it will not affect the
-  /// DataSource.
+  /// display the VTK data. Its arrays may be shared with the DataSource, call
+  /// detachSharedArrays() before modifying them.
   virtual EditOperatorWidget* getEditorContentsWithData(
     QWidget* parent_,
     vtkSmartPointer<vtkImageData> vtkNotUsed(inputDataForDisplay))
@@ -140,6 +147,33 @@ public:
   /// default implementation and a default QProgressBar will be created instead.
   virtual QWidget* getCustomProgressWidget(QWidget*) const { return nullptr; }
 
+  /// Returns true if applyTransform() may write to the point or cell data
+  /// arrays it is given. The data handed to an operator can share its arrays
+  /// with the DataSource, a checkpoint or a memoized output, so transform()
+  /// makes private copies of them first. The peak memory is then twice the
+  /// data, the caches don't keep data larger than their budget so this only
+  /// happens to data that fits them. Operators that only read the input
+  /// arrays, replacing them with new ones or only touching the field data,
+  /// should return false to avoid the copy.
+  virtual bool modifiesDataInPlace() const { return true; }
+
+  /// Returns true if the operator can be applied to Z slabs of a volume
+  /// independently: each output slice only depends on the input slices within
+  /// slabHalo() of it, and the number of slices is unchanged. Such operators
+  /// can process volumes that don't fit in memory, see SlabStreamer.
+  virtual bool supportsSlabs() const { return false; }
+
+  /// Returns the number of neighboring slices needed on each side of a slab to
+  /// compute it correctly.
+  virtual int slabHalo() const { return 0; }
+
+  /// Returns true if the operator gives a meaningful result when applied to a
+  /// downsampled copy of the data. The DataSource uses it to show a quick low
+  /// resolution preview of the pipeline before the full resolution result is
+  /// available. Operators with parameters in voxel units or producing results
+  /// or child data sources should return false.
+  virtual bool supportsPreview() const { return true; }
+
   /// Returns true if the operation supports canceling midway through the
   /// applyTransform function via the cancelTransform slot.  Defaults to false,
   /// can be set by the setSupportsCancel(bool) method by subclasses.
@@ -161,7 +195,7 @@ public:
   /// Returns the current progress step
   int progressStep() const { return m_progressStep; }
 
-  /// Set the current progress step
+  /// Set the current progress step, may be called from several threads.
   void setProgressStep(int step)
   {
     m_progressStep = step;
@@ -245,7 +279,7 @@ private:
   bool m_hasChildDataSource = false;
   DataSource* m_childDataSource = nullptr;
   int m_totalProgressSteps = 0;
-  int m_progressStep = 0;
+  std::atomic<int> m_progressStep{ 0 };
   QString m_progressMessage;
   std::atomic<OperatorState> m_state{ OperatorState::Queued };
 };
@@ -18,6 +18,8 @@
 #include "ConvertToFloatOperator.h"
 #include "CropOperator.h"
 #include "DataSource.h"
+#include "DirectFourierReconstructionOperator.h"
+#include "IterativeReconstructionOperator.h"
 #include "OperatorPython.h"
 #include "ReconstructionOperator.h"
 #include "SetTiltAnglesOperator.h"
@@ -44,6 +46,8 @@ public:
   bool serialize(pugi::xml_node&) const override { return true; }
   bool deserialize(const pugi::xml_node&) override { return true; }
   bool hasCustomUI() const override { return false; }
+  bool modifiesDataInPlace() const override { return false; }
+  bool supportsSlabs() const override { return true; }
   Operator* clone() const override { return new ConvertToVolumeOperator; }
 
 protected:
@@ -90,6 +94,8 @@ QList<QString> OperatorFactory::operatorTypes()
         << "ConvertToFloat"
         << "ConvertToVolume"
         << "Crop"
+        << "CxxDirectFourierReconstruction"
+        << "CxxIterativeReconstruction"
         << "CxxReconstruction"
         << "SetTiltAngles"
         << "TranslateAlign"
@@ -115,6 +121,10 @@ Operator* OperatorFactory::createOperator(const QString& type, DataSource* ds)
     op = new ConvertToVolumeOperator();
   } else if (type == "Crop") {
     op = new CropOperator();
+  } else if (type == "CxxDirectFourierReconstruction") {
+    op = new DirectFourierReconstructionOperator();
+  } else if (type == "CxxIterativeReconstruction") {
+    op = new IterativeReconstructionOperator();
   } else if (type == "CxxReconstruction") {
     op = new ReconstructionOperator(ds);
   } else if (type == "SetTiltAngles") {
@@ -127,6 +137,12 @@ Operator* OperatorFactory::createOperator(const QString& type, DataSource* ds)
   return op;
 }
 
+bool OperatorFactory::requiresDataSource(const QString& type)
+{
+  return type == "CxxReconstruction" || type == "TranslateAlign" ||
+         type == "Snapshot";
+}
+
 const char* OperatorFactory::operatorType(Operator* op)
 {
   if (qobject_cast<OperatorPython*>(op)) {
@@ -141,6 +157,12 @@ const char* OperatorFactory::operatorType(Operator* op)
   if (qobject_cast<CropOperator*>(op)) {
     return "Crop";
   }
+  if (qobject_cast<DirectFourierReconstructionOperator*>(op)) {
+    return "CxxDirectFourierReconstruction";
+  }
+  if (qobject_cast<IterativeReconstructionOperator*>(op)) {
+    return "CxxIterativeReconstruction";
+  }
   if (qobject_cast<ReconstructionOperator*>(op)) {
     return "CxxReconstruction";
   }
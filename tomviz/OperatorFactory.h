@@ -35,6 +35,10 @@ public:
   /// Creates an operator of the given type
   static Operator* createOperator(const QString& type, DataSource* ds);
 
+  /// Returns true if operators of the given type need the data source passed
+  /// to createOperator(), the others can be created with nullptr.
+  static bool requiresDataSource(const QString& type);
+
   /// Returns the type for an operator instance.
   static const char* operatorType(Operator* module);
 
@@ -176,6 +176,15 @@ void OperatorPython::setJSONDescription(const QString& str)
   m_resultNames.clear();
   m_childDataSourceNamesAndLabels.clear();
 
+  // Get whether the operator can be applied slab by slab
+  QJsonValueRef streamingNode = root["streaming"];
+  m_supportsSlabs = streamingNode.isObject();
+  m_slabHalo = streamingNode.toObject()["halo"].toInt(0);
+
+  // Get whether the operator can be applied to downsampled data, parameters
+  // in voxel units would not scale with it so this is opt in.
+  m_supportsPreview = root["preview"].toBool(false);
+
   // Get the number of results
   QJsonValueRef resultsNode = root["results"];
   if (!resultsNode.isUndefined() && !resultsNode.isNull()) {
@@ -234,6 +243,16 @@ const QString& OperatorPython::JSONDescription() const
   return this->jsonDescription;
 }
 
+bool OperatorPython::supportsSlabs() const
+{
+  return m_supportsSlabs && numberOfResults() == 0 && !hasChildDataSource();
+}
+
+bool OperatorPython::supportsPreview() const
+{
+  return m_supportsPreview && numberOfResults() == 0 && !hasChildDataSource();
+}
+
 void OperatorPython::setScript(const QString& str)
 {
   if (this->Script != str) {
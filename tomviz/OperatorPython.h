@@ -60,6 +60,17 @@ public:
   /// Returns the argument that will be passed to transform_scalars
   QMap<QString, QVariant> arguments() const;
 
+  /// Operators declare slab support in their JSON description, e.g.
+  /// "streaming" : { "halo" : 2 }. Operators producing results or child data
+  /// sources can't be streamed.
+  bool supportsSlabs() const override;
+  int slabHalo() const override { return m_slabHalo; }
+
+  /// Operators opt in to previews with "preview" : true in their JSON
+  /// description, as their parameters may be in voxel units. Operators
+  /// producing results or child data sources are never previewed.
+  bool supportsPreview() const override;
+
 signals:
   // Signal used to request the creation of a new data source. Needed to
   // ensure the initialization of the new DataSource is performed on UI thread
@@ -88,6 +99,9 @@ private:
   QList<QString> m_resultNames;
   QList<QPair<QString, QString>> m_childDataSourceNamesAndLabels;
   QMap<QString, QVariant> m_arguments;
+  bool m_supportsSlabs = false;
+  int m_slabHalo = 0;
+  bool m_supportsPreview = false;
 };
 }
 #endif
@@ -63,6 +63,16 @@ void OperatorWidget::setupUI(const QString& json)
   buildInterface(ib);
 }
 
+void OperatorWidget::setupUI(const QString& json,
+                             const QMap<QString, QVariant>& values)
+{
+  InterfaceBuilder* ib =
+    new InterfaceBuilder(this, ActiveObjects::instance().activeDataSource());
+  ib->setJSONDescription(json);
+  ib->setParameterValues(values);
+  buildInterface(ib);
+}
+
 void OperatorWidget::buildInterface(InterfaceBuilder* builder)
 {
   QLayout* layout = builder->buildInterface();
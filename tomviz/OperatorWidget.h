@@ -37,6 +37,8 @@ public:
   ~OperatorWidget() override;
 
   void setupUI(const QString& json);
+  /// Build the interface from json showing the given parameter values.
+  void setupUI(const QString& json, const QMap<QString, QVariant>& values);
   void setupUI(OperatorPython* op);
 
   /// Get parameter values
@@ -0,0 +1,198 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "ParallelProjector.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace tomviz {
+
+ParallelProjector::ParallelProjector(int Nside, double pixelWidth,
+                                     const std::vector<double>& angles,
+                                     int Nray, double rayWidth)
+  : m_Nside(Nside), m_pixelWidth(pixelWidth), m_Nray(Nray),
+    m_rayWidth(rayWidth)
+{
+  const double pi = 3.14159265358979323846;
+  for (double angle : angles) {
+    m_cosines.push_back(std::cos(angle * pi / 180.0));
+    m_sines.push_back(std::sin(angle * pi / 180.0));
+  }
+}
+
+int ParallelProjector::rows() const
+{
+  return numberOfProjections() * m_Nray;
+}
+
+int ParallelProjector::columns() const
+{
+  return m_Nside * m_Nside;
+}
+
+bool ParallelProjector::isSteep(int projection) const
+{
+  // The rays run along (-sin, cos)
+  return std::abs(m_cosines[projection]) >= std::abs(m_sines[projection]);
+}
+
+template <typename F>
+void ParallelProjector::trace(int r, int begin, int end, F f) const
+{
+  int i = r / m_Nray;
+  double offset = (-(m_Nray - 1) / 2.0 + r % m_Nray) * m_rayWidth;
+  double xray = m_cosines[i] * offset;
+  double yray = m_sines[i] * offset;
+  double a = -m_sines[i];
+  double b = m_cosines[i];
+  // Pixel (y, x) is centered on ((x - center) w, (center - y) w)
+  double center = m_Nside / 2.0 - 0.5;
+
+  if (isSteep(i)) {
+    double length = m_pixelWidth / std::abs(b);
+    for (int y = begin; y < end; ++y) {
+      double t = ((center - y) * m_pixelWidth - yray) / b;
+      double u = (a * t + xray) / m_pixelWidth + center;
+      double left = std::floor(u);
+      double fraction = u - left;
+      if (left < -1 || left >= m_Nside) {
+        continue;
+      }
+      int x = static_cast<int>(left);
+      if (x >= 0) {
+        f(y * m_Nside + x, (1 - fraction) * length);
+      }
+      if (x + 1 < m_Nside && fraction > 0) {
+        f(y * m_Nside + x + 1, fraction * length);
+      }
+    }
+  } else {
+    double length = m_pixelWidth / std::abs(a);
+    for (int x = begin; x < end; ++x) {
+      double t = ((x - center) * m_pixelWidth - xray) / a;
+      double v = center - (b * t + yray) / m_pixelWidth;
+      double top = std::floor(v);
+      double fraction = v - top;
+      if (top < -1 || top >= m_Nside) {
+        continue;
+      }
+      int y = static_cast<int>(top);
+      if (y >= 0) {
+        f(y * m_Nside + x, (1 - fraction) * length);
+      }
+      if (y + 1 < m_Nside && fraction > 0) {
+        f((y + 1) * m_Nside + x, fraction * length);
+      }
+    }
+  }
+}
+
+template <typename F>
+void ParallelProjector::scatter(F f) const
+{
+  // A steep ray only writes to the row of pixels it samples and the others to
+  // the column, so the steep rays are split by rows and then the others by
+  // columns.
+  int Nproj = numberOfProjections();
+  for (bool steep : { true, false }) {
+    vtkSMPTools::For(0, m_Nside, [&](vtkIdType begin, vtkIdType end) {
+      for (int i = 0; i < Nproj; ++i) {
+        if (isSteep(i) != steep) {
+          continue;
+        }
+        for (int r = i * m_Nray; r < (i + 1) * m_Nray; ++r) {
+          trace(r, begin, end,
+                [&](int pixel, double weight) { f(r, pixel, weight); });
+        }
+      }
+    });
+  }
+}
+
+void ParallelProjector::forward(const float* image, float* sinogram,
+                                int count) const
+{
+  vtkSMPTools::For(0, rows(), [&](vtkIdType begin, vtkIdType end) {
+    std::vector<double> sums(count);
+    for (vtkIdType r = begin; r < end; ++r) {
+      dot(r, image, &sums[0], count);
+      for (int k = 0; k < count; ++k) {
+        sinogram[r * count + k] = static_cast<float>(sums[k]);
+      }
+    }
+  });
+}
+
+void ParallelProjector::back(const float* sinogram, float* image,
+                             int count) const
+{
+  std::fill(image, image + static_cast<size_t>(columns()) * count, 0.0f);
+  scatter([&](int r, int pixel, double weight) {
+    const float* rays = sinogram + static_cast<size_t>(r) * count;
+    float* pixels = image + static_cast<size_t>(pixel) * count;
+    for (int k = 0; k < count; ++k) {
+      pixels[k] += static_cast<float>(weight * rays[k]);
+    }
+  });
+}
+
+void ParallelProjector::dot(int r, const float* x, double* result,
+                            int count) const
+{
+  std::fill(result, result + count, 0.0);
+  trace(r, 0, m_Nside, [&](int pixel, double weight) {
+    const float* pixels = x + static_cast<size_t>(pixel) * count;
+    for (int k = 0; k < count; ++k) {
+      result[k] += weight * pixels[k];
+    }
+  });
+}
+
+void ParallelProjector::addRow(int r, const double* scales, float* x,
+                               int count) const
+{
+  trace(r, 0, m_Nside, [&](int pixel, double weight) {
+    float* pixels = x + static_cast<size_t>(pixel) * count;
+    for (int k = 0; k < count; ++k) {
+      pixels[k] += static_cast<float>(scales[k] * weight);
+    }
+  });
+}
+
+std::vector<double> ParallelProjector::rowSquaredNorms(
+  const std::vector<int>& columnWeights) const
+{
+  std::vector<double> norms(rows(), 0.0);
+  vtkSMPTools::For(0, rows(), [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType r = begin; r < end; ++r) {
+      trace(r, 0, m_Nside, [&](int pixel, double weight) {
+        norms[r] += weight * weight *
+                    (columnWeights.empty() ? 1 : columnWeights[pixel]);
+      });
+    }
+  });
+  return norms;
+}
+
+std::vector<int> ParallelProjector::columnCounts() const
+{
+  std::vector<int> counts(columns(), 0);
+  scatter([&](int, int pixel, double) { ++counts[pixel]; });
+  return counts;
+}
+}
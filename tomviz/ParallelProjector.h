@@ -0,0 +1,88 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizParallelProjector_h
+#define tomvizParallelProjector_h
+
+#include "Projector.h"
+
+#include <vector>
+
+namespace tomviz {
+
+/// Matrix free projector and back projector of parallel rays (Joseph's
+/// method): every ray is sampled once per row or column of pixels, whichever
+/// it crosses more steeply, interpolating linearly between the two nearest
+/// pixels. The weights are computed on the fly so the memory used is that of
+/// the image and the sinogram, where a ProjectionMatrix grows as
+/// Nray Nside Nproj.
+///
+/// The geometry is the one of ProjectionMatrix::parallelRay(), the rows are the
+/// rays i * Nray + j and the columns the pixels y * Nside + x. back() is the
+/// exact adjoint of forward(), both use vtkSMPTools.
+class ParallelProjector : public Projector
+{
+public:
+  /// The angles are in degrees.
+  ParallelProjector(int Nside, double pixelWidth,
+                    const std::vector<double>& angles, int Nray,
+                    double rayWidth);
+
+  int rows() const override;
+  int columns() const override;
+
+  int sideLength() const { return m_Nside; }
+  int numberOfRays() const { return m_Nray; }
+  int numberOfProjections() const
+  {
+    return static_cast<int>(m_cosines.size());
+  }
+
+  void forward(const float* image, float* sinogram,
+               int count = 1) const override;
+  void back(const float* sinogram, float* image, int count = 1) const override;
+  void dot(int r, const float* x, double* result,
+           int count = 1) const override;
+  void addRow(int r, const double* scales, float* x,
+              int count = 1) const override;
+  std::vector<double> rowSquaredNorms(
+    const std::vector<int>& columnWeights = std::vector<int>()) const override;
+  std::vector<int> columnCounts() const override;
+
+private:
+  // True if the rays of the projection are sampled once per row of pixels,
+  // false if once per column.
+  bool isSteep(int projection) const;
+
+  // Call f(pixel, weight) for the pixels of ray r in the rows (steep rays) or
+  // columns [begin, end) of the image.
+  template <typename F>
+  void trace(int r, int begin, int end, F f) const;
+
+  // Call f(ray, pixel, weight) for all the entries, in parallel but never for
+  // the same pixel from two threads.
+  template <typename F>
+  void scatter(F f) const;
+
+  int m_Nside;
+  double m_pixelWidth;
+  int m_Nray;
+  double m_rayWidth;
+  std::vector<double> m_cosines;
+  std::vector<double> m_sines;
+};
+}
+
+#endif
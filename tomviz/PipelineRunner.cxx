@@ -0,0 +1,523 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PipelineRunner.h"
+
+#include "ActiveObjects.h"
+#include "DataSource.h"
+#include "EmdFormat.h"
+#include "LoadDataReaction.h"
+#include "Operator.h"
+#include "OperatorFactory.h"
+#include "OperatorPython.h"
+#include "PipelineTracer.h"
+#include "SlabStreamer.h"
+#include "Utilities.h"
+
+#include <pqSMAdaptor.h>
+#include <vtkAlgorithm.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSMCoreUtilities.h>
+#include <vtkSMProxyManager.h>
+#include <vtkSMReaderFactory.h>
+#include <vtkSMSessionProxyManager.h>
+#include <vtkSMSourceProxy.h>
+#include <vtkSMStringVectorProperty.h>
+#include <vtkXMLImageDataWriter.h>
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+namespace tomviz {
+
+PipelineRunner::PipelineRunner(QObject* p)
+  : QObject(p), m_stdout(stdout), m_report(&m_stdout)
+{
+}
+
+PipelineRunner::~PipelineRunner()
+{
+  qDeleteAll(m_operators);
+  foreach (const QList<Operator*>& operators, m_childOperators) {
+    qDeleteAll(operators);
+  }
+  delete m_dataSource;
+}
+
+void PipelineRunner::setStreaming(bool streaming)
+{
+  m_streaming = streaming;
+}
+
+bool PipelineRunner::loadData(const QString& fileName)
+{
+  QFileInfo info(fileName);
+  if (!info.exists()) {
+    qCritical() << "No such file:" << fileName;
+    return false;
+  }
+
+  if (info.suffix().toLower() == "emd") {
+    EmdFormat emdFile;
+    vtkNew<vtkImageData> imageData;
+    if (!emdFile.read(fileName.toLatin1().data(), imageData.Get())) {
+      qCritical() << "Failed to read" << fileName;
+      return false;
+    }
+    m_dataSource = LoadDataReaction::createDataSource(imageData.Get());
+    return true;
+  }
+
+  // Use the ParaView readers, without the reader configuration dialog of
+  // LoadDataReaction.
+  auto pxm = ActiveObjects::instance().proxyManager();
+  auto factory = vtkSMProxyManager::GetProxyManager()->GetReaderFactory();
+  if (!factory->CanReadFile(fileName.toLatin1().data(), pxm->GetSession())) {
+    qCritical() << "No reader found for" << fileName;
+    return false;
+  }
+  vtkSmartPointer<vtkSMProxy> reader;
+  reader.TakeReference(
+    pxm->NewProxy(factory->GetReaderGroup(), factory->GetReaderName()));
+  auto source = vtkSMSourceProxy::SafeDownCast(reader);
+  if (!source) {
+    qCritical() << "Failed to create a reader for" << fileName;
+    return false;
+  }
+  QString pname = vtkSMCoreUtilities::GetFileNameProperty(reader);
+  auto prop = vtkSMStringVectorProperty::SafeDownCast(
+    reader->GetProperty(pname.toUtf8().data()));
+  pqSMAdaptor::setElementProperty(prop, fileName);
+  reader->UpdateVTKObjects();
+  source->UpdatePipelineInformation();
+
+  auto algorithm = vtkAlgorithm::SafeDownCast(source->GetClientSideObject());
+  if (!algorithm ||
+      !vtkImageData::SafeDownCast(algorithm->GetOutputDataObject(0))) {
+    qCritical() << fileName << "does not contain image data";
+    return false;
+  }
+  m_reader = source;
+  if (!m_streaming) {
+    dataSource();
+  }
+  return true;
+}
+
+DataSource* PipelineRunner::dataSource()
+{
+  if (!m_dataSource && m_reader) {
+    m_reader->UpdatePipeline();
+    m_dataSource = new DataSource(m_reader);
+    if (m_overrideSpacing) {
+      m_dataSource->setSpacing(m_spacing);
+    }
+    foreach (Operator* op, m_operators) {
+      op->setParent(m_dataSource);
+    }
+  }
+  return m_dataSource;
+}
+
+void PipelineRunner::setSpacing(const double spacing[3])
+{
+  m_overrideSpacing = true;
+  std::copy(spacing, spacing + 3, m_spacing);
+  if (m_dataSource) {
+    m_dataSource->setSpacing(m_spacing);
+  }
+}
+
+bool PipelineRunner::loadPipeline(const QString& fileName, int dataSourceIndex)
+{
+  if (QFileInfo(fileName).suffix().toLower() == "json") {
+    return loadJson(fileName);
+  }
+  return loadState(fileName, dataSourceIndex);
+}
+
+bool PipelineRunner::loadState(const QString& fileName, int dataSourceIndex)
+{
+  Q_ASSERT(m_dataSource || m_reader);
+
+  pugi::xml_document document;
+  if (!document.load_file(fileName.toLatin1().data())) {
+    qCritical() << "Failed to parse" << fileName;
+    return false;
+  }
+
+  // Only the operators are read, the readers, views and modules of the state
+  // are ignored.
+  int index = 0;
+  pugi::xml_node root = document.child("tomvizState");
+  for (pugi::xml_node dsnode = root.child("DataSource"); dsnode;
+       dsnode = dsnode.next_sibling("DataSource")) {
+    if (dsnode.attribute("child").as_bool(false) ||
+        index++ != dataSourceIndex) {
+      continue;
+    }
+
+    if (dsnode.child("Spacing")) {
+      pugi::xml_node spacingNode = dsnode.child("Spacing");
+      double spacing[3];
+      spacing[0] = spacingNode.attribute("x").as_double();
+      spacing[1] = spacingNode.attribute("y").as_double();
+      spacing[2] = spacingNode.attribute("z").as_double();
+      setSpacing(spacing);
+    }
+
+    return addOperators(root, dsnode, m_operators);
+  }
+
+  qCritical() << fileName << "has no data source with index"
+              << dataSourceIndex;
+  return false;
+}
+
+bool PipelineRunner::addOperators(const pugi::xml_node& root,
+                                  const pugi::xml_node& dsnode,
+                                  QList<Operator*>& operators)
+{
+  for (pugi::xml_node node = dsnode.child("Operator"); node;
+       node = node.next_sibling("Operator")) {
+    // The child data source is created again when the operator runs, don't
+    // let the operator look up the one of the saved state.
+    QByteArray childId = node.attribute("childDataSource").value();
+    node.remove_attribute("childDataSource");
+
+    Operator* op =
+      addOperator(node.attribute("operator_type").value(), node, operators);
+    if (!op) {
+      return false;
+    }
+    if (childId.isEmpty()) {
+      continue;
+    }
+    pugi::xml_node childNode =
+      root.find_child_by_attribute("DataSource", "id", childId.data());
+    if (childNode && !addOperators(root, childNode, m_childOperators[op])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool PipelineRunner::loadJson(const QString& fileName)
+{
+  Q_ASSERT(m_dataSource || m_reader);
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    qCritical() << "Unable to read" << fileName;
+    return false;
+  }
+  QJsonParseError error;
+  auto document = QJsonDocument::fromJson(file.readAll(), &error);
+  if (document.isNull()) {
+    qCritical() << "Failed to parse" << fileName << ":" << error.errorString();
+    return false;
+  }
+
+  QString baseDir = QFileInfo(fileName).absolutePath();
+  foreach (const QJsonValue& value, document.object()["operators"].toArray()) {
+    QJsonObject description = value.toObject();
+    QString type = description["type"].toString();
+    if (type.isEmpty() || type == "Python") {
+      if (!addPythonOperator(description, baseDir)) {
+        return false;
+      }
+      continue;
+    }
+
+    pugi::xml_document xml;
+    pugi::xml_node node = xml.append_child("Operator");
+    for (auto it = description.constBegin(); it != description.constEnd();
+         ++it) {
+      if (it.key() != "type") {
+        node.append_attribute(it.key().toLatin1().data())
+          .set_value(it.value().toVariant().toString().toLatin1().data());
+      }
+    }
+    if (!addOperator(type, node, m_operators)) {
+      return false;
+    }
+  }
+
+  if (m_operators.isEmpty()) {
+    qWarning() << fileName << "contains no operators";
+  }
+  return true;
+}
+
+Operator* PipelineRunner::addOperator(const QString& type,
+                                      const pugi::xml_node& node,
+                                      QList<Operator*>& operators)
+{
+  // Only read the whole data when streaming if the operator needs it.
+  DataSource* ds =
+    OperatorFactory::requiresDataSource(type) ? dataSource() : m_dataSource;
+  Operator* op = OperatorFactory::createOperator(type, ds);
+  if (!op) {
+    qCritical() << "Unknown operator type:" << type;
+    return nullptr;
+  }
+  op->setParent(m_dataSource);
+  if (!op->deserialize(node)) {
+    qCritical() << "Failed to load operator of type" << type;
+    delete op;
+    return nullptr;
+  }
+  operators.append(op);
+  return op;
+}
+
+Operator* PipelineRunner::addPythonOperator(const QJsonObject& description,
+                                            const QString& baseDir)
+{
+  // Either a file relative to the pipeline description or the name of one of
+  // the built-in operators.
+  auto readIn = [&baseDir](const QString& name, const QString& extension) {
+    QFileInfo info(QDir(baseDir), name);
+    if (!name.isEmpty() && info.isFile()) {
+      QFile file(info.absoluteFilePath());
+      if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString(file.readAll());
+      }
+    }
+    return readInTextFile(name, extension);
+  };
+
+  QString script = readIn(description["script"].toString(), ".py");
+  if (script.isEmpty()) {
+    qCritical() << "Unable to read the script of Python operator"
+                << description["script"].toString();
+    return nullptr;
+  }
+
+  auto op = new OperatorPython();
+  op->setParent(m_dataSource);
+  QString json = description["description"].toString();
+  if (!json.isEmpty()) {
+    op->setJSONDescription(readIn(json, ".json"));
+  }
+  if (description.contains("label")) {
+    op->setLabel(description["label"].toString());
+  } else if (json.isEmpty()) {
+    op->setLabel(QFileInfo(description["script"].toString()).baseName());
+  }
+  op->setScript(script);
+  op->setArguments(description["arguments"].toObject().toVariantMap());
+  m_operators.append(op);
+  return op;
+}
+
+bool PipelineRunner::execute()
+{
+  Q_ASSERT(m_dataSource || m_reader);
+
+  vtkSmartPointer<vtkDataObject> data;
+  data.TakeReference(dataSource()->copyData());
+
+  // Reuse the tracer for the CPU time and GIL wait of each operator.
+  PipelineTracer::instance().setEnabled(true);
+
+  QTextStream& out = *m_report;
+  out << "operator\twall_ms\tcpu_ms\tgil_wait_ms\tpeak_memory_delta_mb\t"
+         "status\n";
+  out.flush();
+
+  QElapsedTimer total;
+  total.start();
+  m_childOutputs.clear();
+  bool success = runOperators(m_operators, data);
+  out << "total\t" << total.elapsed() << "\t\t\t\t"
+      << (success ? "complete" : "failed") << '\n';
+  out.flush();
+
+  m_output = vtkImageData::SafeDownCast(data);
+  return success && m_output;
+}
+
+bool PipelineRunner::runOperators(const QList<Operator*>& operators,
+                                  vtkDataObject* data)
+{
+  auto& tracer = PipelineTracer::instance();
+  QTextStream& out = *m_report;
+  foreach (Operator* op, operators) {
+    TransformResult result;
+    {
+      PipelineTracer::Scope scope(op);
+      result = op->transform(data);
+    }
+
+    QString status = "complete";
+    if (result == TransformResult::Canceled) {
+      status = "canceled";
+    } else if (result == TransformResult::Error) {
+      status = "error";
+    }
+    PipelineTracer::Event event = tracer.events().last();
+    out << op->label() << '\t' << event.wallTime / 1000.0 << '\t'
+        << event.cpuTime / 1000.0 << '\t' << event.gilWaitTime / 1000.0
+        << '\t' << event.peakMemoryDelta / (1024.0 * 1024.0) << '\t'
+        << status << '\n';
+    out.flush();
+
+    if (result != TransformResult::Complete) {
+      return false;
+    }
+
+    // Reconstructions and the like publish their output as a child data
+    // source rather than modifying the input.
+    DataSource* child =
+      op->hasChildDataSource() ? op->childDataSource() : nullptr;
+    if (!child) {
+      continue;
+    }
+    vtkSmartPointer<vtkDataObject> childData;
+    childData.TakeReference(child->copyData());
+    if (!runOperators(m_childOperators.value(op), childData)) {
+      return false;
+    }
+    vtkImageData* image = vtkImageData::SafeDownCast(childData);
+    if (image) {
+      m_childOutputs.append(
+        qMakePair(child->filename(), vtkSmartPointer<vtkImageData>(image)));
+    }
+  }
+
+  return true;
+}
+
+bool PipelineRunner::executeStreamed(const QString& fileName)
+{
+  Q_ASSERT(m_dataSource || m_reader);
+
+  // Once loaded as a whole the data is processed in memory.
+  vtkAlgorithm* reader = nullptr;
+  if (m_reader && !m_dataSource) {
+    reader = vtkAlgorithm::SafeDownCast(m_reader->GetClientSideObject());
+  }
+  if (!reader || !SlabStreamer::canStream(m_operators)) {
+    qWarning() << "The pipeline can't be streamed, the data is processed as a "
+                  "whole.";
+    return execute() && write(fileName);
+  }
+
+  SlabStreamer streamer(reader, m_operators, fileName);
+  if (m_overrideSpacing) {
+    streamer.setSpacing(m_spacing);
+  }
+
+  QTextStream& out = *m_report;
+  out << "operator\twall_ms\tcpu_ms\tgil_wait_ms\tpeak_memory_delta_mb\t"
+         "status\n";
+  out.flush();
+
+  // The operators run once per slab, report the time of each slab.
+  QElapsedTimer total;
+  QElapsedTimer slabTimer;
+  connect(&streamer, &SlabStreamer::progress,
+          [&out, &slabTimer](int slabs, int totalSlabs) {
+            out << "slab " << slabs << '/' << totalSlabs << '\t'
+                << slabTimer.restart() << "\t\t\t\tcomplete\n";
+            out.flush();
+          });
+  total.start();
+  slabTimer.start();
+  bool success = streamer.execute();
+  out << "total\t" << total.elapsed() << "\t\t\t\t"
+      << (success ? "complete" : "failed") << '\n';
+  out.flush();
+
+  return success;
+}
+
+bool PipelineRunner::write(const QString& fileName)
+{
+  if (!m_output) {
+    qCritical() << "The pipeline has not produced any image data";
+    return false;
+  }
+  if (!writeImage(fileName, m_output)) {
+    return false;
+  }
+
+  QStringList childFiles = childFileNames(fileName);
+  for (int i = 0; i < m_childOutputs.size(); ++i) {
+    if (!writeImage(childFiles[i], m_childOutputs[i].second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+QStringList PipelineRunner::childFileNames(const QString& fileName) const
+{
+  QFileInfo info(fileName);
+  QStringList fileNames;
+  foreach (const auto& child, m_childOutputs) {
+    QString label = child.first;
+    label.replace(QRegularExpression("[^A-Za-z0-9_-]+"), "_");
+    QString base = info.completeBaseName() + '_' + label;
+    QString name = info.dir().filePath(base + '.' + info.suffix());
+    // Several children may have the same label.
+    for (int i = 2; fileNames.contains(name); ++i) {
+      name = info.dir().filePath(QString("%1_%2.%3")
+                                   .arg(base)
+                                   .arg(i)
+                                   .arg(info.suffix()));
+    }
+    fileNames << name;
+  }
+
+  return fileNames;
+}
+
+bool PipelineRunner::writeImage(const QString& fileName, vtkImageData* image)
+{
+  bool written = false;
+  if (QFileInfo(fileName).suffix().toLower() == "vti") {
+    vtkNew<vtkXMLImageDataWriter> writer;
+    writer->SetFileName(fileName.toLatin1().data());
+    writer->SetInputData(image);
+    written = writer->Write() != 0;
+  } else {
+    EmdFormat emdFile;
+    written = emdFile.write(fileName.toLatin1().data(), image);
+  }
+  if (!written) {
+    qCritical() << "Failed to write" << fileName;
+  }
+
+  return written;
+}
+
+void PipelineRunner::setReportStream(QTextStream* stream)
+{
+  m_report = stream ? stream : &m_stdout;
+}
+}
@@ -0,0 +1,152 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPipelineRunner_h
+#define tomvizPipelineRunner_h
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include <vtkSmartPointer.h>
+#include <vtk_pugixml.h>
+
+class QJsonObject;
+class vtkDataObject;
+class vtkImageData;
+class vtkSMSourceProxy;
+
+namespace tomviz {
+
+class DataSource;
+class Operator;
+
+/// Executes a pipeline of operators on a data file without any user interface,
+/// used by the tomviz-pipeline executable. The operators come from a saved
+/// state file (.tvsm) or a JSON pipeline description, the modules and views of
+/// a state file are ignored. Operators are executed in order on the calling
+/// thread and the timing of each one is reported on the given stream.
+///
+/// Operators such as the reconstructions publish their output as a child data
+/// source, which is written next to the main output. The operators a state
+/// file applies to a child data source are applied to it first.
+class PipelineRunner : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// The exit codes of tomviz-pipeline.
+  enum ExitCode
+  {
+    Success = 0,
+    InvalidArguments = 1,
+    DataLoadFailed = 2,
+    PipelineLoadFailed = 3,
+    OperatorFailed = 4,
+    WriteFailed = 5
+  };
+
+  PipelineRunner(QObject* parent = nullptr);
+  ~PipelineRunner() override;
+
+  /// Prepare for executeStreamed(): loadData() then only reads the metadata
+  /// of the file, the data itself is read when it turns out to be needed as a
+  /// whole. Must be set before loadData().
+  void setStreaming(bool streaming);
+  bool streaming() const { return m_streaming; }
+
+  /// Load the data the pipeline is applied to.
+  bool loadData(const QString& fileName);
+
+  /// Load the operators from a state file or a JSON description, depending on
+  /// the extension. loadData() must be called first.
+  bool loadPipeline(const QString& fileName, int dataSourceIndex = 0);
+
+  /// Load the operators of the data source with the given index (in the order
+  /// they are saved) from a tomviz state file, along with the operators of
+  /// the child data sources they produce.
+  bool loadState(const QString& fileName, int dataSourceIndex = 0);
+
+  /// Load the operators from a JSON description of the form
+  ///   { "operators": [ { "type": "Python", "script": "...", ... }, ... ] }
+  /// Python operators take "label", "script" and "description", either
+  /// the name of a built-in operator or a path relative to the JSON file, and
+  /// an "arguments" object. The other keys of other operator types are passed
+  /// as attributes to Operator::deserialize().
+  bool loadJson(const QString& fileName);
+
+  QList<Operator*> operators() const { return m_operators; }
+
+  /// Apply the operators in order. Returns false as soon as an operator fails.
+  bool execute();
+
+  /// Apply the operators one Z slab at a time and write the result to a VTK
+  /// XML image file, see SlabStreamer. If an operator doesn't support slabs,
+  /// or the data can't be streamed, this falls back to execute() and write().
+  bool executeStreamed(const QString& fileName);
+
+  /// Write the output of the pipeline, as VTK XML image data if the file name
+  /// ends with .vti, in the EMD format otherwise. The output of each child
+  /// data source is written to <name>_<label>.<extension> in the same
+  /// directory, see childFileNames().
+  bool write(const QString& fileName);
+
+  /// The files the child data source outputs are written to by write().
+  QStringList childFileNames(const QString& fileName) const;
+
+  /// Set the stream the per operator timings are written to, stdout by default.
+  void setReportStream(QTextStream* stream);
+
+private:
+  Q_DISABLE_COPY(PipelineRunner)
+
+  // Add the operators of the data source node to the list, and those of the
+  // child data sources they produce to m_childOperators.
+  bool addOperators(const pugi::xml_node& root, const pugi::xml_node& dsnode,
+                    QList<Operator*>& operators);
+  Operator* addOperator(const QString& type, const pugi::xml_node& node,
+                        QList<Operator*>& operators);
+  Operator* addPythonOperator(const QJsonObject& description,
+                              const QString& baseDir);
+
+  // Apply the operators to data, and the child operators to the child data
+  // sources produced on the way.
+  bool runOperators(const QList<Operator*>& operators, vtkDataObject* data);
+  bool writeImage(const QString& fileName, vtkImageData* image);
+
+  // The data source, created from the reader when streaming.
+  DataSource* dataSource();
+  void setSpacing(const double spacing[3]);
+
+  bool m_streaming = false;
+  vtkSmartPointer<vtkSMSourceProxy> m_reader;
+  bool m_overrideSpacing = false;
+  double m_spacing[3];
+  DataSource* m_dataSource = nullptr;
+  QList<Operator*> m_operators;
+  QMap<Operator*, QList<Operator*>> m_childOperators;
+  vtkSmartPointer<vtkImageData> m_output;
+  // The label and output of each child data source.
+  QList<QPair<QString, vtkSmartPointer<vtkImageData>>> m_childOutputs;
+  QTextStream m_stdout;
+  QTextStream* m_report;
+};
+}
+
+#endif
@@ -0,0 +1,139 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <QApplication>
+
+#include <QCommandLineParser>
+#include <QDebug>
+
+#include <pqApplicationCore.h>
+#include <pqObjectBuilder.h>
+#include <pqPVApplicationCore.h>
+#include <pqServerResource.h>
+
+#include "PipelineRunner.h"
+#include "PipelineTracer.h"
+#include "tomvizConfig.h"
+#include "tomvizPythonConfig.h"
+
+#include <clocale>
+
+using tomviz::PipelineRunner;
+
+int main(int argc, char** argv)
+{
+  // Compute nodes have no display.
+  if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  // Share the settings (thread budget, caches...) of the application.
+  QCoreApplication::setApplicationName("tomviz");
+  QCoreApplication::setApplicationVersion(TOMVIZ_VERSION);
+  QCoreApplication::setOrganizationName("tomviz");
+
+  tomviz::InitializePythonEnvironment(argc, argv);
+
+  QApplication app(argc, argv);
+
+#if defined(__APPLE__)
+  std::string exeDir = QApplication::applicationDirPath().toLatin1().data();
+  if (!tomviz::isBuildDir(exeDir)) {
+    QByteArray pythonPath =
+      (exeDir + tomviz::PythonInitializationPythonPath()).c_str();
+    qputenv("PYTHONPATH", pythonPath);
+    qputenv("PYTHONHOME", pythonPath);
+  }
+#endif
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+    "Apply a tomviz operator pipeline to a data file without a user interface. "
+    "The timing of each operator is written to stdout.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addPositionalArgument("input", "The data file to process.");
+  QCommandLineOption pipelineOption(
+    QStringList() << "p"
+                  << "pipeline",
+    "Saved state (.tvsm) or JSON pipeline description.", "file");
+  QCommandLineOption outputOption(
+    QStringList() << "o"
+                  << "output",
+    "Write the result to this EMD or VTK image (.vti) file.", "file");
+  QCommandLineOption indexOption(
+    "data-source",
+    "Index of the data source whose operators are read from a state file.",
+    "index", "0");
+  QCommandLineOption traceOption(
+    "trace", "Write a Chrome trace of the operators to this file.", "file");
+  QCommandLineOption streamOption(
+    "stream", "Process the data one Z slab at a time if every operator "
+              "supports it, for data that doesn't fit in memory. The output "
+              "must be a VTK image (.vti) file.");
+  parser.addOption(pipelineOption);
+  parser.addOption(outputOption);
+  parser.addOption(indexOption);
+  parser.addOption(traceOption);
+  parser.addOption(streamOption);
+  parser.process(app);
+
+  if (parser.positionalArguments().size() != 1 ||
+      !parser.isSet(pipelineOption) || !parser.isSet(outputOption)) {
+    qCritical("An input file, --pipeline and --output are required.");
+    return PipelineRunner::InvalidArguments;
+  }
+  bool stream = parser.isSet(streamOption);
+  if (stream &&
+      !parser.value(outputOption).endsWith(".vti", Qt::CaseInsensitive)) {
+    qCritical("The output of --stream must be a .vti file.");
+    return PipelineRunner::InvalidArguments;
+  }
+
+  setlocale(LC_NUMERIC, "C");
+
+  // Don't let ParaView parse our options.
+  int pvArgc = 1;
+  pqPVApplicationCore appCore(pvArgc, argv);
+  pqApplicationCore::instance()->getObjectBuilder()->createServer(
+    pqServerResource("builtin:"));
+
+  PipelineRunner runner;
+  runner.setStreaming(stream);
+  if (!runner.loadData(parser.positionalArguments()[0])) {
+    return PipelineRunner::DataLoadFailed;
+  }
+
+  if (!runner.loadPipeline(parser.value(pipelineOption),
+                          parser.value(indexOption).toInt())) {
+    return PipelineRunner::PipelineLoadFailed;
+  }
+
+  // When streaming the output is written as it is produced.
+  bool success = stream ? runner.executeStreamed(parser.value(outputOption))
+                        : runner.execute();
+  if (parser.isSet(traceOption)) {
+    tomviz::PipelineTracer::instance().writeChromeTrace(
+      parser.value(traceOption));
+  }
+  if (!success) {
+    return PipelineRunner::OperatorFailed;
+  }
+
+  if (!stream && !runner.write(parser.value(outputOption))) {
+    return PipelineRunner::WriteFailed;
+  }
+  return PipelineRunner::Success;
+}
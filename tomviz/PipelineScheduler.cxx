@@ -0,0 +1,230 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PipelineScheduler.h"
+
+#include "ActiveObjects.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkSMPTools.h>
+
+#include <QRunnable>
+#include <QThread>
+
+namespace tomviz {
+
+namespace {
+
+// Threads only Interactive jobs may use, on top of the operator threads.
+const int reservedInteractiveThreads = 1;
+}
+
+/// Runs a submitted runnable on the pool and lets the scheduler know when it
+/// is done so the next job can be started.
+class PipelineScheduler::Task : public QRunnable
+{
+public:
+  Task(QRunnable* runnable) : m_runnable(runnable) {}
+
+  void run() override
+  {
+    m_runnable->run();
+    // Like QThreadPool, delete the runnables that ask for it.
+    if (m_runnable->autoDelete()) {
+      delete m_runnable;
+    }
+    QMetaObject::invokeMethod(&PipelineScheduler::instance(), "taskFinished",
+                              Qt::QueuedConnection);
+  }
+
+private:
+  QRunnable* m_runnable;
+};
+
+PipelineScheduler::PipelineScheduler(QObject* parentObject)
+  : QObject(parentObject)
+{
+  auto cores = QThread::idealThreadCount();
+  if (cores < 1) {
+    cores = 1;
+  }
+  // By default use half of the cores to run operators side by side, the other
+  // half is available to the operators themselves.
+  auto operatorThreads = qMax(cores / 2, 1);
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    auto settings = core->settings();
+    cores = settings->value("tomviz/pipeline/CoreBudget", cores).toInt();
+    operatorThreads =
+      settings->value("tomviz/pipeline/OperatorThreads", operatorThreads)
+        .toInt();
+  }
+  m_coreBudget = qMax(cores, 1);
+  m_operatorThreads = qBound(1, operatorThreads, m_coreBudget);
+  applyBudget();
+}
+
+PipelineScheduler::~PipelineScheduler()
+{
+  m_pool.waitForDone();
+}
+
+PipelineScheduler& PipelineScheduler::instance()
+{
+  static PipelineScheduler theInstance;
+  return theInstance;
+}
+
+void PipelineScheduler::submit(QRunnable* runnable, DataSource* dataSource,
+                               Priority priority)
+{
+  Job job;
+  job.runnable = runnable;
+  job.dataSource = dataSource;
+  job.priority = priority;
+  job.queued.start();
+  m_queue.append(job);
+
+  dispatch();
+  emit statisticsChanged();
+}
+
+bool PipelineScheduler::cancel(QRunnable* runnable)
+{
+  for (int i = 0; i < m_queue.size(); ++i) {
+    if (m_queue[i].runnable == runnable) {
+      m_queue.removeAt(i);
+      emit statisticsChanged();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void PipelineScheduler::setCoreBudget(int cores)
+{
+  m_coreBudget = qMax(cores, 1);
+  m_operatorThreads = qMin(m_operatorThreads, m_coreBudget);
+  applyBudget();
+  dispatch();
+}
+
+int PipelineScheduler::coreBudget() const
+{
+  return m_coreBudget;
+}
+
+void PipelineScheduler::setOperatorThreads(int threads)
+{
+  m_operatorThreads = qBound(1, threads, m_coreBudget);
+  applyBudget();
+  dispatch();
+}
+
+int PipelineScheduler::operatorThreads() const
+{
+  return m_operatorThreads;
+}
+
+int PipelineScheduler::threadsPerOperator() const
+{
+  return qMax(m_coreBudget / m_operatorThreads, 1);
+}
+
+int PipelineScheduler::queueDepth() const
+{
+  return m_queue.size();
+}
+
+int PipelineScheduler::runningCount() const
+{
+  return m_running;
+}
+
+qint64 PipelineScheduler::averageWaitTime() const
+{
+  return m_started > 0 ? m_totalWaitTime / m_started : 0;
+}
+
+qint64 PipelineScheduler::maximumWaitTime() const
+{
+  return m_maximumWaitTime;
+}
+
+void PipelineScheduler::resetStatistics()
+{
+  m_totalWaitTime = 0;
+  m_maximumWaitTime = 0;
+  m_started = 0;
+  emit statisticsChanged();
+}
+
+void PipelineScheduler::taskFinished()
+{
+  --m_running;
+  dispatch();
+  emit statisticsChanged();
+}
+
+void PipelineScheduler::dispatch()
+{
+  while (m_running < m_operatorThreads + reservedInteractiveThreads &&
+         !m_queue.isEmpty()) {
+    int next = nextJob();
+    // Interactive jobs are picked first, only they get the reserved threads.
+    if (m_running >= m_operatorThreads &&
+        m_queue[next].priority != Priority::Interactive) {
+      break;
+    }
+    Job job = m_queue.takeAt(next);
+    auto waited = job.queued.elapsed();
+    m_totalWaitTime += waited;
+    m_maximumWaitTime = qMax(m_maximumWaitTime, waited);
+    ++m_started;
+    ++m_running;
+    m_pool.start(new Task(job.runnable));
+  }
+}
+
+int PipelineScheduler::nextJob() const
+{
+  auto active = ActiveObjects::instance().activeDataSource();
+  int next = 0;
+  for (int i = 1; i < m_queue.size(); ++i) {
+    const Job& job = m_queue[i];
+    const Job& best = m_queue[next];
+    // The queue is in submission order, so only a strictly better job wins.
+    if (job.priority != best.priority) {
+      if (job.priority > best.priority) {
+        next = i;
+      }
+    } else if (job.dataSource == active && best.dataSource != active) {
+      next = i;
+    }
+  }
+
+  return next;
+}
+
+void PipelineScheduler::applyBudget()
+{
+  m_pool.setMaxThreadCount(m_operatorThreads + reservedInteractiveThreads);
+  // Note that depending on the SMP backend VTK may only honor the first call.
+  vtkSMPTools::Initialize(threadsPerOperator());
+}
+}
@@ -0,0 +1,138 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPipelineScheduler_h
+#define tomvizPipelineScheduler_h
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+
+class QRunnable;
+
+namespace tomviz {
+
+class DataSource;
+
+/// Schedules the operators of every DataSource's pipeline on a shared thread
+/// pool. Each pipeline run submits one operator at a time, so independent
+/// DataSources execute concurrently while the operators of a single pipeline
+/// still run in order.
+///
+/// Queued operators are started by priority, then operators of the active
+/// DataSource ahead of background ones, then in submission order. Operators
+/// already running are never interrupted, the active DataSource preempts
+/// others at operator boundaries.
+///
+/// The core budget is split between operator level parallelism (the number of
+/// operators running at once) and the threads each operator may use
+/// internally through vtkSMPTools.
+///
+/// One more thread is reserved for Interactive jobs, so that previews still
+/// start while long running operators (e.g. reconstructions) hold every
+/// operator thread.
+///
+/// All methods must be called from the main thread.
+class PipelineScheduler : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum class Priority
+  {
+    Background,
+    Normal,
+    Interactive
+  };
+
+  /// Returns reference to the singleton instance.
+  static PipelineScheduler& instance();
+
+  /// Queue runnable to run on behalf of dataSource. As with QThreadPool the
+  /// runnable is deleted once it has run if autoDelete() is set, otherwise it
+  /// must stay alive until it has run or has been canceled.
+  void submit(QRunnable* runnable, DataSource* dataSource,
+              Priority priority = Priority::Normal);
+
+  /// Remove runnable from the queue. Returns false if it is not queued, i.e.
+  /// it has already been started.
+  bool cancel(QRunnable* runnable);
+
+  /// Set the total number of cores the pipelines may use, the budget is read
+  /// from the application settings by default.
+  void setCoreBudget(int cores);
+  int coreBudget() const;
+
+  /// Set the number of operators that may run at the same time, the rest of
+  /// the core budget goes to the operators themselves. Interactive jobs may
+  /// use one more thread.
+  void setOperatorThreads(int threads);
+  int operatorThreads() const;
+
+  /// The number of threads each running operator may use internally.
+  int threadsPerOperator() const;
+
+  /// Returns the number of operators waiting for a thread.
+  int queueDepth() const;
+
+  /// Returns the number of operators currently running.
+  int runningCount() const;
+
+  /// Time operators spent in the queue before starting, in milliseconds.
+  qint64 averageWaitTime() const;
+  qint64 maximumWaitTime() const;
+  void resetStatistics();
+
+signals:
+  /// Emitted when the queue depth, running count or wait times change.
+  void statisticsChanged();
+
+private slots:
+  void taskFinished();
+
+private:
+  PipelineScheduler(QObject* parent = nullptr);
+  ~PipelineScheduler() override;
+  Q_DISABLE_COPY(PipelineScheduler)
+
+  class Task;
+  struct Job
+  {
+    QRunnable* runnable;
+    QPointer<DataSource> dataSource;
+    Priority priority;
+    QElapsedTimer queued;
+  };
+
+  // Start queued jobs while there are free operator threads.
+  void dispatch();
+  // Returns the index of the queued job to start next.
+  int nextJob() const;
+  void applyBudget();
+
+  QThreadPool m_pool;
+  QList<Job> m_queue;
+  int m_running = 0;
+  int m_coreBudget = 1;
+  int m_operatorThreads = 1;
+  qint64 m_totalWaitTime = 0;
+  qint64 m_maximumWaitTime = 0;
+  int m_started = 0;
+};
+}
+
+#endif
@@ -0,0 +1,166 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PipelineTraceDialog.h"
+
+#include "PipelineTracer.h"
+
+#include <QCheckBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMap>
+#include <QMessageBox>
+#include <QPair>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+struct Totals
+{
+  int runs = 0;
+  qint64 waitTime = 0;
+  qint64 wallTime = 0;
+  qint64 cpuTime = 0;
+  qint64 gilWaitTime = 0;
+  qint64 peakMemoryDelta = 0;
+  qint64 bytesCopied = 0;
+};
+
+QString formatTime(qint64 microseconds)
+{
+  return QString("%1 ms").arg(microseconds / 1000.0, 0, 'f', 1);
+}
+
+QString formatBytes(qint64 bytes)
+{
+  return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+}
+}
+
+namespace tomviz {
+
+PipelineTraceDialog::PipelineTraceDialog(QWidget* parentObject)
+  : Superclass(parentObject)
+{
+  setWindowTitle("Pipeline Trace");
+  auto layout = new QVBoxLayout(this);
+
+  m_record = new QCheckBox("Record", this);
+  m_record->setChecked(PipelineTracer::instance().isEnabled());
+  connect(m_record, SIGNAL(toggled(bool)), SLOT(setRecording(bool)));
+  layout->addWidget(m_record);
+
+  QStringList labels;
+  labels << "Operator"
+         << "Data Source"
+         << "Runs"
+         << "Wait"
+         << "Wall"
+         << "CPU"
+         << "Peak Memory Growth"
+         << "Copied"
+         << "GIL wait";
+  m_table = new QTableWidget(0, labels.size(), this);
+  m_table->setHorizontalHeaderLabels(labels);
+  m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  m_table->setSortingEnabled(true);
+  m_table->verticalHeader()->hide();
+  m_table->horizontalHeader()->setStretchLastSection(true);
+  layout->addWidget(m_table);
+
+  auto buttons = new QHBoxLayout;
+  auto clearButton = new QPushButton("Clear", this);
+  connect(clearButton, SIGNAL(clicked()), SLOT(clear()));
+  auto exportButton = new QPushButton("Export Chrome Trace...", this);
+  connect(exportButton, SIGNAL(clicked()), SLOT(exportTrace()));
+  auto closeButton = new QPushButton("Close", this);
+  connect(closeButton, SIGNAL(clicked()), SLOT(close()));
+  buttons->addWidget(clearButton);
+  buttons->addWidget(exportButton);
+  buttons->addStretch();
+  buttons->addWidget(closeButton);
+  layout->addLayout(buttons);
+
+  // Events are recorded on the worker threads, the connection is queued.
+  connect(&PipelineTracer::instance(), SIGNAL(eventRecorded()),
+          SLOT(refresh()));
+
+  resize(800, 400);
+  refresh();
+}
+
+PipelineTraceDialog::~PipelineTraceDialog()
+{
+}
+
+void PipelineTraceDialog::setRecording(bool record)
+{
+  PipelineTracer::instance().setEnabled(record);
+}
+
+void PipelineTraceDialog::clear()
+{
+  PipelineTracer::instance().clear();
+  refresh();
+}
+
+void PipelineTraceDialog::exportTrace()
+{
+  QString fileName = QFileDialog::getSaveFileName(
+    this, "Export Chrome Trace", QString(), "JSON files (*.json)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+  if (!PipelineTracer::instance().writeChromeTrace(fileName)) {
+    QMessageBox::warning(this, "Export Failed",
+                         QString("Unable to write %1").arg(fileName));
+  }
+}
+
+void PipelineTraceDialog::refresh()
+{
+  QMap<QPair<QString, QString>, Totals> totals;
+  foreach (const PipelineTracer::Event& event,
+           PipelineTracer::instance().events()) {
+    Totals& total = totals[qMakePair(event.name, event.dataSource)];
+    ++total.runs;
+    total.waitTime += event.waitTime;
+    total.wallTime += event.wallTime;
+    total.cpuTime += event.cpuTime;
+    total.gilWaitTime += event.gilWaitTime;
+    total.peakMemoryDelta += event.peakMemoryDelta;
+    total.bytesCopied += event.bytesCopied;
+  }
+
+  m_table->setSortingEnabled(false);
+  m_table->setRowCount(totals.size());
+  int row = 0;
+  for (auto it = totals.constBegin(); it != totals.constEnd(); ++it, ++row) {
+    const Totals& total = it.value();
+    QStringList values;
+    values << it.key().first << it.key().second << QString::number(total.runs)
+           << formatTime(total.waitTime) << formatTime(total.wallTime)
+           << formatTime(total.cpuTime) << formatBytes(total.peakMemoryDelta)
+           << formatBytes(total.bytesCopied) << formatTime(total.gilWaitTime);
+    for (int column = 0; column < values.size(); ++column) {
+      m_table->setItem(row, column, new QTableWidgetItem(values[column]));
+    }
+  }
+  m_table->setSortingEnabled(true);
+}
+}
@@ -0,0 +1,51 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPipelineTraceDialog_h
+#define tomvizPipelineTraceDialog_h
+
+#include <QDialog>
+
+class QCheckBox;
+class QTableWidget;
+
+namespace tomviz {
+
+/// Summary of the events recorded by the PipelineTracer, one row per operator
+/// and data source with the totals of all the runs.
+class PipelineTraceDialog : public QDialog
+{
+  Q_OBJECT
+  typedef QDialog Superclass;
+
+public:
+  PipelineTraceDialog(QWidget* parent = nullptr);
+  ~PipelineTraceDialog() override;
+
+private slots:
+  void setRecording(bool record);
+  void clear();
+  void exportTrace();
+  void refresh();
+
+private:
+  Q_DISABLE_COPY(PipelineTraceDialog)
+
+  QCheckBox* m_record = nullptr;
+  QTableWidget* m_table = nullptr;
+};
+}
+
+#endif
@@ -0,0 +1,232 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PipelineTracer.h"
+
+#include "DataSource.h"
+#include "Operator.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+// Must come after windows.h
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+namespace {
+
+// Work attributed to the operator running on this thread.
+thread_local qint64 bytesCopied = 0;
+thread_local qint64 gilWaitTime = 0;
+
+// CPU time used by the calling thread, in microseconds.
+qint64 threadCpuTime()
+{
+#if defined(Q_OS_WIN)
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  ULARGE_INTEGER kernelTime, userTime;
+  kernelTime.LowPart = kernel.dwLowDateTime;
+  kernelTime.HighPart = kernel.dwHighDateTime;
+  userTime.LowPart = user.dwLowDateTime;
+  userTime.HighPart = user.dwHighDateTime;
+  // In 100 nanosecond intervals
+  return static_cast<qint64>((kernelTime.QuadPart + userTime.QuadPart) / 10);
+#else
+  timespec time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+    return 0;
+  }
+  return static_cast<qint64>(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+#endif
+}
+
+// Peak resident set size of the process, in bytes.
+qint64 peakMemory()
+{
+#if defined(Q_OS_WIN)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters))) {
+    return 0;
+  }
+  return static_cast<qint64>(counters.PeakWorkingSetSize);
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(Q_OS_MAC)
+  return static_cast<qint64>(usage.ru_maxrss);
+#else
+  // In kilobytes
+  return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+}
+
+namespace tomviz {
+
+PipelineTracer::Scope::Scope(Operator* op, qint64 waitTime)
+{
+  auto& tracer = PipelineTracer::instance();
+  m_active = op && tracer.isEnabled();
+  if (!m_active) {
+    return;
+  }
+
+  m_event.name = op->label();
+  if (op->dataSource()) {
+    m_event.dataSource = op->dataSource()->filename();
+  }
+  m_event.waitTime = waitTime;
+  m_event.thread = reinterpret_cast<quint64>(QThread::currentThreadId());
+  m_event.start = tracer.m_epoch.nsecsElapsed() / 1000;
+  m_timer.start();
+  m_cpuStart = threadCpuTime();
+  m_peakMemoryStart = peakMemory();
+  m_bytesCopiedStart = bytesCopied;
+  m_gilWaitTimeStart = gilWaitTime;
+}
+
+PipelineTracer::Scope::~Scope()
+{
+  if (!m_active) {
+    return;
+  }
+
+  m_event.wallTime = m_timer.nsecsElapsed() / 1000;
+  m_event.cpuTime = threadCpuTime() - m_cpuStart;
+  m_event.peakMemoryDelta = peakMemory() - m_peakMemoryStart;
+  m_event.bytesCopied = bytesCopied - m_bytesCopiedStart;
+  m_event.gilWaitTime = gilWaitTime - m_gilWaitTimeStart;
+  PipelineTracer::instance().record(m_event);
+}
+
+PipelineTracer::PipelineTracer() : QObject(), m_enabled(false)
+{
+  m_epoch.start();
+}
+
+PipelineTracer& PipelineTracer::instance()
+{
+  static PipelineTracer theInstance;
+  return theInstance;
+}
+
+void PipelineTracer::setEnabled(bool enable)
+{
+  m_enabled = enable;
+}
+
+bool PipelineTracer::isEnabled() const
+{
+  return m_enabled;
+}
+
+QList<PipelineTracer::Event> PipelineTracer::events() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_events;
+}
+
+void PipelineTracer::clear()
+{
+  QMutexLocker locker(&m_mutex);
+  m_events.clear();
+}
+
+bool PipelineTracer::writeChromeTrace(const QString& fileName) const
+{
+  QJsonArray traceEvents;
+  foreach (const Event& event, events()) {
+    // JSON numbers are doubles, which is plenty for microseconds.
+    QJsonObject args;
+    args["dataSource"] = event.dataSource;
+    args["waitTime_us"] = static_cast<double>(event.waitTime);
+    args["cpuTime_us"] = static_cast<double>(event.cpuTime);
+    args["gilWaitTime_us"] = static_cast<double>(event.gilWaitTime);
+    args["peakMemoryDelta_bytes"] =
+      static_cast<double>(event.peakMemoryDelta);
+    args["bytesCopied"] = static_cast<double>(event.bytesCopied);
+
+    QJsonObject complete;
+    complete["name"] = event.name;
+    complete["cat"] = "operator";
+    complete["ph"] = "X";
+    complete["ts"] = static_cast<double>(event.start);
+    complete["dur"] = static_cast<double>(event.wallTime);
+    complete["pid"] = 1;
+    complete["tid"] = QString::number(event.thread);
+    complete["args"] = args;
+    traceEvents.append(complete);
+
+    // Show the time spent waiting for a thread just before the operator.
+    if (event.waitTime > 0) {
+      QJsonObject queued;
+      queued["name"] = event.name + " (queued)";
+      queued["cat"] = "queue";
+      queued["ph"] = "X";
+      queued["ts"] = static_cast<double>(event.start - event.waitTime);
+      queued["dur"] = static_cast<double>(event.waitTime);
+      queued["pid"] = 1;
+      queued["tid"] = "queue";
+      traceEvents.append(queued);
+    }
+  }
+
+  QJsonObject root;
+  root["traceEvents"] = traceEvents;
+  root["displayTimeUnit"] = "ms";
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+
+  return file.write(QJsonDocument(root).toJson()) >= 0;
+}
+
+void PipelineTracer::addBytesCopied(qint64 bytes)
+{
+  bytesCopied += bytes;
+}
+
+void PipelineTracer::addGilWaitTime(qint64 microseconds)
+{
+  gilWaitTime += microseconds;
+}
+
+void PipelineTracer::record(const Event& event)
+{
+  {
+    QMutexLocker locker(&m_mutex);
+    m_events.append(event);
+  }
+  emit eventRecorded();
+}
+}
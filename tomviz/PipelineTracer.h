@@ -0,0 +1,120 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPipelineTracer_h
+#define tomvizPipelineTracer_h
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+
+namespace tomviz {
+
+class Operator;
+
+/// Records how long each operator of the pipelines takes and what it costs.
+/// Tracing is off by default, when enabled every operator executed by a
+/// PipelineWorker produces an Event. The events can be exported in the Chrome
+/// trace_event format (load them in chrome://tracing or Perfetto).
+///
+/// Events are recorded from the worker threads, all methods are thread safe.
+class PipelineTracer : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct Event
+  {
+    QString name;
+    QString dataSource;
+    /// Microseconds since the tracer was created.
+    qint64 start = 0;
+    /// Time spent in the scheduler queue, in microseconds.
+    qint64 waitTime = 0;
+    /// Wall clock and CPU time of the operator thread, in microseconds.
+    qint64 wallTime = 0;
+    qint64 cpuTime = 0;
+    /// Time the operator was blocked acquiring the Python GIL held by other
+    /// threads, in microseconds. How long it holds the GIL itself can't be
+    /// observed, extension modules release it while they compute.
+    qint64 gilWaitTime = 0;
+    /// Growth of the peak resident set size of the process while the operator
+    /// ran, in bytes. Operators running concurrently contribute to it too.
+    qint64 peakMemoryDelta = 0;
+    /// Bytes copied to give the operator private copies of shared arrays.
+    qint64 bytesCopied = 0;
+    quint64 thread = 0;
+  };
+
+  /// Traces the operator executed on the calling thread for the lifetime of
+  /// the scope. Does nothing if tracing is disabled.
+  class Scope
+  {
+  public:
+    Scope(Operator* op, qint64 waitTime = 0);
+    ~Scope();
+
+  private:
+    Q_DISABLE_COPY(Scope)
+
+    bool m_active = false;
+    Event m_event;
+    QElapsedTimer m_timer;
+    qint64 m_cpuStart = 0;
+    qint64 m_peakMemoryStart = 0;
+    qint64 m_bytesCopiedStart = 0;
+    qint64 m_gilWaitTimeStart = 0;
+  };
+
+  /// Returns reference to the singleton instance.
+  static PipelineTracer& instance();
+
+  void setEnabled(bool enable);
+  bool isEnabled() const;
+
+  /// Returns the events recorded so far, in the order they completed.
+  QList<Event> events() const;
+  void clear();
+
+  /// Write the events to fileName in the Chrome trace_event JSON format.
+  bool writeChromeTrace(const QString& fileName) const;
+
+  /// Called by the code doing the work, the amounts are attributed to the
+  /// operator traced on the calling thread.
+  static void addBytesCopied(qint64 bytes);
+  static void addGilWaitTime(qint64 microseconds);
+
+signals:
+  /// Emitted from the worker thread when an event has been recorded.
+  void eventRecorded();
+
+private:
+  PipelineTracer();
+  Q_DISABLE_COPY(PipelineTracer)
+
+  void record(const Event& event);
+
+  std::atomic<bool> m_enabled;
+  QElapsedTimer m_epoch;
+  mutable QMutex m_mutex;
+  QList<Event> m_events;
+};
+}
+
+#endif
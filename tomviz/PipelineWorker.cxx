@@ -14,15 +14,20 @@
 
 ******************************************************************************/
 #include "PipelineWorker.h"
+
+#include "CheckpointCache.h"
 #include "Operator.h"
+#include "PipelineScheduler.h"
+#include "PipelineTracer.h"
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QQueue>
 #include <QRunnable>
-#include <QThreadPool>
 #include <QTimer>
 
 #include <vtkDataObject.h>
+#include <vtkImageData.h>
 
 namespace tomviz {
 
@@ -37,6 +42,13 @@ public:
   /// Returns the data the operator operates on
   vtkDataObject* data() { return m_data; };
   Operator* op() { return m_operator; };
+
+  /// Record the output of the operator in the cache once it completes.
+  void setCheckpoint(CheckpointCache* cache, int generation);
+
+  /// Called when the operator is queued, to trace how long it waited.
+  void queued() { m_queued.start(); }
+
   void run() override;
   void cancel();
   bool isCanceled();
@@ -47,6 +59,9 @@ signals:
 private:
   Operator* m_operator;
   vtkDataObject* m_data;
+  CheckpointCache* m_checkpointCache = nullptr;
+  int m_checkpointGeneration = 0;
+  QElapsedTimer m_queued;
   Q_DISABLE_COPY(RunnableOperator)
 };
 
@@ -63,7 +78,10 @@ class PipelineWorker::Run : public QObject
   };
 
 public:
-  Run(vtkDataObject* data, QList<Operator*> operators);
+  Run(vtkDataObject* data, QList<Operator*> operators,
+      CheckpointCache* cache = nullptr,
+      PipelineScheduler::Priority priority =
+        PipelineScheduler::Priority::Normal);
 
   /// Clear all Operators from the queue and attempts to cancel the
   /// running Operator.
@@ -98,6 +116,9 @@ signals:
 private:
   RunnableOperator* m_running = nullptr;
   vtkDataObject* m_data;
+  CheckpointCache* m_checkpointCache;
+  int m_checkpointGeneration = 0;
+  PipelineScheduler::Priority m_priority;
   QQueue<RunnableOperator*> m_runnableOperators;
   QList<RunnableOperator*> m_complete;
   State m_state = State::CREATED;
@@ -113,10 +134,25 @@ PipelineWorker::RunnableOperator::RunnableOperator(Operator* op,
   this->setAutoDelete(false);
 }
 
-void PipelineWorker::RunnableOperator::run()
+void PipelineWorker::RunnableOperator::setCheckpoint(CheckpointCache* cache,
+                                                     int generation)
 {
+  m_checkpointCache = cache;
+  m_checkpointGeneration = generation;
+}
 
+void PipelineWorker::RunnableOperator::run()
+{
+  PipelineTracer::Scope trace(
+    m_operator, m_queued.isValid() ? m_queued.nsecsElapsed() / 1000 : 0);
   TransformResult result = m_operator->transform(m_data);
+  // Take the checkpoint here on the worker thread, the copy can be expensive.
+  if (result == TransformResult::Complete && m_checkpointCache != nullptr) {
+    auto image = vtkImageData::SafeDownCast(m_data);
+    if (image) {
+      m_checkpointCache->insert(m_operator, image, m_checkpointGeneration);
+    }
+  }
   emit complete(result);
 }
 
@@ -130,21 +166,14 @@ bool PipelineWorker::RunnableOperator::isCanceled()
   return m_operator->isCanceled();
 }
 
-PipelineWorker::ConfigureThreadPool::ConfigureThreadPool()
+PipelineWorker::Run::Run(vtkDataObject* data, QList<Operator*> operators,
+                         CheckpointCache* cache,
+                         PipelineScheduler::Priority priority)
+  : m_data(data), m_checkpointCache(cache), m_priority(priority)
 {
-  auto threads = QThread::idealThreadCount();
-  if (threads < 1) {
-    threads = 1;
-  } else {
-    // Use half the threads we have available.
-    threads = threads / 2;
+  if (m_checkpointCache != nullptr) {
+    m_checkpointGeneration = m_checkpointCache->generation();
   }
-  QThreadPool::globalInstance()->setMaxThreadCount(threads);
-}
-
-PipelineWorker::Run::Run(vtkDataObject* data, QList<Operator*> operators)
-  : m_data(data)
-{
   foreach (auto op, operators) {
     m_runnableOperators.enqueue(new RunnableOperator(op, m_data, this));
   }
@@ -168,9 +197,16 @@ void PipelineWorker::Run::startNextOperator()
 
   if (!m_runnableOperators.isEmpty()) {
     m_running = m_runnableOperators.dequeue();
+    // There is no need to checkpoint the last operator, its output becomes the
+    // output of the data source.
+    if (m_checkpointCache != nullptr && !m_runnableOperators.isEmpty()) {
+      m_running->setCheckpoint(m_checkpointCache, m_checkpointGeneration);
+    }
     connect(m_running, &RunnableOperator::complete, this,
             &PipelineWorker::Run::operatorComplete);
-    QThreadPool::globalInstance()->start(m_running);
+    m_running->queued();
+    PipelineScheduler::instance().submit(
+      m_running, m_running->op()->dataSource(), m_priority);
   }
 }
 
@@ -207,9 +243,15 @@ void PipelineWorker::Run::cancel()
   m_state = State::CANCELED;
   // Try to cancel the currently running operator
   if (m_running != nullptr) {
-    QThreadPool::globalInstance()->cancel(m_running);
-    m_running->cancel();
+    auto running = m_running;
     m_running = nullptr;
+    // If the operator hasn't been started yet it will never complete.
+    if (PipelineScheduler::instance().cancel(running)) {
+      running->deleteLater();
+      emit canceled();
+    } else {
+      running->cancel();
+    }
   } else {
     emit canceled();
   }
@@ -220,7 +262,7 @@ bool PipelineWorker::Run::cancel(Operator* op)
 
   // If the operator is currently running we just have to cancel the execution
   // of the whole pipeline.
-  if (m_running->op() == op) {
+  if (m_running != nullptr && m_running->op() == op) {
     this->cancel();
     return false;
   }
@@ -267,7 +309,7 @@ PipelineWorker::Future* PipelineWorker::run(vtkDataObject* data,
     op->resetState();
   }
 
-  Run* run = new Run(data, operators);
+  Run* run = new Run(data, operators, m_checkpointCache, m_priority);
 
   return run->start();
 }
@@ -310,4 +352,24 @@ bool PipelineWorker::Future::addOperator(Operator* op)
 PipelineWorker::PipelineWorker(QObject* parent) : QObject(parent)
 {
 }
+
+void PipelineWorker::setCheckpointCache(CheckpointCache* cache)
+{
+  m_checkpointCache = cache;
+}
+
+CheckpointCache* PipelineWorker::checkpointCache() const
+{
+  return m_checkpointCache;
+}
+
+void PipelineWorker::setPriority(PipelineScheduler::Priority priority)
+{
+  m_priority = priority;
+}
+
+PipelineScheduler::Priority PipelineWorker::priority() const
+{
+  return m_priority;
+}
 }
@@ -16,6 +16,8 @@
 #ifndef tomvizPipelineWorker_h
 #define tomvizPipelineWorker_h
 
+#include "PipelineScheduler.h"
+
 #include <QList>
 #include <QObject>
 #include <QRunnable>
@@ -24,10 +26,11 @@ class vtkDataObject;
 
 namespace tomviz {
 
+class CheckpointCache;
 class Operator;
 
 /// Responsible for running Operator in a separate thread. Backed by the
-/// QThreadPool. Operators are run in sequence, one at a time.
+/// PipelineScheduler. Operators are run in sequence, one at a time.
 class PipelineWorker : public QObject
 {
   Q_OBJECT
@@ -38,16 +41,21 @@ public:
   Future* run(vtkDataObject* data, Operator* op);
   Future* run(vtkDataObject* data, QList<Operator*> ops);
 
+  /// Set the cache used to record the output of each operator as it completes,
+  /// the last operator of a run is not recorded. Can be nullptr.
+  void setCheckpointCache(CheckpointCache* cache);
+  CheckpointCache* checkpointCache() const;
+
+  /// Set the priority the operators of subsequent runs are scheduled with.
+  void setPriority(PipelineScheduler::Priority priority);
+  PipelineScheduler::Priority priority() const;
+
 private:
   class RunnableOperator;
   class Run;
-  class ConfigureThreadPool
-  {
-  public:
-    ConfigureThreadPool();
-  };
 
-  ConfigureThreadPool configure;
+  CheckpointCache* m_checkpointCache = nullptr;
+  PipelineScheduler::Priority m_priority = PipelineScheduler::Priority::Normal;
 };
 
 class PipelineWorker::Future : public QObject
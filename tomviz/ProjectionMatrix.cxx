@@ -0,0 +1,273 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "ProjectionMatrix.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+double removeEpsilon(double value, double epsilon)
+{
+  return std::abs(value) < epsilon ? 0.0 : value;
+}
+
+struct Intersection
+{
+  double t;
+  double x;
+  double y;
+  bool operator<(const Intersection& other) const { return t < other.t; }
+};
+
+// The entries of one row
+struct Row
+{
+  std::vector<int> columns;
+  std::vector<float> values;
+};
+
+// Intersect ray j of the projection with the pixel grid, see parallelRay() in
+// Recon_SIRT.py.
+void traceRay(int Nside, double pixelWidth, double xray, double yray,
+              double a, double b, const std::vector<double>& grid,
+              std::vector<Intersection>& points, Row& row)
+{
+  points.clear();
+  row.columns.clear();
+  row.values.clear();
+
+  // Ray: (x, y) = (a t + xray, b t + yray). A ray parallel to the grid lines
+  // of an axis never crosses them.
+  if (a != 0) {
+    for (double x : grid) {
+      double t = (x - xray) / a;
+      points.push_back({ t, x, b * t + yray });
+    }
+  }
+  if (b != 0) {
+    for (double y : grid) {
+      double t = (y - yray) / b;
+      points.push_back({ t, a * t + xray, y });
+    }
+  }
+  std::sort(points.begin(), points.end());
+
+  // Get rid of points that are outside the image grid
+  double half = Nside / 2.0 * pixelWidth;
+  points.erase(std::remove_if(points.begin(), points.end(),
+                              [half](const Intersection& p) {
+                                return !(p.x >= -half && p.x <= half &&
+                                         p.y >= -half && p.y <= half);
+                              }),
+               points.end());
+  if (points.empty()) {
+    return;
+  }
+
+  // Get rid of double counted points, keeping the last of each run
+  std::vector<Intersection> unique;
+  unique.reserve(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (i + 1 < points.size() &&
+        std::abs(points[i + 1].x - points[i].x) <= 1e-8 &&
+        std::abs(points[i + 1].y - points[i].y) <= 1e-8) {
+      continue;
+    }
+    unique.push_back(points[i]);
+  }
+
+  // Remove the rays on the top or right boundary of the image grid
+  if ((b == 0 && std::abs(yray - half) < 1e-15) ||
+      (a == 0 && std::abs(xray - half) < 1e-15)) {
+    return;
+  }
+
+  for (size_t i = 0; i + 1 < unique.size(); ++i) {
+    double dx = unique[i + 1].x - unique[i].x;
+    double dy = unique[i + 1].y - unique[i].y;
+    double length = std::sqrt(dx * dx + dy * dy);
+    double midX = removeEpsilon(0.5 * (unique[i].x + unique[i + 1].x), 1e-10);
+    double midY = removeEpsilon(0.5 * (unique[i].y + unique[i + 1].y), 1e-10);
+    int pixelY = static_cast<int>(std::floor(Nside / 2.0 - midY / pixelWidth));
+    int pixelX = static_cast<int>(std::floor(midX / pixelWidth + Nside / 2.0));
+    if (length <= 0 || pixelX < 0 || pixelX >= Nside || pixelY < 0 ||
+        pixelY >= Nside) {
+      continue;
+    }
+    row.columns.push_back(pixelY * Nside + pixelX);
+    row.values.push_back(static_cast<float>(length));
+  }
+}
+}
+
+namespace tomviz {
+
+ProjectionMatrix ProjectionMatrix::parallelRay(
+  int Nside, double pixelWidth, const std::vector<double>& angles, int Nray,
+  double rayWidth)
+{
+  int Nproj = static_cast<int>(angles.size());
+  std::vector<double> grid(Nside + 1);
+  for (int i = 0; i <= Nside; ++i) {
+    grid[i] = (-Nside * 0.5 + i) * pixelWidth;
+  }
+
+  // Rays of different projections are traced in parallel, each into its rows.
+  std::vector<Row> rows(static_cast<size_t>(Nproj) * Nray);
+  vtkSMPTools::For(0, Nproj, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<Intersection> points;
+    for (vtkIdType i = begin; i < end; ++i) {
+      double angle = angles[i] * pi / 180.0;
+      double a = removeEpsilon(-std::sin(angle), 1e-10);
+      double b = removeEpsilon(std::cos(angle), 1e-10);
+      for (int j = 0; j < Nray; ++j) {
+        double offset = (-(Nray - 1) / 2.0 + j) * rayWidth;
+        double xray = removeEpsilon(std::cos(angle) * offset, 1e-8);
+        double yray = removeEpsilon(std::sin(angle) * offset, 1e-8);
+        traceRay(Nside, pixelWidth, xray, yray, a, b, grid, points,
+                 rows[i * Nray + j]);
+      }
+    }
+  });
+
+  ProjectionMatrix matrix;
+  matrix.m_rows = Nproj * Nray;
+  matrix.m_columns = Nside * Nside;
+  matrix.m_rowOffsets.resize(rows.size() + 1, 0);
+  for (size_t r = 0; r < rows.size(); ++r) {
+    matrix.m_rowOffsets[r + 1] = matrix.m_rowOffsets[r] + rows[r].values.size();
+  }
+  matrix.m_columnIndices.reserve(matrix.m_rowOffsets.back());
+  matrix.m_values.reserve(matrix.m_rowOffsets.back());
+  for (auto& row : rows) {
+    matrix.m_columnIndices.insert(matrix.m_columnIndices.end(),
+                                  row.columns.begin(), row.columns.end());
+    matrix.m_values.insert(matrix.m_values.end(), row.values.begin(),
+                           row.values.end());
+    row = Row();
+  }
+  return matrix;
+}
+
+ProjectionMatrix ProjectionMatrix::transposed() const
+{
+  ProjectionMatrix transpose;
+  transpose.m_rows = m_columns;
+  transpose.m_columns = m_rows;
+  transpose.m_rowOffsets.assign(m_columns + 1, 0);
+  for (int column : m_columnIndices) {
+    ++transpose.m_rowOffsets[column + 1];
+  }
+  for (int c = 0; c < m_columns; ++c) {
+    transpose.m_rowOffsets[c + 1] += transpose.m_rowOffsets[c];
+  }
+  transpose.m_columnIndices.resize(m_columnIndices.size());
+  transpose.m_values.resize(m_values.size());
+  std::vector<size_t> next(transpose.m_rowOffsets.begin(),
+                           transpose.m_rowOffsets.end() - 1);
+  for (int r = 0; r < m_rows; ++r) {
+    for (size_t k = m_rowOffsets[r]; k < m_rowOffsets[r + 1]; ++k) {
+      size_t position = next[m_columnIndices[k]]++;
+      transpose.m_columnIndices[position] = r;
+      transpose.m_values[position] = m_values[k];
+    }
+  }
+  return transpose;
+}
+
+void ProjectionMatrix::forward(const float* image, float* sinogram,
+                               int count) const
+{
+  std::vector<double> sums(count);
+  for (int r = 0; r < m_rows; ++r) {
+    dot(r, image, &sums[0], count);
+    for (int k = 0; k < count; ++k) {
+      sinogram[static_cast<size_t>(r) * count + k] =
+        static_cast<float>(sums[k]);
+    }
+  }
+}
+
+void ProjectionMatrix::back(const float* sinogram, float* image,
+                            int count) const
+{
+  std::fill(image, image + static_cast<size_t>(m_columns) * count, 0.0f);
+  for (int r = 0; r < m_rows; ++r) {
+    const float* rays = sinogram + static_cast<size_t>(r) * count;
+    for (size_t n = m_rowOffsets[r]; n < m_rowOffsets[r + 1]; ++n) {
+      float value = m_values[n];
+      float* pixels = image + static_cast<size_t>(m_columnIndices[n]) * count;
+      for (int k = 0; k < count; ++k) {
+        pixels[k] += value * rays[k];
+      }
+    }
+  }
+}
+
+void ProjectionMatrix::dot(int r, const float* x, double* result,
+                           int count) const
+{
+  std::fill(result, result + count, 0.0);
+  for (size_t n = m_rowOffsets[r]; n < m_rowOffsets[r + 1]; ++n) {
+    double value = m_values[n];
+    const float* pixels = x + static_cast<size_t>(m_columnIndices[n]) * count;
+    for (int k = 0; k < count; ++k) {
+      result[k] += value * pixels[k];
+    }
+  }
+}
+
+void ProjectionMatrix::addRow(int r, const double* scales, float* x,
+                              int count) const
+{
+  for (size_t n = m_rowOffsets[r]; n < m_rowOffsets[r + 1]; ++n) {
+    double value = m_values[n];
+    float* pixels = x + static_cast<size_t>(m_columnIndices[n]) * count;
+    for (int k = 0; k < count; ++k) {
+      pixels[k] += static_cast<float>(scales[k] * value);
+    }
+  }
+}
+
+std::vector<double> ProjectionMatrix::rowSquaredNorms(
+  const std::vector<int>& columnWeights) const
+{
+  std::vector<double> norms(m_rows, 0.0);
+  for (int r = 0; r < m_rows; ++r) {
+    for (size_t k = m_rowOffsets[r]; k < m_rowOffsets[r + 1]; ++k) {
+      double weight =
+        columnWeights.empty() ? 1.0 : columnWeights[m_columnIndices[k]];
+      norms[r] += static_cast<double>(m_values[k]) * m_values[k] * weight;
+    }
+  }
+  return norms;
+}
+
+std::vector<int> ProjectionMatrix::columnCounts() const
+{
+  std::vector<int> counts(m_columns, 0);
+  for (int column : m_columnIndices) {
+    ++counts[column];
+  }
+  return counts;
+}
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizProjectionMatrix_h
+#define tomvizProjectionMatrix_h
+
+#include "Projector.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace tomviz {
+
+/// A sparse matrix in compressed sparse row (CSR) form, used as the system
+/// matrix A of the iterative reconstructions: each row is a ray of the tilt
+/// series, each column a pixel of the reconstructed slice, and the values are
+/// the lengths of the rays within the pixels. The same matrix is shared by all
+/// the slices of a reconstruction, it is read only once built.
+///
+/// The matrix has about 2 Nray Nside Nproj entries, see ParallelProjector for
+/// large sizes.
+class ProjectionMatrix : public Projector
+{
+public:
+  ProjectionMatrix() = default;
+
+  /// Build the matrix of parallel rays through an Nside by Nside grid, the
+  /// same as parallelRay() of the Python reconstructions. The row of ray j of
+  /// angle i (in degrees) is i * Nray + j, the column of pixel (y, x) is
+  /// y * Nside + x. Uses vtkSMPTools.
+  static ProjectionMatrix parallelRay(int Nside, double pixelWidth,
+                                      const std::vector<double>& angles,
+                                      int Nray, double rayWidth);
+
+  int rows() const override { return m_rows; }
+  int columns() const override { return m_columns; }
+  size_t nonZeros() const { return m_values.size(); }
+
+  /// The entries of row r are [rowOffsets()[r], rowOffsets()[r + 1]).
+  const std::vector<size_t>& rowOffsets() const { return m_rowOffsets; }
+  const std::vector<int>& columnIndices() const { return m_columnIndices; }
+  const std::vector<float>& values() const { return m_values; }
+
+  /// Returns the transpose, also in CSR form, so that A^T x can be computed
+  /// row by row without scattering.
+  ProjectionMatrix transposed() const;
+
+  /// Sparse matrix times dense matrix products when count > 1, the matrix is
+  /// read once for all the slices.
+  void forward(const float* image, float* sinogram,
+               int count = 1) const override;
+  void back(const float* sinogram, float* image, int count = 1) const override;
+  void dot(int r, const float* x, double* result,
+           int count = 1) const override;
+  void addRow(int r, const double* scales, float* x,
+              int count = 1) const override;
+  std::vector<double> rowSquaredNorms(
+    const std::vector<int>& columnWeights = std::vector<int>()) const override;
+  std::vector<int> columnCounts() const override;
+
+private:
+  int m_rows = 0;
+  int m_columns = 0;
+  std::vector<size_t> m_rowOffsets;
+  std::vector<int> m_columnIndices;
+  std::vector<float> m_values;
+};
+}
+
+#endif
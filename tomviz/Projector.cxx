@@ -0,0 +1,41 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "Projector.h"
+
+namespace tomviz {
+
+void interleaveSlices(const float* const* slices, int count, size_t size,
+                      float* interleaved)
+{
+  for (int k = 0; k < count; ++k) {
+    const float* slice = slices[k];
+    for (size_t i = 0; i < size; ++i) {
+      interleaved[i * count + k] = slice[i];
+    }
+  }
+}
+
+void deinterleaveSlices(const float* interleaved, int count, size_t size,
+                        float* const* slices)
+{
+  for (int k = 0; k < count; ++k) {
+    float* slice = slices[k];
+    for (size_t i = 0; i < size; ++i) {
+      slice[i] = interleaved[i * count + k];
+    }
+  }
+}
+}
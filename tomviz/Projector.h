@@ -0,0 +1,77 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizProjector_h
+#define tomvizProjector_h
+
+#include <cstddef>
+#include <vector>
+
+namespace tomviz {
+
+/// The system matrix A of a 2D tomography reconstruction: each row is a ray
+/// of the sinogram, each column a pixel of the slice. Implementations can
+/// store the matrix (ProjectionMatrix) or compute its entries as needed
+/// (ParallelProjector). All the methods are const and thread safe.
+///
+/// The methods taking a count work on that many slices at once, each entry of
+/// A being applied to all of them before the next one. The slices are then
+/// interleaved, pixel c of slice k is image[c * count + k] and ray r of slice
+/// k is sinogram[r * count + k], see interleaveSlices().
+class Projector
+{
+public:
+  virtual ~Projector() = default;
+
+  /// The number of rays and of pixels.
+  virtual int rows() const = 0;
+  virtual int columns() const = 0;
+
+  /// sinogram = A image
+  virtual void forward(const float* image, float* sinogram,
+                       int count = 1) const = 0;
+
+  /// image = A^T sinogram
+  virtual void back(const float* sinogram, float* image,
+                    int count = 1) const = 0;
+
+  /// result[k] = row r . slice k of x
+  virtual void dot(int r, const float* x, double* result,
+                   int count = 1) const = 0;
+
+  /// Slice k of x += scales[k] * row r
+  virtual void addRow(int r, const double* scales, float* x,
+                      int count = 1) const = 0;
+
+  /// Returns the squared norm of each row, sum_j A_rj^2 w_j. The column
+  /// weights w default to 1.
+  virtual std::vector<double> rowSquaredNorms(
+    const std::vector<int>& columnWeights = std::vector<int>()) const = 0;
+
+  /// Returns the number of non zero entries of each column.
+  virtual std::vector<int> columnCounts() const = 0;
+};
+
+/// Copy count slices of size values each into interleaved, of size * count
+/// values, so that value i of slice k is interleaved[i * count + k].
+void interleaveSlices(const float* const* slices, int count, size_t size,
+                      float* interleaved);
+
+/// The inverse of interleaveSlices().
+void deinterleaveSlices(const float* interleaved, int count, size_t size,
+                        float* const* slices);
+}
+
+#endif
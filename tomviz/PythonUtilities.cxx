@@ -18,10 +18,13 @@
 #include "vtkPython.h" // must be first
 
 #include "Logger.h"
+#include "PipelineTracer.h"
 #include "vtkPythonInterpreter.h"
 #include "vtkPythonUtil.h"
 #include "vtkSmartPyObject.h"
 
+#include <QElapsedTimer>
+
 #include <pybind11/pybind11.h>
 
 namespace tomviz {
@@ -305,8 +308,13 @@ void Python::initialize()
   vtkPythonInterpreter::Initialize();
 }
 
-Python::Python() : m_ensurer(new vtkPythonScopeGilEnsurer(true))
+Python::Python()
 {
+  // Acquiring the GIL blocks while another thread holds it.
+  QElapsedTimer timer;
+  timer.start();
+  m_ensurer = new vtkPythonScopeGilEnsurer(true);
+  PipelineTracer::addGilWaitTime(timer.nsecsElapsed() / 1000);
 }
 
 Python::~Python()
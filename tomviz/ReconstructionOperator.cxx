@@ -31,9 +31,13 @@
 #include "vtkSMSourceProxy.h"
 #include "vtkTrivialProducer.h"
 
-#include <QCoreApplication>
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+
 #include <QDebug>
 
+#include <atomic>
+
 namespace tomviz {
 ReconstructionOperator::ReconstructionOperator(DataSource* source, QObject* p)
   : Operator(p), m_dataSource(source)
@@ -65,21 +69,34 @@ QIcon ReconstructionOperator::icon() const
 
 Operator* ReconstructionOperator::clone() const
 {
-  return new ReconstructionOperator(m_dataSource);
+  auto op = new ReconstructionOperator(m_dataSource);
+  op->setFilter(m_filter);
+  return op;
 }
 
-bool ReconstructionOperator::serialize(pugi::xml_node&) const
+bool ReconstructionOperator::serialize(pugi::xml_node& ns) const
 {
-  // No state to serialize yet
+  ns.append_attribute("filter").set_value(static_cast<int>(m_filter));
   return true;
 }
 
-bool ReconstructionOperator::deserialize(const pugi::xml_node&)
+bool ReconstructionOperator::deserialize(const pugi::xml_node& ns)
 {
-  // No state to serialize yet
+  int filter = ns.attribute("filter").as_int(0);
+  if (filter < static_cast<int>(TomographyReconstruction::Filter::None) ||
+      filter > static_cast<int>(TomographyReconstruction::Filter::Hann)) {
+    qWarning() << "Unknown reconstruction filter" << filter;
+    return false;
+  }
+  setFilter(static_cast<TomographyReconstruction::Filter>(filter));
   return true;
 }
 
+void ReconstructionOperator::setFilter(TomographyReconstruction::Filter filter)
+{
+  m_filter = filter;
+}
+
 QWidget* ReconstructionOperator::getCustomProgressWidget(QWidget* p) const
 {
   ReconstructionWidget* widget = new ReconstructionWidget(m_dataSource, p);
@@ -110,8 +127,6 @@ bool ReconstructionOperator::applyTransform(vtkDataObject* dataObject)
   int numXSlices = dataExtent[1] - dataExtent[0] + 1;
   int numYSlices = dataExtent[3] - dataExtent[2] + 1;
   int numZSlices = dataExtent[5] - dataExtent[4] + 1;
-  std::vector<float> sinogramPtr(numYSlices * numZSlices);
-  std::vector<float> reconstructionPtr(numYSlices * numYSlices);
   QVector<double> tiltAngles;
 
   vtkFieldData* fd = dataObject->GetFieldData();
@@ -140,21 +155,37 @@ bool ReconstructionOperator::applyTransform(vtkDataObject* dataObject)
 
   // TODO: talk to Dave Lonie about how to do this in new data array API
   float* reconstruction = (float*)darray->GetVoidPointer(0);
-  for (int i = 0; i < numXSlices && !isCanceled(); ++i) {
-    QCoreApplication::processEvents();
-    TomographyTiltSeries::getSinogram(imageData, i, &sinogramPtr[0]);
-    TomographyReconstruction::unweightedBackProjection2(
-      &sinogramPtr[0], tiltAngles.data(), &reconstructionPtr[0], numZSlices,
-      numYSlices);
-    for (int j = 0; j < numYSlices; ++j) {
-      for (int k = 0; k < numYSlices; ++k) {
-        reconstruction[j * (numYSlices * numXSlices) + k * numXSlices + i] =
-          reconstructionPtr[k * numYSlices + j];
+
+  // Converted once up front, the threads only read it.
+  TomographyTiltSeries::SinogramStack sinogramStack(imageData);
+
+  // The slices are independent, each thread reconstructs whole slices into
+  // its own buffers and writes them to disjoint parts of the output.
+  vtkSMPThreadLocal<std::vector<float>> sinograms;
+  vtkSMPThreadLocal<std::vector<float>> slices;
+  std::atomic<int> slicesDone(0);
+  vtkSMPTools::For(0, numXSlices, 1, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<float>& sinogramPtr = sinograms.Local();
+    std::vector<float>& reconstructionPtr = slices.Local();
+    sinogramPtr.resize(numYSlices * numZSlices);
+    reconstructionPtr.resize(numYSlices * numYSlices);
+    for (vtkIdType i = begin; i < end && !isCanceled(); ++i) {
+      // Copied, the filter modifies it in place.
+      sinogramStack.getSinogram(i, &sinogramPtr[0]);
+      TomographyReconstruction::weightedBackProjection2(
+        &sinogramPtr[0], tiltAngles.data(), &reconstructionPtr[0], numZSlices,
+        numYSlices, m_filter);
+      for (int j = 0; j < numYSlices; ++j) {
+        for (int k = 0; k < numYSlices; ++k) {
+          reconstruction[j * (numYSlices * numXSlices) + k * numXSlices + i] =
+            reconstructionPtr[k * numYSlices + j];
+        }
       }
+      // Queued to the UI, the worker threads never touch the event loop.
+      emit intermediateResults(reconstructionPtr);
+      setProgressStep(++slicesDone);
     }
-    emit intermediateResults(reconstructionPtr);
-    setProgressStep(i);
-  }
+  });
   if (isCanceled()) {
     return false;
   }
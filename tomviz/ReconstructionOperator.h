@@ -17,6 +17,7 @@
 #define tomvizReconstructionOperator_h
 
 #include "Operator.h"
+#include "TomographyReconstruction.h"
 
 namespace tomviz {
 class DataSource;
@@ -38,9 +39,16 @@ public:
   bool deserialize(const pugi::xml_node& ns) override;
 
   bool hasCustomUI() const override { return false; }
+  bool modifiesDataInPlace() const override { return false; }
+  bool supportsPreview() const override { return false; }
 
   QWidget* getCustomProgressWidget(QWidget*) const override;
 
+  /// The filter applied to the sinograms before back projecting them, None
+  /// (the default) gives a simple back projection.
+  void setFilter(TomographyReconstruction::Filter filter);
+  TomographyReconstruction::Filter filter() const { return m_filter; }
+
 protected:
   bool applyTransform(vtkDataObject* data) override;
 
@@ -63,6 +71,8 @@ private slots:
 private:
   DataSource* m_dataSource;
   int m_extent[6];
+  TomographyReconstruction::Filter m_filter =
+    TomographyReconstruction::Filter::None;
   Q_DISABLE_COPY(ReconstructionOperator)
 };
 }
@@ -29,8 +29,9 @@
 
 namespace tomviz {
 
-ReconstructionReaction::ReconstructionReaction(QAction* parentObject)
-  : pqReaction(parentObject)
+ReconstructionReaction::ReconstructionReaction(
+  QAction* parentObject, TomographyReconstruction::Filter filter)
+  : pqReaction(parentObject), m_filter(filter)
 {
   connect(&ActiveObjects::instance(), SIGNAL(dataSourceChanged(DataSource*)),
           SLOT(updateEnableState()));
@@ -53,7 +54,8 @@ void ReconstructionReaction::recon(DataSource* input)
     return;
   }
 
-  Operator* op = new ReconstructionOperator(input);
+  auto op = new ReconstructionOperator(input);
+  op->setFilter(m_filter);
   input->addOperator(op);
 }
 }
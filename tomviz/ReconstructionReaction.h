@@ -18,6 +18,8 @@
 
 #include <pqReaction.h>
 
+#include "TomographyReconstruction.h"
+
 namespace tomviz {
 class DataSource;
 
@@ -26,7 +28,9 @@ class ReconstructionReaction : public pqReaction
   Q_OBJECT
 
 public:
-  ReconstructionReaction(QAction* parent);
+  ReconstructionReaction(QAction* parent,
+                         TomographyReconstruction::Filter filter =
+                           TomographyReconstruction::Filter::None);
 
   void recon(DataSource* input = NULL);
 
@@ -36,6 +40,8 @@ protected:
 
 private:
   Q_DISABLE_COPY(ReconstructionReaction)
+
+  TomographyReconstruction::Filter m_filter;
 };
 }
 
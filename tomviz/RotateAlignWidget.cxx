@@ -19,6 +19,8 @@
 #include "ActiveObjects.h"
 #include "DataSource.h"
 #include "LoadDataReaction.h"
+#include "PipelineScheduler.h"
+#include "TiltAxisEstimator.h"
 #include "TomographyReconstruction.h"
 #include "TomographyTiltSeries.h"
 #define PI 3.14159265359
@@ -60,16 +62,152 @@
 #include <QKeyEvent>
 #include <QLabel>
 #include <QLineEdit>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPointer>
 #include <QPushButton>
+#include <QRunnable>
+#include <QSharedPointer>
 #include <QSpinBox>
 #include <QTimer>
 #include <QVBoxLayout>
 
+#include <algorithm>
 #include <array>
+#include <vector>
 
 namespace tomviz {
 
+namespace {
+
+// Size of the 2D reconstructions, the preview is shown first while the full
+// size slice is computed.
+const int previewRays = 64;
+const int fullRays = 256;
+
+// The latest request of each reconstruction view, shared with the jobs so the
+// superseded ones can stop early.
+struct ReconRequests
+{
+  QAtomicInt latest[3];
+};
+
+/// The sinograms of a tilt series, a transposed copy of the whole series. The
+/// copy is made by the first background job that needs it and shared with the
+/// later ones, so the GUI thread never waits for it.
+class SharedSinograms
+{
+public:
+  explicit SharedSinograms(vtkImageData* tiltSeries) : m_tiltSeries(tiltSeries)
+  {
+  }
+
+  /// Build the sinograms on first use, the other callers wait for them.
+  const TomographyTiltSeries::SinogramStack& get()
+  {
+    QMutexLocker locker(&m_mutex);
+    if (!m_sinograms) {
+      m_sinograms.reset(new TomographyTiltSeries::SinogramStack(m_tiltSeries));
+      m_tiltSeries = nullptr;
+    }
+    return *m_sinograms;
+  }
+
+private:
+  Q_DISABLE_COPY(SharedSinograms)
+
+  QMutex m_mutex;
+  vtkSmartPointer<vtkImageData> m_tiltSeries;
+  QScopedPointer<TomographyTiltSeries::SinogramStack> m_sinograms;
+};
+
+/// Reconstructs one slice of the tilt series on the PipelineScheduler, first
+/// at preview size then at full size. Nothing is reported once a newer
+/// request has been made for the same view.
+class ReconSliceJob : public QObject, public QRunnable
+{
+  Q_OBJECT
+
+public:
+  ReconSliceJob(QSharedPointer<SharedSinograms> sinograms,
+                const std::vector<double>& tiltAngles, int view, int slice,
+                double shift, QSharedPointer<ReconRequests> requests)
+    : m_sinograms(sinograms), m_tiltAngles(tiltAngles), m_view(view),
+      m_slice(slice), m_shift(shift), m_requests(requests),
+      m_request(requests->latest[view].fetchAndAddOrdered(1) + 1)
+  {
+  }
+
+  void run() override
+  {
+    if (isStale()) {
+      return;
+    }
+    const auto& sinograms = m_sinograms->get();
+    int tilts = sinograms.numberOfTilts();
+    for (int Nray : { previewRays, fullRays }) {
+      if (isStale()) {
+        return;
+      }
+      std::vector<float> sinogram(Nray * tilts);
+      sinograms.getSinogram(m_slice, &sinogram[0], Nray, m_shift);
+      std::vector<float> recon(Nray * Nray);
+      TomographyReconstruction::unweightedBackProjection2(
+        &sinogram[0], &m_tiltAngles[0], &recon[0], tilts, Nray);
+      if (isStale()) {
+        return;
+      }
+      emit reconstructed(m_view, m_request, Nray, recon);
+    }
+  }
+
+signals:
+  void reconstructed(int view, int request, int Nray,
+                     std::vector<float> recon);
+
+private:
+  bool isStale() const
+  {
+    return m_requests->latest[m_view].load() != m_request;
+  }
+
+  QSharedPointer<SharedSinograms> m_sinograms;
+  std::vector<double> m_tiltAngles;
+  int m_view;
+  int m_slice;
+  double m_shift;
+  QSharedPointer<ReconRequests> m_requests;
+  int m_request;
+};
+
+/// Estimates the tilt axis on the PipelineScheduler.
+class TiltAxisJob : public QObject, public QRunnable
+{
+  Q_OBJECT
+
+public:
+  TiltAxisJob(QSharedPointer<SharedSinograms> sinograms,
+              const std::vector<double>& tiltAngles)
+    : m_sinograms(sinograms), m_tiltAngles(tiltAngles)
+  {
+  }
+
+  void run() override
+  {
+    TiltAxisEstimator estimator(m_sinograms->get(), m_tiltAngles);
+    auto estimate = estimator.estimate();
+    emit estimated(estimate.shift, estimate.angle);
+  }
+
+signals:
+  void estimated(double shift, double angle);
+
+private:
+  QSharedPointer<SharedSinograms> m_sinograms;
+  std::vector<double> m_tiltAngles;
+};
+}
+
 class RotateAlignWidget::RAWInternal
 {
 public:
@@ -89,16 +227,35 @@ public:
   vtkSmartPointer<vtkSMProxy> ReconColorMap[3];
   bool m_reconSliceDirty[3];
   QTimer m_updateSlicesTimer;
-
-  RAWInternal()
+  // The sinograms of the tilt series, replaced when the data changes and
+  // built by the first background job that uses them.
+  QSharedPointer<SharedSinograms> m_sinograms;
+  vtkImageData* m_sinogramsImage = nullptr;
+  vtkMTimeType m_sinogramsTime = 0;
+  QSharedPointer<ReconRequests> m_reconRequests;
+  // Receives the background results, the connections go away with it.
+  QObject m_reconReceiver;
+
+  RAWInternal() : m_reconRequests(new ReconRequests)
   {
+    qRegisterMetaType<std::vector<float>>();
     m_reconSliceDirty[0] = m_reconSliceDirty[1] = m_reconSliceDirty[2] = true;
-    m_updateSlicesTimer.setInterval(500);
+    // The slices are reconstructed in the background, only wait for the user
+    // to pause.
+    m_updateSlicesTimer.setInterval(100);
     m_updateSlicesTimer.setSingleShot(true);
     QObject::connect(&m_updateSlicesTimer, &QTimer::timeout,
                      [this]() { this->updateDirtyReconSlices(); });
   }
 
+  ~RAWInternal()
+  {
+    // Make the jobs still queued or running stop early.
+    for (int i = 0; i < 3; ++i) {
+      m_reconRequests->latest[i].fetchAndAddOrdered(1);
+    }
+  }
+
   void setupCameras()
   {
     tomviz::setupRenderer(this->mainRenderer.Get(),
@@ -202,6 +359,72 @@ public:
     }
   }
 
+  QSharedPointer<SharedSinograms> sinograms(vtkImageData* imageData)
+  {
+    vtkMTimeType time = imageData->GetMTime();
+    if (auto scalars = imageData->GetPointData()->GetScalars()) {
+      time = std::max(time, scalars->GetMTime());
+    }
+    if (!m_sinograms || m_sinogramsImage != imageData ||
+        m_sinogramsTime != time) {
+      m_sinograms.reset(new SharedSinograms(imageData));
+      m_sinogramsImage = imageData;
+      m_sinogramsTime = time;
+    }
+    return m_sinograms;
+  }
+
+  std::vector<double> tiltAngles(vtkImageData* imageData)
+  {
+    vtkDataArray* tiltAnglesArray =
+      imageData->GetFieldData()->GetArray("tilt_angles");
+    std::vector<double> angles(tiltAnglesArray->GetNumberOfTuples());
+    for (size_t j = 0; j < angles.size(); ++j) {
+      angles[j] = tiltAnglesArray->GetTuple1(j);
+    }
+    return angles;
+  }
+
+  // Search the tilt axis in the background and move the axis there.
+  void estimateTiltAxis()
+  {
+    vtkTrivialProducer* t = vtkTrivialProducer::SafeDownCast(
+      this->Source->producer()->GetClientSideObject());
+    if (!t) {
+      return;
+    }
+    vtkImageData* imageData =
+      vtkImageData::SafeDownCast(t->GetOutputDataObject(0));
+    if (imageData) {
+      auto job = new TiltAxisJob(sinograms(imageData), tiltAngles(imageData));
+      QObject::connect(job, &TiltAxisJob::estimated, &m_reconReceiver,
+                       [this](double shift, double angle) {
+                         this->Ui.estimateButton->setEnabled(true);
+                         this->Ui.rotationAxis->setValue(shift);
+                         this->Ui.rotationAngle->setValue(angle);
+                         this->moveRotationAxisLine();
+                         for (int i = 0; i < 3; ++i) {
+                           this->m_reconSliceDirty[i] = true;
+                         }
+                         this->m_updateSlicesTimer.start();
+                       });
+      this->Ui.estimateButton->setEnabled(false);
+      PipelineScheduler::instance().submit(
+        job, this->Source, PipelineScheduler::Priority::Interactive);
+    }
+  }
+
+  // Show an empty full size slice in every view, so the cameras can be set up
+  // before the first reconstruction arrives.
+  void clearReconSlices()
+  {
+    std::vector<float> empty(fullRays * fullRays, 0.0f);
+    for (int i = 0; i < 3; ++i) {
+      this->setReconSlice(i, fullRays, empty);
+    }
+  }
+
+  // Queue the reconstruction of view i, replacing the previous request.
   void updateReconSlice(int i)
   {
     vtkTrivialProducer* t = vtkTrivialProducer::SafeDownCast(
@@ -220,47 +443,60 @@ public:
                                  this->Ui.spinBox_3 };
       int sliceNum = spinBoxes[i]->value();
 
-      int Nray = 256; // Size of 2D reconstruction. Fixed for all tilt series
-      std::vector<float> sinogram(Nray * dims[2]);
       // Approximate in-plance rotation as a shift in y-direction
       double shift = -this->Ui.rotationAxis->value() +
                      sin(-this->Ui.rotationAngle->value() * PI / 180) *
                        (sliceNum - dims[0] / 2);
 
-      TomographyTiltSeries::getSinogram(
-        imageData, sliceNum, &sinogram[0], Nray,
-        shift); // Get a sinogram from tilt series
-      this->reconImage[i]->SetExtent(0, Nray - 1, 0, Nray - 1, 0, 0);
-      this->reconImage[i]->AllocateScalars(VTK_FLOAT, 1);
-      vtkDataArray* reconArray =
-        this->reconImage[i]->GetPointData()->GetScalars();
-      float* reconPtr = static_cast<float*>(reconArray->GetVoidPointer(0));
-
-      vtkDataArray* tiltAnglesArray =
-        imageData->GetFieldData()->GetArray("tilt_angles");
-      double* tiltAngles =
-        static_cast<double*>(tiltAnglesArray->GetVoidPointer(0));
-
-      TomographyReconstruction::unweightedBackProjection2(
-        &sinogram[0], tiltAngles, reconPtr, dims[2], Nray);
-      this->reconSliceMapper[i]->SetInputData(this->reconImage[i].GetPointer());
-      this->reconSliceMapper[i]->SetSliceNumber(0);
-      this->reconSliceMapper[i]->Update();
+      auto job =
+        new ReconSliceJob(sinograms(imageData), tiltAngles(imageData), i,
+                          sliceNum, shift, m_reconRequests);
+      QObject::connect(job, &ReconSliceJob::reconstructed, &m_reconReceiver,
+                       [this](int view, int request, int Nray,
+                              std::vector<float> recon) {
+                         // Drop the results that arrive after a new request
+                         if (m_reconRequests->latest[view].load() == request) {
+                           this->setReconSlice(view, Nray, recon);
+                         }
+                       });
+      PipelineScheduler::instance().submit(
+        job, this->Source, PipelineScheduler::Priority::Interactive);
+    }
+  }
 
-      double range[2];
-      reconArray->GetRange(range);
+  void setReconSlice(int i, int Nray, const std::vector<float>& recon)
+  {
+    // Keep the bounds of the full size slice so the camera doesn't move when
+    // the preview is refined.
+    double spacing = (fullRays - 1.0) / (Nray - 1.0);
+    this->reconImage[i]->SetExtent(0, Nray - 1, 0, Nray - 1, 0, 0);
+    this->reconImage[i]->SetSpacing(spacing, spacing, 1.0);
+    this->reconImage[i]->AllocateScalars(VTK_FLOAT, 1);
+    vtkDataArray* reconArray =
+      this->reconImage[i]->GetPointData()->GetScalars();
+    float* reconPtr = static_cast<float*>(reconArray->GetVoidPointer(0));
+    std::copy(recon.begin(), recon.end(), reconPtr);
+    reconArray->Modified();
+
+    this->reconSliceMapper[i]->SetInputData(this->reconImage[i].GetPointer());
+    this->reconSliceMapper[i]->SetSliceNumber(0);
+    this->reconSliceMapper[i]->Update();
+
+    double range[2];
+    reconArray->GetRange(range);
+    if (range[0] < range[1]) {
       vtkSMTransferFunctionProxy::RescaleTransferFunction(
         this->ReconColorMap[i], range);
-      this->reconSlice[i]->GetProperty()->SetLookupTable(
-        vtkScalarsToColors::SafeDownCast(
-          this->ReconColorMap[i]->GetClientSideObject()));
+    }
+    this->reconSlice[i]->GetProperty()->SetLookupTable(
+      vtkScalarsToColors::SafeDownCast(
+        this->ReconColorMap[i]->GetClientSideObject()));
 
-      tomviz::QVTKGLWidget* sliceView[] = { this->Ui.sliceView_1,
-                                            this->Ui.sliceView_2,
-                                            this->Ui.sliceView_3 };
+    tomviz::QVTKGLWidget* sliceView[] = { this->Ui.sliceView_1,
+                                          this->Ui.sliceView_2,
+                                          this->Ui.sliceView_3 };
 
-      sliceView[i]->GetRenderWindow()->Render();
-    }
+    sliceView[i]->GetRenderWindow()->Render();
   }
 
   void updateSliceLines()
@@ -420,6 +656,9 @@ RotateAlignWidget::RotateAlignWidget(DataSource* source, QWidget* p)
   this->connect(this->Internals->Ui.pushButton, SIGNAL(pressed()),
                 SLOT(onFinalReconButtonPressed()));
 
+  this->connect(this->Internals->Ui.estimateButton, SIGNAL(pressed()),
+                SLOT(onEstimateButtonPressed()));
+
   this->setDataSource(source);
 }
 
@@ -490,12 +729,14 @@ void RotateAlignWidget::setDataSource(DataSource* source)
 
     // We have to do this here since we need the output to exist so the camera
     // can be initialized below
-    this->Internals->updateReconSlice(0);
-    this->Internals->updateReconSlice(1);
-    this->Internals->updateReconSlice(2);
+    this->Internals->clearReconSlices();
 
     this->Internals->setupCameras();
     this->Internals->setupRotationAxisLine();
+
+    this->Internals->updateReconSlice(0);
+    this->Internals->updateReconSlice(1);
+    this->Internals->updateReconSlice(2);
   } else {
     this->Internals->mainSliceMapper->SetInputConnection(NULL);
     this->Internals->mainSliceMapper->Update();
@@ -621,6 +862,13 @@ void RotateAlignWidget::updateWidgets()
   this->Internals->Ui.sliceView_3->GetRenderWindow()->Render();
 }
 
+void RotateAlignWidget::onEstimateButtonPressed()
+{
+  if (this->Internals->Source) {
+    this->Internals->estimateTiltAxis();
+  }
+}
+
 void RotateAlignWidget::onFinalReconButtonPressed()
 {
   DataSource* source = this->Internals->Source;
@@ -666,3 +914,5 @@ void RotateAlignWidget::onFinalReconButtonPressed()
   emit creatingAlignedData();
 }
 }
+
+#include "RotateAlignWidget.moc"
@@ -49,6 +49,7 @@ protected slots:
 
   void updateWidgets();
 
+  void onEstimateButtonPressed();
   void onFinalReconButtonPressed();
 
   void showChangeColorMapDialog0() { this->showChangeColorMapDialog(0); };
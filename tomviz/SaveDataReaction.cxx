@@ -171,7 +171,7 @@ bool SaveDataReaction::saveData(const QString& filename)
       vtkImageData::SafeDownCast(t->GetOutputDataObject(0));
     if (imageData->GetPointData()->GetScalars()->GetDataType() == VTK_DOUBLE) {
       vtkNew<vtkImageData> fImage;
-      fImage->DeepCopy(imageData);
+      copyOnWrite(imageData, fImage.Get());
       ConvertToFloatOperator convertFloat;
       convertFloat.applyTransform(fImage);
 
@@ -37,6 +37,7 @@ public:
   EditOperatorWidget* getEditorContentsWithData(
     QWidget* parent, vtkSmartPointer<vtkImageData> data) override;
   bool hasCustomUI() const override { return true; }
+  bool modifiesDataInPlace() const override { return false; }
 
   void setTiltAngles(const QMap<size_t, double>& newAngles);
   const QMap<size_t, double>& tiltAngles() const { return m_tiltAngles; }
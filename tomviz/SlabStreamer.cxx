@@ -0,0 +1,475 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "SlabStreamer.h"
+
+#include "DataSource.h"
+#include "Operator.h"
+#include "PipelineScheduler.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkAlgorithm.h>
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <QDebug>
+#include <QFile>
+#include <QRunnable>
+#include <QTextStream>
+
+#include <cstring>
+
+namespace {
+
+// The name of the XML data type matching the array's type.
+QString xmlTypeName(vtkDataArray* array)
+{
+  int bits = array->GetDataTypeSize() * 8;
+  if (array->GetDataType() == VTK_FLOAT || array->GetDataType() == VTK_DOUBLE) {
+    return QString("Float%1").arg(bits);
+  }
+
+  return QString("%1Int%2")
+    .arg(array->GetDataTypeMin() < 0 ? "" : "U")
+    .arg(bits);
+}
+
+QString extentString(const int extent[6])
+{
+  return QString("%1 %2 %3 %4 %5 %6")
+    .arg(extent[0])
+    .arg(extent[1])
+    .arg(extent[2])
+    .arg(extent[3])
+    .arg(extent[4])
+    .arg(extent[5]);
+}
+
+QString vectorString(const double vector[3])
+{
+  return QString("%1 %2 %3")
+    .arg(vector[0], 0, 'g', 17)
+    .arg(vector[1], 0, 'g', 17)
+    .arg(vector[2], 0, 'g', 17);
+}
+}
+
+namespace tomviz {
+
+class SlabStreamer::Runnable : public QRunnable
+{
+public:
+  Runnable(SlabStreamer* streamer) : m_streamer(streamer)
+  {
+    setAutoDelete(false);
+  }
+
+  void run() override
+  {
+    bool result = m_streamer->execute();
+    if (m_streamer->isCanceled()) {
+      emit m_streamer->canceled();
+    } else {
+      emit m_streamer->finished(result);
+    }
+  }
+
+private:
+  SlabStreamer* m_streamer;
+};
+
+/// Writes the active scalars of the slabs to a VTK XML image file. The header
+/// is written when the first slab arrives, as only then the output type and
+/// dimensions are known, the data of each slab is then appended.
+class SlabStreamer::Writer
+{
+public:
+  Writer(const QString& fileName) : m_file(fileName) {}
+
+  bool isOpen() const { return m_file.isOpen(); }
+
+  bool open(vtkImageData* first, const int zExtent[2],
+            vtkFieldData* fieldData)
+  {
+    vtkDataArray* scalars = first->GetPointData()->GetScalars();
+    if (!scalars) {
+      qCritical() << "Streamed data has no scalars.";
+      return false;
+    }
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      qCritical() << "Unable to open" << m_file.fileName() << "for writing.";
+      return false;
+    }
+
+    first->GetExtent(m_extent);
+    m_extent[4] = zExtent[0];
+    m_extent[5] = zExtent[1];
+    m_dataType = scalars->GetDataType();
+    m_components = scalars->GetNumberOfComponents();
+    m_sliceBytes = static_cast<quint64>(m_extent[1] - m_extent[0] + 1) *
+                   (m_extent[3] - m_extent[2] + 1) * m_components *
+                   scalars->GetDataTypeSize();
+    quint64 totalBytes = m_sliceBytes * (m_extent[5] - m_extent[4] + 1);
+    QString name = scalars->GetName() ? scalars->GetName() : "scalars";
+
+    QString header;
+    QTextStream stream(&header);
+    stream << "<?xml version=\"1.0\"?>\n"
+           << "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\""
+#ifdef VTK_WORDS_BIGENDIAN
+           << "BigEndian"
+#else
+           << "LittleEndian"
+#endif
+           << "\" header_type=\"UInt64\">\n"
+           << "  <ImageData WholeExtent=\"" << extentString(m_extent)
+           << "\" Origin=\"" << vectorString(first->GetOrigin())
+           << "\" Spacing=\"" << vectorString(first->GetSpacing()) << "\">\n";
+    if (fieldData && fieldData->GetNumberOfArrays() > 0) {
+      stream << "    <FieldData>\n";
+      for (int i = 0; i < fieldData->GetNumberOfArrays(); ++i) {
+        vtkDataArray* array = fieldData->GetArray(i);
+        if (!array || !array->GetName()) {
+          continue;
+        }
+        stream << "      <DataArray type=\"" << xmlTypeName(array)
+               << "\" Name=\"" << array->GetName() << "\" NumberOfTuples=\""
+               << array->GetNumberOfTuples() << "\" NumberOfComponents=\""
+               << array->GetNumberOfComponents() << "\" format=\"ascii\">";
+        for (vtkIdType j = 0; j < array->GetNumberOfValues(); ++j) {
+          stream << " "
+                 << QString::number(
+                      array->GetComponent(j / array->GetNumberOfComponents(),
+                                          j % array->GetNumberOfComponents()),
+                      'g', 17);
+        }
+        stream << " </DataArray>\n";
+      }
+      stream << "    </FieldData>\n";
+    }
+    stream << "    <Piece Extent=\"" << extentString(m_extent) << "\">\n"
+           << "      <PointData Scalars=\"" << name << "\">\n"
+           << "        <DataArray type=\"" << xmlTypeName(scalars)
+           << "\" Name=\"" << name << "\" NumberOfComponents=\""
+           << m_components << "\" format=\"appended\" offset=\"0\"/>\n"
+           << "      </PointData>\n"
+           << "      <CellData/>\n"
+           << "    </Piece>\n"
+           << "  </ImageData>\n"
+           << "  <AppendedData encoding=\"raw\">\n"
+           << "   _";
+    stream.flush();
+
+    // The raw data block is preceded by its size in bytes.
+    if (m_file.write(header.toUtf8()) < 0 ||
+        m_file.write(reinterpret_cast<const char*>(&totalBytes),
+                     sizeof(totalBytes)) < 0) {
+      qCritical() << "Failed to write to" << m_file.fileName();
+      return false;
+    }
+
+    return true;
+  }
+
+  /// Append count slices of data, starting at the given slice.
+  bool append(vtkImageData* data, int firstSlice, int count)
+  {
+    vtkDataArray* scalars = data->GetPointData()->GetScalars();
+    int extent[6];
+    data->GetExtent(extent);
+    if (!scalars || scalars->GetDataType() != m_dataType ||
+        scalars->GetNumberOfComponents() != m_components ||
+        extent[1] - extent[0] != m_extent[1] - m_extent[0] ||
+        extent[3] - extent[2] != m_extent[3] - m_extent[2]) {
+      qCritical() << "The operators produced inconsistent slabs, the data "
+                     "can't be streamed.";
+      return false;
+    }
+
+    auto bytes =
+      static_cast<const char*>(scalars->GetVoidPointer(0)) +
+      m_sliceBytes * firstSlice;
+    if (m_file.write(bytes, m_sliceBytes * count) !=
+        static_cast<qint64>(m_sliceBytes * count)) {
+      qCritical() << "Failed to write to" << m_file.fileName();
+      return false;
+    }
+    m_slicesWritten += count;
+
+    return true;
+  }
+
+  bool close()
+  {
+    if (m_slicesWritten != m_extent[5] - m_extent[4] + 1) {
+      m_file.close();
+      return false;
+    }
+    m_file.write("\n  </AppendedData>\n</VTKFile>\n");
+    m_file.close();
+
+    return m_file.error() == QFileDevice::NoError;
+  }
+
+private:
+  QFile m_file;
+  int m_extent[6];
+  int m_dataType = VTK_VOID;
+  int m_components = 0;
+  quint64 m_sliceBytes = 0;
+  int m_slicesWritten = 0;
+};
+
+SlabStreamer::SlabStreamer(vtkAlgorithm* source,
+                           const QList<Operator*>& operators,
+                           const QString& fileName, QObject* parentObject)
+  : QObject(parentObject), m_source(source), m_operators(operators),
+    m_fileName(fileName), m_slabThickness(32), m_canceled(false),
+    m_runnable(new Runnable(this))
+{
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    m_slabThickness =
+      core->settings()
+        ->value("tomviz/pipeline/SlabThickness", m_slabThickness)
+        .toInt();
+  }
+}
+
+SlabStreamer::~SlabStreamer()
+{
+  PipelineScheduler::instance().cancel(m_runnable.data());
+}
+
+bool SlabStreamer::canStream(const QList<Operator*>& operators)
+{
+  foreach (Operator* op, operators) {
+    if (!op->supportsSlabs()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int SlabStreamer::halo(const QList<Operator*>& operators)
+{
+  // Each operator widens the region of the input its output depends on.
+  int halo = 0;
+  foreach (Operator* op, operators) {
+    halo += qMax(op->slabHalo(), 0);
+  }
+
+  return halo;
+}
+
+void SlabStreamer::setSlabThickness(int slices)
+{
+  m_slabThickness = qMax(slices, 1);
+}
+
+int SlabStreamer::slabThickness() const
+{
+  return m_slabThickness;
+}
+
+void SlabStreamer::setSpacing(const double spacing[3])
+{
+  m_overrideSpacing = true;
+  std::copy(spacing, spacing + 3, m_spacing);
+}
+
+void SlabStreamer::setTiltAngles(vtkDataArray* angles)
+{
+  m_tiltAngles = angles;
+}
+
+void SlabStreamer::start()
+{
+  m_canceled = false;
+  PipelineScheduler::instance().submit(m_runnable.data(),
+                                       qobject_cast<DataSource*>(parent()));
+}
+
+void SlabStreamer::cancel()
+{
+  m_canceled = true;
+  if (PipelineScheduler::instance().cancel(m_runnable.data())) {
+    emit canceled();
+    return;
+  }
+  foreach (Operator* op, m_operators) {
+    op->cancelTransform();
+  }
+}
+
+bool SlabStreamer::isCanceled() const
+{
+  return m_canceled;
+}
+
+bool SlabStreamer::execute()
+{
+  if (!m_source || !canStream(m_operators)) {
+    return false;
+  }
+
+  m_source->UpdateInformation();
+  int wholeExtent[6];
+  m_source->GetOutputInformation(0)->Get(
+    vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+
+  int halo = SlabStreamer::halo(m_operators);
+  int slices = wholeExtent[5] - wholeExtent[4] + 1;
+  int totalSlabs = (slices + m_slabThickness - 1) / m_slabThickness;
+  Writer writer(m_fileName);
+  for (int slab = 0; slab < totalSlabs; ++slab) {
+    int first = wholeExtent[4] + slab * m_slabThickness;
+    int last = qMin(first + m_slabThickness - 1, wholeExtent[5]);
+    int extent[6] = { wholeExtent[0],
+                      wholeExtent[1],
+                      wholeExtent[2],
+                      wholeExtent[3],
+                      qMax(first - halo, wholeExtent[4]),
+                      qMin(last + halo, wholeExtent[5]) };
+
+    auto data = readSlab(extent, wholeExtent[4]);
+    if (!data) {
+      return false;
+    }
+    foreach (Operator* op, m_operators) {
+      if (m_canceled || op->transform(data) != TransformResult::Complete) {
+        return false;
+      }
+    }
+
+    int outputExtent[6];
+    data->GetExtent(outputExtent);
+    if (outputExtent[5] - outputExtent[4] != extent[5] - extent[4]) {
+      qCritical() << "An operator changed the number of slices, the data "
+                     "can't be streamed.";
+      return false;
+    }
+    if (!writer.isOpen()) {
+      // The output has the tilt angles of the whole volume, not the slab's.
+      vtkNew<vtkFieldData> fieldData;
+      fieldData->ShallowCopy(data->GetFieldData());
+      if (m_tiltAngles && fieldData->HasArray("tilt_angles")) {
+        vtkSmartPointer<vtkDataArray> angles;
+        angles.TakeReference(m_tiltAngles->NewInstance());
+        angles->DeepCopy(m_tiltAngles);
+        angles->SetName("tilt_angles");
+        fieldData->RemoveArray("tilt_angles");
+        fieldData->AddArray(angles);
+      }
+      if (!writer.open(data, wholeExtent + 4, fieldData.Get())) {
+        return false;
+      }
+    }
+    // Drop the halo
+    if (!writer.append(data, first - extent[4], last - first + 1)) {
+      return false;
+    }
+
+    emit progress(slab + 1, totalSlabs);
+  }
+
+  return writer.close();
+}
+
+vtkSmartPointer<vtkImageData> SlabStreamer::readSlab(const int extent[6],
+                                                     int firstSlice)
+{
+  // Readers that support streaming only produce the requested extent, others
+  // produce everything and the slab is extracted below.
+  m_source->UpdateExtent(extent);
+  auto source = vtkImageData::SafeDownCast(m_source->GetOutputDataObject(0));
+  if (!source) {
+    qCritical() << "Only image data can be streamed.";
+    return nullptr;
+  }
+  int sourceExtent[6];
+  source->GetExtent(sourceExtent);
+  if (sourceExtent[0] != extent[0] || sourceExtent[1] != extent[1] ||
+      sourceExtent[2] != extent[2] || sourceExtent[3] != extent[3] ||
+      sourceExtent[4] > extent[4] || sourceExtent[5] < extent[5]) {
+    qCritical() << "The source did not produce the requested extent.";
+    return nullptr;
+  }
+
+  auto slab = vtkSmartPointer<vtkImageData>::New();
+  slab->SetExtent(const_cast<int*>(extent));
+  slab->SetOrigin(source->GetOrigin());
+  slab->SetSpacing(m_overrideSpacing ? m_spacing : source->GetSpacing());
+
+  // Slices are contiguous in memory, copy them in one go.
+  vtkIdType slicePoints = static_cast<vtkIdType>(extent[1] - extent[0] + 1) *
+                          (extent[3] - extent[2] + 1);
+  vtkIdType offset = slicePoints * (extent[4] - sourceExtent[4]);
+  vtkIdType points = slicePoints * (extent[5] - extent[4] + 1);
+  vtkPointData* sourcePointData = source->GetPointData();
+  for (int i = 0; i < sourcePointData->GetNumberOfArrays(); ++i) {
+    vtkDataArray* array = sourcePointData->GetArray(i);
+    if (!array) {
+      continue;
+    }
+    vtkSmartPointer<vtkDataArray> slabArray;
+    slabArray.TakeReference(array->NewInstance());
+    slabArray->SetName(array->GetName());
+    slabArray->SetNumberOfComponents(array->GetNumberOfComponents());
+    slabArray->SetNumberOfTuples(points);
+    auto tupleBytes = array->GetNumberOfComponents() * array->GetDataTypeSize();
+    std::memcpy(slabArray->GetVoidPointer(0),
+                array->GetVoidPointer(offset * array->GetNumberOfComponents()),
+                static_cast<size_t>(points * tupleBytes));
+    if (array == sourcePointData->GetScalars()) {
+      slab->GetPointData()->SetScalars(slabArray);
+    } else {
+      slab->GetPointData()->AddArray(slabArray);
+    }
+  }
+
+  // Give each slab the tilt angles of its own slices.
+  vtkFieldData* fieldData = slab->GetFieldData();
+  fieldData->DeepCopy(source->GetFieldData());
+  if (!m_tiltAngles) {
+    m_tiltAngles = source->GetFieldData()->GetArray("tilt_angles");
+  }
+  vtkDataArray* angles = m_tiltAngles;
+  if (angles) {
+    vtkSmartPointer<vtkDataArray> slabAngles;
+    slabAngles.TakeReference(angles->NewInstance());
+    slabAngles->SetName("tilt_angles");
+    slabAngles->SetNumberOfTuples(extent[5] - extent[4] + 1);
+    for (int i = extent[4]; i <= extent[5]; ++i) {
+      int index = i - firstSlice;
+      slabAngles->SetTuple1(i - extent[4],
+                            index < angles->GetNumberOfTuples()
+                              ? angles->GetTuple1(index)
+                              : 0.0);
+    }
+    fieldData->AddArray(slabAngles);
+  }
+
+  return slab;
+}
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizSlabStreamer_h
+#define tomvizSlabStreamer_h
+
+#include <QList>
+#include <QObject>
+#include <QScopedPointer>
+#include <QString>
+
+#include <vtkSmartPointer.h>
+
+#include <atomic>
+
+class vtkAlgorithm;
+class vtkDataArray;
+class vtkImageData;
+
+namespace tomviz {
+
+class Operator;
+
+/// Runs a chain of operators over a volume one Z slab at a time, so that
+/// volumes larger than the available memory can be processed. Every slab is
+/// pulled from the source algorithm with an update extent request, padded with
+/// the halo the operators need, transformed, trimmed back and appended to a
+/// VTK XML image file (appended raw encoding). Only the active scalars are
+/// written.
+///
+/// All operators must support slabs, see Operator::supportsSlabs(). The
+/// operators are shared with the DataSource, don't modify them while the
+/// streamer is running.
+class SlabStreamer : public QObject
+{
+  Q_OBJECT
+
+public:
+  SlabStreamer(vtkAlgorithm* source, const QList<Operator*>& operators,
+               const QString& fileName, QObject* parent = nullptr);
+  ~SlabStreamer() override;
+
+  /// Returns true if every operator can be applied slab by slab.
+  static bool canStream(const QList<Operator*>& operators);
+
+  /// Returns the number of slices needed on each side of a slab for the whole
+  /// chain of operators to produce the slab correctly.
+  static int halo(const QList<Operator*>& operators);
+
+  /// Set the number of slices in each slab, not counting the halo. The
+  /// default is read from the application settings.
+  void setSlabThickness(int slices);
+  int slabThickness() const;
+
+  /// Override the spacing of the source data.
+  void setSpacing(const double spacing[3]);
+
+  /// Override the tilt angles of the source data, each slab gets the angles of
+  /// its slices.
+  void setTiltAngles(vtkDataArray* angles);
+
+  /// Execute on the PipelineScheduler, finished() or canceled() is emitted
+  /// when done.
+  void start();
+
+  /// Stop after the current slab.
+  void cancel();
+  bool isCanceled() const;
+
+  /// Execute on the calling thread. Returns true if the whole volume has been
+  /// written.
+  bool execute();
+
+signals:
+  void progress(int slabs, int totalSlabs);
+  void finished(bool result);
+  void canceled();
+
+private:
+  Q_DISABLE_COPY(SlabStreamer)
+
+  class Runnable;
+  class Writer;
+
+  // Read the given extent of the source into a new image, firstSlice is the
+  // first slice of the whole volume.
+  vtkSmartPointer<vtkImageData> readSlab(const int extent[6], int firstSlice);
+
+  vtkSmartPointer<vtkAlgorithm> m_source;
+  QList<Operator*> m_operators;
+  QString m_fileName;
+  int m_slabThickness;
+  bool m_overrideSpacing = false;
+  double m_spacing[3];
+  vtkSmartPointer<vtkDataArray> m_tiltAngles;
+  std::atomic<bool> m_canceled;
+  QScopedPointer<Runnable> m_runnable;
+};
+}
+
+#endif
@@ -17,6 +17,7 @@
 #include "SnapshotOperator.h"
 
 #include "DataSource.h"
+#include "Utilities.h"
 
 #include "pqSMProxy.h"
 #include "vtkDataArray.h"
@@ -96,7 +97,7 @@ bool SnapshotOperator::applyTransform(vtkDataObject* dataObject)
   }
 
   vtkNew<vtkImageData> cacheImage;
-  cacheImage->DeepCopy(imageData);
+  copyOnWrite(imageData, cacheImage.Get());
 
   emit newChildDataSource("Snapshot", cacheImage.Get());
   return true;
@@ -38,6 +38,8 @@ public:
   bool deserialize(const pugi::xml_node& ns) override;
 
   bool hasCustomUI() const override { return false; }
+  bool modifiesDataInPlace() const override { return false; }
+  bool supportsPreview() const override { return false; }
 
   QWidget* getCustomProgressWidget(QWidget*) const override;
 
@@ -0,0 +1,308 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "TiltAxisEstimator.h"
+
+#include "BackProjectionKernels.h"
+#include "FFT.h"
+#include "TomographyTiltSeries.h"
+
+#include <vtkSMPThreadLocal.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// The slices are first sampled every ray, then five times finer at every
+// level until finer than this.
+const double finestStep = 0.05;
+
+// Score of one slice sampled at shifts first + j * step.
+struct Samples
+{
+  double first = 0;
+  double step = 1;
+  std::vector<double> values;
+
+  // Linear interpolation, clamped to the sampled shifts.
+  double at(double shift) const
+  {
+    double position = (shift - first) / step;
+    int last = static_cast<int>(values.size()) - 1;
+    if (position <= 0 || last == 0) {
+      return values[0];
+    }
+    if (position >= last) {
+      return values[last];
+    }
+    int j = static_cast<int>(position);
+    double weight = position - j;
+    return values[j] * (1 - weight) + values[j + 1] * weight;
+  }
+};
+}
+
+namespace tomviz {
+
+TiltAxisEstimator::TiltAxisEstimator(
+  const TomographyTiltSeries::SinogramStack& sinograms,
+  const std::vector<double>& tiltAngles, int numberOfSlices, int maximumRays)
+  : m_numberOfSlices(sinograms.numberOfSlices()),
+    m_tilts(sinograms.numberOfTilts())
+{
+  int rays = sinograms.numberOfRays();
+  m_binning = std::max((rays + maximumRays - 1) / maximumRays, 1);
+  m_rays = rays / m_binning;
+  // Binned ray u is the average of rays [u * binning, (u + 1) * binning)
+  m_binnedCenter =
+    (m_rays / 2) * m_binning + (m_binning - 1) / 2.0 - rays / 2;
+  m_size = FFT::nextPowerOfTwo(2 * m_rays);
+  m_shiftRange = rays / 8.0;
+
+  // Spread the slices along the tilt axis, among the brightest half
+  std::vector<double> intensity(m_numberOfSlices);
+  vtkSMPTools::For(0, m_numberOfSlices, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType slice = begin; slice < end; ++slice) {
+      const float* sinogram = sinograms.sinogram(slice);
+      intensity[slice] =
+        std::accumulate(sinogram, sinogram + m_tilts * rays, 0.0);
+    }
+  });
+  std::vector<int> brightest(m_numberOfSlices);
+  std::iota(brightest.begin(), brightest.end(), 0);
+  std::stable_sort(brightest.begin(), brightest.end(),
+                   [&](int a, int b) { return intensity[a] > intensity[b]; });
+  brightest.resize(std::max(m_numberOfSlices / 2, 1));
+  std::sort(brightest.begin(), brightest.end());
+  int count = std::min(std::max(numberOfSlices, 1),
+                       static_cast<int>(brightest.size()));
+  for (int i = 0; i < count; ++i) {
+    int index = count > 1 ? i * (static_cast<int>(brightest.size()) - 1) /
+                              (count - 1)
+                          : static_cast<int>(brightest.size()) / 2;
+    m_slices.push_back(brightest[index]);
+  }
+  setAngleRange(m_angleRange);
+
+  m_cosines.resize(m_tilts);
+  m_sines.resize(m_tilts);
+  for (int t = 0; t < m_tilts; ++t) {
+    m_cosines[t] = static_cast<float>(std::cos(tiltAngles[t] * pi / 180));
+    m_sines[t] = static_cast<float>(std::sin(tiltAngles[t] * pi / 180));
+  }
+
+  // Bin, transform and filter the rows once, only the phase ramp of the shift
+  // depends on the candidate.
+  int rows = static_cast<int>(m_slices.size()) * m_tilts;
+  m_spectra.assign(static_cast<size_t>(rows) * m_size, 0.0f);
+  vtkSMPTools::For(0, rows, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType r = begin; r < end; ++r) {
+      const float* row =
+        sinograms.sinogram(m_slices[r / m_tilts]) + (r % m_tilts) * rays;
+      std::complex<float>* spectrum = &m_spectra[r * m_size];
+      for (int u = 0; u < m_rays; ++u) {
+        float sum = 0;
+        for (int b = 0; b < m_binning; ++b) {
+          sum += row[u * m_binning + b];
+        }
+        spectrum[u] = sum / m_binning;
+      }
+      FFT::transform(spectrum, m_size);
+      for (int k = 0; k < m_size; ++k) {
+        int frequency = k <= m_size / 2 ? k : k - m_size;
+        spectrum[k] *= 2.0f * std::abs(frequency) / m_size;
+      }
+    }
+  });
+}
+
+void TiltAxisEstimator::setShiftRange(double range)
+{
+  m_shiftRange = std::max(range, 0.0);
+}
+
+void TiltAxisEstimator::setAngleRange(double range)
+{
+  m_angleRange = m_slices.size() > 1 ? std::max(range, 0.0) : 0;
+}
+
+double TiltAxisEstimator::sliceShift(int slice, double shift,
+                                     double angle) const
+{
+  // As RotateAlignWidget approximates the in-plane rotation
+  return -shift + std::sin(-angle * pi / 180) * (slice - m_numberOfSlices / 2);
+}
+
+void TiltAxisEstimator::allocate(Buffers& buffers) const
+{
+  buffers.phase.resize(m_size);
+  buffers.row.resize(m_size);
+  buffers.sinogram.resize(static_cast<size_t>(m_tilts) * m_rays);
+  buffers.image.resize(static_cast<size_t>(m_rays) * m_rays);
+}
+
+double TiltAxisEstimator::sliceScore(int i, double shift,
+                                     Buffers& buffers) const
+{
+  // Sampling the binned rows at u + binnedShift is a shift of the spectrum's
+  // phase.
+  double binnedShift = (shift - m_binnedCenter) / m_binning;
+  for (int k = 0; k < m_size; ++k) {
+    int frequency = k <= m_size / 2 ? k : k - m_size;
+    buffers.phase[k] = std::polar(
+      1.0f, static_cast<float>(2 * pi * frequency * binnedShift / m_size));
+  }
+
+  const std::complex<float>* spectra =
+    &m_spectra[static_cast<size_t>(i) * m_tilts * m_size];
+  for (int t = 0; t < m_tilts; ++t) {
+    const std::complex<float>* spectrum = spectra + t * m_size;
+    for (int k = 0; k < m_size; ++k) {
+      buffers.row[k] = spectrum[k] * buffers.phase[k];
+    }
+    FFT::transform(&buffers.row[0], m_size, true);
+    for (int u = 0; u < m_rays; ++u) {
+      buffers.sinogram[t * m_rays + u] = buffers.row[u].real();
+    }
+  }
+
+  BackProjectionKernels::backProject(&buffers.sinogram[0], &m_cosines[0],
+                                     &m_sines[0], &buffers.image[0], m_tilts,
+                                     m_rays);
+  double negative = 0;
+  for (float value : buffers.image) {
+    if (value < 0) {
+      negative += value * value;
+    }
+  }
+  double scale = pi / (2 * m_tilts);
+  return -negative * scale * scale;
+}
+
+double TiltAxisEstimator::score(double shift, double angle,
+                                Buffers& buffers) const
+{
+  double total = 0;
+  for (size_t i = 0; i < m_slices.size(); ++i) {
+    total += sliceScore(static_cast<int>(i),
+                        sliceShift(m_slices[i], shift, angle), buffers);
+  }
+  return total;
+}
+
+double TiltAxisEstimator::score(double shift, double angle) const
+{
+  Buffers buffers;
+  allocate(buffers);
+  return score(shift, angle, buffers);
+}
+
+TiltAxisEstimator::Estimate TiltAxisEstimator::estimate() const
+{
+  // The score is a sum over the slices of a function of each slice's own
+  // shift. Sample the slices over the shifts the grid needs, in parallel,
+  // then evaluate the whole (shift, angle) grid from the samples.
+  int slices = static_cast<int>(m_slices.size());
+  double farthest = 0;
+  for (int slice : m_slices) {
+    farthest = std::max(farthest, std::abs(sliceShift(slice, 0, 90)));
+  }
+
+  Estimate best;
+  double shiftRange = m_shiftRange;
+  double angleRange = farthest > 0 ? m_angleRange : 0;
+  double step = 1;
+  vtkSMPThreadLocal<Buffers> buffers;
+  while (true) {
+    // The grid moves every slice by at most half a sample from one candidate
+    // to the next.
+    double shiftStep = step / 2;
+    double angleStep = std::asin(std::min(step / 2 / farthest, 1.0));
+    angleStep *= 180 / pi;
+    int shifts = 2 * static_cast<int>(std::ceil(shiftRange / shiftStep)) + 1;
+    int angles = angleRange > 0
+                   ? 2 * static_cast<int>(std::ceil(angleRange / angleStep)) + 1
+                   : 1;
+    double firstShift = best.shift - (shifts / 2) * shiftStep;
+    double firstAngle = best.angle - (angles / 2) * angleStep;
+    double lastShift = firstShift + (shifts - 1) * shiftStep;
+    double lastAngle = firstAngle + (angles - 1) * angleStep;
+
+    // The shift of a slice is monotonic in the shift and the angle of the
+    // candidate, so its extremes are at the corners of the grid.
+    std::vector<Samples> samples(slices);
+    std::vector<std::pair<int, int>> jobs;
+    for (int i = 0; i < slices; ++i) {
+      double corners[4] = { sliceShift(m_slices[i], firstShift, firstAngle),
+                            sliceShift(m_slices[i], firstShift, lastAngle),
+                            sliceShift(m_slices[i], lastShift, firstAngle),
+                            sliceShift(m_slices[i], lastShift, lastAngle) };
+      double low = *std::min_element(corners, corners + 4);
+      double high = *std::max_element(corners, corners + 4);
+      samples[i].first = low;
+      samples[i].step = step;
+      samples[i].values.resize(
+        static_cast<int>(std::ceil((high - low) / step)) + 1);
+      for (size_t j = 0; j < samples[i].values.size(); ++j) {
+        jobs.push_back(std::make_pair(i, static_cast<int>(j)));
+      }
+    }
+    vtkSMPTools::For(0, static_cast<vtkIdType>(jobs.size()),
+                     [&](vtkIdType begin, vtkIdType end) {
+                       Buffers& local = buffers.Local();
+                       allocate(local);
+                       for (vtkIdType job = begin; job < end; ++job) {
+                         Samples& slice = samples[jobs[job].first];
+                         int j = jobs[job].second;
+                         slice.values[j] = sliceScore(
+                           jobs[job].first, slice.first + j * slice.step,
+                           local);
+                       }
+                     });
+
+    std::vector<double> scores(shifts * angles);
+    vtkSMPTools::For(0, shifts * angles, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType c = begin; c < end; ++c) {
+        double shift = firstShift + (c % shifts) * shiftStep;
+        double angle = firstAngle + (c / shifts) * angleStep;
+        double total = 0;
+        for (int i = 0; i < slices; ++i) {
+          total += samples[i].at(sliceShift(m_slices[i], shift, angle));
+        }
+        scores[c] = total;
+      }
+    });
+
+    int c = static_cast<int>(std::max_element(scores.begin(), scores.end()) -
+                             scores.begin());
+    best.shift = firstShift + (c % shifts) * shiftStep;
+    best.angle = firstAngle + (c / shifts) * angleStep;
+    best.score = scores[c];
+    if (step <= finestStep) {
+      return best;
+    }
+
+    // Search again between the samples around the best candidate
+    shiftRange = step;
+    angleRange = angles > 1 ? 2 * angleStep : 0;
+    step /= 5;
+  }
+}
+}
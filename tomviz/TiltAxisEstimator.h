@@ -0,0 +1,121 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizTiltAxisEstimator_h
+#define tomvizTiltAxisEstimator_h
+
+#include <complex>
+#include <vector>
+
+namespace tomviz {
+
+namespace TomographyTiltSeries {
+class SinogramStack;
+}
+
+/// Estimates the position and the in-plane angle of the tilt axis, the
+/// parameters of the RotateAlignWidget. It is the native counterpart of
+/// AutoTiltAxisShiftAlignment.py, which also searches the angle. A few
+/// representative slices are reconstructed and every candidate of a
+/// (shift, angle) grid is scored. The grid is refined around the best
+/// candidate until it is finer than a twentieth of a ray.
+///
+/// A candidate moves each slice by its own shift, and its score is the sum of
+/// the scores of the slices at those shifts. So the slices are reconstructed
+/// in parallel (vtkSMPTools) at the shifts the grid covers, and the whole grid
+/// is then scored from these samples.
+///
+/// The shift of a slice is applied as a phase ramp when filtering, so that
+/// fractional shifts don't blur the sinogram. The slices are binned to at most
+/// maximumRays rays. The score of a slice is minus the energy of the negative
+/// values of its reconstruction. A misplaced axis adds streaks of both signs
+/// to the nonnegative object, while the variance of a filtered back
+/// projection hardly changes with the shift.
+class TiltAxisEstimator
+{
+public:
+  struct Estimate
+  {
+    /// The rotation axis and angle (in degrees) of the RotateAlignWidget.
+    double shift = 0;
+    double angle = 0;
+    double score = 0;
+  };
+
+  /// tiltAngles are in degrees, one per tilt of the sinograms. The slices
+  /// used are spread along the tilt axis among the half of the slices with
+  /// the most intensity.
+  TiltAxisEstimator(const TomographyTiltSeries::SinogramStack& sinograms,
+                    const std::vector<double>& tiltAngles,
+                    int numberOfSlices = 5, int maximumRays = 256);
+
+  /// The slices reconstructed for every candidate.
+  const std::vector<int>& slices() const { return m_slices; }
+
+  /// Search shifts in [-range, range] rays, an eighth of the rays by default.
+  void setShiftRange(double range);
+  double shiftRange() const { return m_shiftRange; }
+
+  /// Search angles in [-range, range] degrees, 5 by default. The angle can't
+  /// be estimated from a single slice and is then kept at 0.
+  void setAngleRange(double range);
+  double angleRange() const { return m_angleRange; }
+
+  /// The score of one candidate, higher is better.
+  double score(double shift, double angle) const;
+
+  /// Search the candidate with the best score.
+  Estimate estimate() const;
+
+  /// Shift of the given slice for the candidate, in rays of the tilt series,
+  /// see RotateAlignWidget.
+  double sliceShift(int slice, double shift, double angle) const;
+
+private:
+  // Work space of the score of one candidate.
+  struct Buffers
+  {
+    std::vector<std::complex<float>> phase;
+    std::vector<std::complex<float>> row;
+    std::vector<float> sinogram;
+    std::vector<float> image;
+  };
+
+  void allocate(Buffers& buffers) const;
+
+  // Score of slice i shifted by shift rays of the tilt series.
+  double sliceScore(int i, double shift, Buffers& buffers) const;
+  double score(double shift, double angle, Buffers& buffers) const;
+
+  int m_numberOfSlices;
+  int m_tilts;
+  int m_rays;
+  int m_binning;
+  // Where the center ray of the binned slices falls in the tilt series,
+  // relative to its center ray, in rays of the tilt series.
+  double m_binnedCenter;
+  int m_size;
+  double m_shiftRange;
+  double m_angleRange = 5;
+  std::vector<int> m_slices;
+  std::vector<float> m_cosines;
+  std::vector<float> m_sines;
+  // The Fourier transforms of the rows of the binned slices, m_size values
+  // per tilt, ramp filtered.
+  std::vector<std::complex<float>> m_spectra;
+};
+}
+
+#endif
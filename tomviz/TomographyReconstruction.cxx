@@ -14,6 +14,8 @@
 
  ******************************************************************************/
 #include "TomographyReconstruction.h"
+#include "BackProjectionKernels.h"
+#include "FFT.h"
 #include "TomographyTiltSeries.h"
 #include <math.h>
 
@@ -26,9 +28,56 @@
 #include "vtkSmartPointer.h"
 
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace {
 
+using tomviz::TomographyReconstruction::Filter;
+
+// The frequency response of the filter for rows zero padded to size values.
+// The responses are cached per (size, filter), they are requested for every
+// slice of a reconstruction.
+const std::vector<float>& filterResponse(int size, Filter filter)
+{
+  static QMutex mutex;
+  static std::map<std::pair<int, Filter>, std::vector<float>> cache;
+
+  QMutexLocker locker(&mutex);
+  auto& response = cache[std::make_pair(size, filter)];
+  if (response.empty()) {
+    response.resize(size);
+    for (int i = 0; i < size; ++i) {
+      // Same layout as numpy.fft.fftfreq
+      double freq = (i < (size + 1) / 2 ? i : i - size) / double(size);
+      double omega = 2 * PI * freq;
+      double value = 2 * std::abs(freq);
+      if (i > 0) {
+        switch (filter) {
+          case Filter::SheppLogan:
+            value *= sin(omega) / omega;
+            break;
+          case Filter::Hann:
+            value *= (1 + cos(omega / 2)) / 2;
+            break;
+          case Filter::None:
+          case Filter::Ramp:
+            break;
+        }
+      }
+      response[i] = static_cast<float>(filter == Filter::None ? 1.0 : value);
+    }
+  }
+  return response;
+}
+
 // Conversion code
 template <typename T>
 vtkSmartPointer<vtkFloatArray> convertToFloatT(T* data, int len)
@@ -48,7 +97,8 @@ namespace tomviz {
 namespace TomographyReconstruction {
 
 // 3D Weighted Back Projection reconstruction
-void weightedBackProjection3(vtkImageData* tiltSeries, vtkImageData* recon)
+void weightedBackProjection3(vtkImageData* tiltSeries, vtkImageData* recon,
+                             Filter filter)
 {
   int extents[6];
   tiltSeries->GetExtent(extents);
@@ -70,16 +120,18 @@ void weightedBackProjection3(vtkImageData* tiltSeries, vtkImageData* recon)
   float* reconPtr = static_cast<float*>(recon->GetScalarPointer());
 
   // Reconstruction
+  TomographyTiltSeries::SinogramStack sinograms(tiltSeries);
   float* sinogram = new float[yDim * zDim]; // Placeholder for 2D sinogram
   float* recon2d =
     new float[yDim * yDim]; // Placeholder for 2D reconstruction (y-z plane)
   for (int s = 0; s < xDim; ++s) // Loop through slices (x-direction)
   {
     // Get sinogram
-    TomographyTiltSeries::getSinogram(tiltSeries, s, sinogram);
+    sinograms.getSinogram(s, sinogram);
     // 2D back projection
-    TomographyReconstruction::unweightedBackProjection2(sinogram, tiltAngles,
-                                                        recon2d, zDim, yDim);
+    TomographyReconstruction::weightedBackProjection2(sinogram, tiltAngles,
+                                                      recon2d, zDim, yDim,
+                                                      filter);
     // Put recon into
     for (int iy = 0; iy < outputSize[1];
          ++iy) // Loop through all pixels in reconstructed image (y-z plane)
@@ -92,45 +144,66 @@ void weightedBackProjection3(vtkImageData* tiltSeries, vtkImageData* recon)
   delete[] sinogram;
 }
 
+void filterSinogram(float* sinogram, int numOfTilts, int numOfRays,
+                    Filter filter)
+{
+  if (filter == Filter::None) {
+    return;
+  }
+
+  int size = FFT::nextPowerOfTwo(2 * numOfRays);
+  const std::vector<float>& response = filterResponse(size, filter);
+  std::vector<std::complex<float>> rows(size);
+  for (int tt = 0; tt < numOfTilts; tt += 2) {
+    // The filter is real and even, so the two real rows packed as the real
+    // and imaginary parts of one signal come back out unmixed.
+    float* first = sinogram + tt * numOfRays;
+    float* second = tt + 1 < numOfTilts ? first + numOfRays : nullptr;
+    for (int i = 0; i < numOfRays; ++i) {
+      rows[i] = std::complex<float>(first[i], second ? second[i] : 0.0f);
+    }
+    std::fill(rows.begin() + numOfRays, rows.end(), std::complex<float>());
+
+    FFT::transform(rows.data(), size);
+    for (int i = 0; i < size; ++i) {
+      rows[i] *= response[i];
+    }
+    FFT::transform(rows.data(), size, true);
+
+    for (int i = 0; i < numOfRays; ++i) {
+      first[i] = rows[i].real();
+      if (second) {
+        second[i] = rows[i].imag();
+      }
+    }
+  }
+}
+
 // 2D WBP recon
+void weightedBackProjection2(float* sinogram, double* tiltAngles, float* recon,
+                             int numOfTilts, int numOfRays, Filter filter)
+{
+  filterSinogram(sinogram, numOfTilts, numOfRays, filter);
+  unweightedBackProjection2(sinogram, tiltAngles, recon, numOfTilts,
+                            numOfRays);
+}
+
+// 2D unweighted back projection
 void unweightedBackProjection2(float* sinogram, double* tiltAngles,
                                float* image, int numOfTilts, int numOfRays)
 {
-  for (int i = 0; i < numOfRays * numOfRays; ++i) {
-    image[i] = 0; // Set all pixels to zero
-  }
-
-  // 2D unweighted Back Projection
-  for (int tt = 0; tt < numOfTilts; ++tt) // Loop through tilts
-  {
+  // The kernels step along the image rows by the sine of the angle.
+  std::vector<float> cosines(numOfTilts);
+  std::vector<float> sines(numOfTilts);
+  for (int tt = 0; tt < numOfTilts; ++tt) {
     double angle = tiltAngles[tt] * PI / 180;
-    for (int iy = 0; iy < numOfRays; ++iy) // Loop through all pixels in
-                                           // reconstructed image (y-z plane for
-                                           // a tilt series)
-      for (int iz = 0; iz < numOfRays; ++iz) {
-        // Calcualte y,z coord.
-        double y = iy + 0.5 - ((double)numOfRays) / 2.0;
-        double z = iz + 0.5 - ((double)numOfRays) / 2.0;
-        // Calculate ray coord.
-        double t = y * cos(angle) + z * sin(angle);
-
-        if (t >= -numOfRays / 2 &&
-            t <= numOfRays / 2) // check if ray is inside projection
-        {
-          int rayIndex = floor((t + numOfRays / 2));
-          if (rayIndex >= 0 && rayIndex <= numOfRays - 2) {
-            // Linear interpolation
-            double Q1 = sinogram[tt * numOfRays + rayIndex];
-            double Q2 = sinogram[tt * numOfRays + rayIndex + 1];
-            double QDash =
-              Q1 + (t - double(rayIndex - numOfRays / 2)) * (Q2 - Q1);
-            image[iy * numOfRays + iz] += QDash;
-          }
-        }
-      }
+    cosines[tt] = static_cast<float>(cos(angle));
+    sines[tt] = static_cast<float>(sin(angle));
   }
+  BackProjectionKernels::backProject(sinogram, cosines.data(), sines.data(),
+                                     image, numOfTilts, numOfRays);
 
-  double normalizationFactor = PI / double(2 * numOfTilts);
+  float normalizationFactor = static_cast<float>(PI / double(2 * numOfTilts));
   for (int i = 0; i < numOfRays * numOfRays; ++i) {
     image[i] *= normalizationFactor;
   }
@@ -25,10 +25,32 @@ class DataSource;
 
 namespace TomographyReconstruction {
 
+// Fourier filters applied to the sinogram rows before back projecting them,
+// they match the ones of the Python weighted back projection (Recon_WBP.py).
+enum class Filter
+{
+  None,
+  Ramp,
+  SheppLogan,
+  Hann
+};
+
 // This takes an image tiltSeries and a vtkImageData in which to place the
 // output (recon)
-void weightedBackProjection3(vtkImageData* tiltSeries,
-                             vtkImageData* recon); // 3D WBP recon
+void weightedBackProjection3(vtkImageData* tiltSeries, vtkImageData* recon,
+                             Filter filter = Filter::Ramp); // 3D WBP recon
+
+// Filter every projection (row) of the sinogram in place. The rows are zero
+// padded to avoid wrap around, and filtered two at a time in a single complex
+// FFT. Thread safe.
+void filterSinogram(float* sinogram, int numOfTilts, int numOfRays,
+                    Filter filter);
+
+// Filter the sinogram, which is modified in place, and back project it, see
+// unweightedBackProjection2.
+void weightedBackProjection2(float* sinogram, double* tiltAngles, float* recon,
+                             int numOfTilts, int numOfRays,
+                             Filter filter = Filter::Ramp); // 2D WBP recon
 
 // This function takes a y-z slice (sinogram) and the tilt angles as input and
 // creates a slice throught the reconstruction space.  The numOfTilts parameter
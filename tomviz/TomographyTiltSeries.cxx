@@ -23,8 +23,12 @@
 #include "vtkPointData.h"
 #include "vtkSmartPointer.h"
 
+#include <vtkSMPTools.h>
+
 #include <QDebug>
 
+#include <algorithm>
+
 namespace {
 
 // conversion code
@@ -40,35 +44,122 @@ vtkSmartPointer<vtkFloatArray> convertToFloatT(T* data, int len)
   return array;
 }
 
+// Transpose [tilt][ray][slice] to [slice][tilt][ray], converting to float.
+// Each thread writes a block of slices while reading the tilt series rows in
+// order.
+template <typename T>
+void transposeToSinograms(const T* data, const int dims[3], float* sinograms)
+{
+  vtkIdType numSlices = dims[0];
+  vtkIdType numRays = dims[1];
+  vtkIdType numTilts = dims[2];
+  vtkSMPTools::For(0, numSlices, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType t = 0; t < numTilts; ++t) {
+      for (vtkIdType r = 0; r < numRays; ++r) {
+        const T* row = data + (t * numRays + r) * numSlices;
+        for (vtkIdType s = begin; s < end; ++s) {
+          sinograms[(s * numTilts + t) * numRays + r] =
+            static_cast<float>(row[s]);
+        }
+      }
+    }
+  });
+}
+} // end of namespace
+
+namespace tomviz {
+
+namespace TomographyTiltSeries {
+
 vtkSmartPointer<vtkFloatArray> convertToFloat(vtkImageData* image)
 {
   vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  vtkSmartPointer<vtkFloatArray> array = vtkFloatArray::SafeDownCast(scalars);
+  if (array) {
+    // Already float, no need to copy.
+    return array;
+  }
   int len = scalars->GetNumberOfTuples();
-  vtkSmartPointer<vtkFloatArray> array;
   switch (scalars->GetDataType()) {
     vtkTemplateMacro(array = convertToFloatT(
                        static_cast<VTK_TT*>(scalars->GetVoidPointer(0)), len););
   }
   return array;
 }
-} // end of namespace
 
-namespace tomviz {
+SinogramStack::SinogramStack(vtkImageData* tiltSeries)
+{
+  int extents[6];
+  tiltSeries->GetExtent(extents);
+  m_dims[0] = extents[1] - extents[0] + 1; // number of slices
+  m_dims[1] = extents[3] - extents[2] + 1; // number of rays
+  m_dims[2] = extents[5] - extents[4] + 1; // number of tilts
 
-namespace TomographyTiltSeries {
+  m_data.resize(static_cast<size_t>(m_dims[0]) * m_dims[1] * m_dims[2]);
+  vtkDataArray* scalars = tiltSeries->GetPointData()->GetScalars();
+  switch (scalars->GetDataType()) {
+    vtkTemplateMacro(transposeToSinograms(
+      static_cast<VTK_TT*>(scalars->GetVoidPointer(0)), m_dims, &m_data[0]));
+  }
+}
+
+const float* SinogramStack::sinogram(int slice) const
+{
+  return &m_data[static_cast<size_t>(slice) * m_dims[1] * m_dims[2]];
+}
+
+void SinogramStack::getSinogram(int slice, float* sinogram) const
+{
+  const float* source = this->sinogram(slice);
+  std::copy(source, source + m_dims[1] * m_dims[2], sinogram);
+}
+
+void SinogramStack::getSinogram(int slice, float* sinogram, int Nray,
+                                double axisPosition) const
+{
+  int yDim = m_dims[1]; // number of rays in tilt series
+  int zDim = m_dims[2]; // number of tilts
+  const float* source = this->sinogram(slice);
+
+  double rayWidth = (double)yDim / (double)Nray;
+  std::vector<float> weight1(Nray); // Store weights for linear interpolation
+  std::vector<float> weight2(Nray); // Store weights for linear interpolation
+  std::vector<int> index1(Nray);    // Store indices for linear interpolation
+  std::vector<int> index2(Nray);    // Store indices for linear interpolation
+  for (int r = 0; r < Nray; ++r) {
+    double rayCoord = (double)(r - Nray / 2) * rayWidth + axisPosition;
+    index1[r] = floor(rayCoord) + yDim / 2;
+    index2[r] = index1[r] + 1;
+    weight1[r] = fabs(rayCoord - floor(rayCoord));
+    weight2[r] = 1 - weight1[r];
+  }
+
+  for (int z = 0; z < zDim; ++z) // Loop through tilts
+  {
+    const float* row = source + z * yDim;
+    for (int r = 0; r < Nray; ++r) // Loop through rays
+    {
+      float value = 0;
+      if (index1[r] >= 0 && index1[r] < yDim)
+        value += row[index1[r]] * weight1[r];
+      if (index2[r] >= 0 && index2[r] < yDim)
+        value += row[index2[r]] * weight2[r];
+      sinogram[z * Nray + r] = value;
+    }
+  }
+}
 
 void getSinogram(vtkImageData* tiltSeries, int sliceNumber, float* sinogram)
 {
   int extents[6];
   tiltSeries->GetExtent(extents);
-  int xDim = extents[1] - extents[0] + 1; // Number of slices
-  int yDim = extents[3] - extents[2] + 1; // Number of rays
-  int zDim = extents[5] - extents[4] + 1; // Number of tilts
+  int xDim = extents[1] - extents[0] + 1; // number of slices
+  int yDim = extents[3] - extents[2] + 1; // number of rays
+  int zDim = extents[5] - extents[4] + 1; // number of tilts
 
   // Convert tiltSeries type to float
   vtkSmartPointer<vtkFloatArray> dataAsFloats = convertToFloat(tiltSeries);
-  float* dataPtr = static_cast<float*>(dataAsFloats->GetVoidPointer(
-    0)); // Get pointer to tilt series (of type float)
+  const float* dataPtr = dataAsFloats->GetPointer(0);
 
   // Extract sinograms from tilt series. Make a deep copy
   for (int t = 0; t < zDim; ++t) // Loop through tilts (z-direction)
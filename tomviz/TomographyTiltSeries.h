@@ -18,7 +18,11 @@
 #define tomvizTomographyTiltSeries_h
 
 #include "pqReaction.h"
+#include "vtkFloatArray.h"
 #include "vtkImageData.h"
+#include "vtkSmartPointer.h"
+
+#include <vector>
 
 namespace tomviz {
 
@@ -26,6 +30,38 @@ class DataSource;
 
 namespace TomographyTiltSeries {
 
+/// The sinograms of a tilt series, converted to float once and stored
+/// sinogram by sinogram as [slice][tilt][ray], so that reading a sinogram is a
+/// contiguous copy instead of a gather with a stride of the number of slices.
+/// Read only once constructed, sinograms can be read from several threads.
+class SinogramStack
+{
+public:
+  /// Converts and transposes the scalars of tiltSeries, which has dimensions
+  /// [slices, rays, tilts]. Uses vtkSMPTools.
+  explicit SinogramStack(vtkImageData* tiltSeries);
+
+  int numberOfSlices() const { return m_dims[0]; }
+  int numberOfRays() const { return m_dims[1]; }
+  int numberOfTilts() const { return m_dims[2]; }
+
+  /// The sinogram of the given slice, numberOfTilts() rows of
+  /// numberOfRays().
+  const float* sinogram(int slice) const;
+
+  /// Copy the sinogram of the given slice.
+  void getSinogram(int slice, float* sinogram) const;
+
+  /// Interpolate a sinogram of Nray rays with the rotation axis moved by
+  /// axisPosition rays. Useful for axis alignment
+  void getSinogram(int slice, float* sinogram, int Nray,
+                   double axisPosition = 0) const;
+
+private:
+  int m_dims[3];
+  std::vector<float> m_data;
+};
+
 /// Extract sinogram from tilt series. This takes as input an image and a slice
 /// number.  If the input image has dimensions [x, y, z] the slice number must
 /// be in the interval [0,y-1].  The output is stored in the sinogram pointer,
@@ -33,8 +69,13 @@ namespace TomographyTiltSeries {
 /// Simply takes a y-z slice of the input image. Useful for reconstruction
 void getSinogram(vtkImageData* tiltSeries, int, float* sinogram);
 
+/// Returns the scalars of image as floats, the scalars themselves if they
+/// already are floats.
+vtkSmartPointer<vtkFloatArray> convertToFloat(vtkImageData* image);
+
 /// Interpolate a sinogram of given size and rotation axis. Useful for axis
-/// alignment
+/// alignment. Converts the whole tilt series, use SinogramStack to extract
+/// several sinograms.
 void getSinogram(vtkImageData* tiltSeries, int, float* sinogram, int Nray,
                  double axisPosition = 0);
 
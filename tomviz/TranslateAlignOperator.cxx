@@ -19,65 +19,104 @@
 #include "AlignWidget.h"
 #include "DataSource.h"
 
+#include "vtkDataArray.h"
 #include "vtkImageData.h"
-#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkSMPTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
 
 namespace {
 
-// We are assuming an image that begins at 0, 0, 0.
-vtkIdType imageIndex(const vtkVector3i& incs, const vtkVector3i& pos)
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, T>::type toScalar(
+  double value)
 {
-  return pos[0] * incs[0] + pos[1] * incs[1] + pos[2] * incs[2];
+  return static_cast<T>(std::floor(value + 0.5));
 }
 
 template <typename T>
-void applyImageOffsets(T* in, T* out, vtkImageData* image,
-                       const QVector<vtkVector2i>& offsets)
+typename std::enable_if<!std::is_integral<T>::value, T>::type toScalar(
+  double value)
 {
-  // We know that the input and output images are the same size, with the
-  // supplied offsets applied to each slice. Copy the pixels, applying offsets.
-  int* extents = image->GetExtent();
-  vtkVector3i extent(extents[1] - extents[0] + 1, extents[3] - extents[2] + 1,
-                     extents[5] - extents[4] + 1);
-  vtkVector3i incs(1, 1 * extent[0], 1 * extent[0] * extent[1]);
-
-  // Zero out our output array, we should do this more intelligently in future.
-  T* ptr = out;
-  for (int i = 0; i < extent[0] * extent[1] * extent[2]; ++i) {
-    *ptr++ = 0;
-  }
+  return static_cast<T>(value);
+}
 
-  // We need to go slice by slice, applying the pixel offsets to the new image.
-  for (int i = 0; i < extent[2]; ++i) {
-    vtkVector2i offset = offsets[i];
-    int idx = imageIndex(incs, vtkVector3i(0, 0, i));
-    T* inPtr = in + idx;
-    T* outPtr = out + idx;
-    for (int y = 0; y < extent[1]; ++y) {
-      if (y + offset[1] >= extent[1]) {
-        break;
-      } else if (y + offset[1] < 0) {
-        inPtr += incs[1];
-        outPtr += incs[1];
+// Shift one image in place so that out(x, y) = in(x - offset[0],
+// y - offset[1]), interpolating bilinearly for fractional offsets. Pixels
+// that come from outside of the image are set to zero. The rows are visited
+// in the direction of the shift so that every source row is read before it
+// is overwritten, each output row being accumulated in the scanline buffer.
+template <typename T>
+void shiftImage(T* image, int nx, int ny, const vtkVector2f& offset,
+                std::vector<double>& row)
+{
+  double sx = -offset[0];
+  double sy = -offset[1];
+  int dx = static_cast<int>(std::floor(sx));
+  int dy = static_cast<int>(std::floor(sy));
+  double fx = sx - dx;
+  double fy = sy - dy;
+  double wx[2] = { 1.0 - fx, fx };
+  double wy[2] = { 1.0 - fy, fy };
+
+  bool descending = offset[1] > 0;
+  for (int i = 0; i < ny; ++i) {
+    int y = descending ? ny - 1 - i : i;
+    std::fill(row.begin(), row.end(), 0.0);
+    for (int ky = 0; ky < 2; ++ky) {
+      int ys = y + dy + ky;
+      if (wy[ky] == 0.0 || ys < 0 || ys >= ny) {
         continue;
       }
-      for (int x = 0; x < extent[0]; ++x) {
-        if (x + offset[0] >= extent[0]) {
-          inPtr += offset[0];
-          outPtr += offset[0];
-          break;
-        } else if (x + offset[0] < 0) {
-          ++inPtr;
-          ++outPtr;
+      const T* src = image + static_cast<size_t>(ys) * nx;
+      for (int kx = 0; kx < 2; ++kx) {
+        double w = wy[ky] * wx[kx];
+        if (w == 0.0) {
           continue;
         }
-        *(outPtr + offset[0] + incs[1] * offset[1]) = *inPtr;
-        ++inPtr;
-        ++outPtr;
+        int shift = dx + kx;
+        int begin = std::max(0, -shift);
+        int end = std::min(nx, nx - shift);
+        for (int x = begin; x < end; ++x) {
+          row[x] += w * src[x + shift];
+        }
       }
     }
+    T* dst = image + static_cast<size_t>(y) * nx;
+    for (int x = 0; x < nx; ++x) {
+      dst[x] = toScalar<T>(row[x]);
+    }
   }
 }
+
+template <typename T>
+void applyImageOffsets(T* data, vtkImageData* image,
+                       const QVector<vtkVector2f>& offsets)
+{
+  int* extent = image->GetExtent();
+  int nx = extent[1] - extent[0] + 1;
+  int ny = extent[3] - extent[2] + 1;
+  int nz = extent[5] - extent[4] + 1;
+  vtkIdType count = std::min(nz, offsets.size());
+
+  // Each tilt image is independent, so shift them in parallel. The scanline
+  // buffer is allocated once per chunk of images rather than once per image.
+  vtkSMPTools::For(0, count, [&](vtkIdType begin, vtkIdType end) {
+    std::vector<double> row(nx);
+    for (vtkIdType i = begin; i < end; ++i) {
+      const vtkVector2f& offset = offsets[i];
+      if (offset[0] == 0.0f && offset[1] == 0.0f) {
+        continue;
+      }
+      shiftImage(data + static_cast<size_t>(i) * nx * ny, nx, ny, offset,
+                 row);
+    }
+  });
+}
 }
 
 namespace tomviz {
@@ -93,17 +132,13 @@ QIcon TranslateAlignOperator::icon() const
 
 bool TranslateAlignOperator::applyTransform(vtkDataObject* data)
 {
-  vtkNew<vtkImageData> outImage;
-  vtkImageData* inImage = vtkImageData::SafeDownCast(data);
-  assert(inImage);
-  outImage->DeepCopy(data);
-  switch (inImage->GetScalarType()) {
-    vtkTemplateMacro(
-      applyImageOffsets(reinterpret_cast<VTK_TT*>(inImage->GetScalarPointer()),
-                        reinterpret_cast<VTK_TT*>(outImage->GetScalarPointer()),
-                        inImage, offsets));
+  vtkImageData* image = vtkImageData::SafeDownCast(data);
+  assert(image);
+  switch (image->GetScalarType()) {
+    vtkTemplateMacro(applyImageOffsets(
+      reinterpret_cast<VTK_TT*>(image->GetScalarPointer()), image, offsets));
   }
-  data->ShallowCopy(outImage.Get());
+  image->GetPointData()->GetScalars()->Modified();
   return true;
 }
 
@@ -133,8 +168,8 @@ bool TranslateAlignOperator::deserialize(const pugi::xml_node& ns)
   for (pugi::xml_node node = ns.child("offset"); node;
        node = node.next_sibling("offset")) {
     int sliceNum = node.attribute("slice_number").as_int();
-    int xOffset = node.attribute("x_offset").as_int();
-    int yOffset = node.attribute("y_offset").as_int();
+    float xOffset = node.attribute("x_offset").as_float();
+    float yOffset = node.attribute("y_offset").as_float();
     this->offsets[sliceNum][0] = xOffset;
     this->offsets[sliceNum][1] = yOffset;
   }
@@ -148,7 +183,7 @@ EditOperatorWidget* TranslateAlignOperator::getEditorContentsWithData(
 }
 
 void TranslateAlignOperator::setAlignOffsets(
-  const QVector<vtkVector2i>& newOffsets)
+  const QVector<vtkVector2f>& newOffsets)
 {
   this->offsets.resize(newOffsets.size());
   std::copy(newOffsets.begin(), newOffsets.end(), this->offsets.begin());
@@ -44,18 +44,19 @@ public:
   EditOperatorWidget* getEditorContentsWithData(
     QWidget* parent, vtkSmartPointer<vtkImageData> data) override;
 
-  void setAlignOffsets(const QVector<vtkVector2i>& offsets);
-  const QVector<vtkVector2i>& getAlignOffsets() const { return offsets; }
+  void setAlignOffsets(const QVector<vtkVector2f>& offsets);
+  const QVector<vtkVector2f>& getAlignOffsets() const { return offsets; }
 
   DataSource* getDataSource() const { return this->dataSource; }
 
   bool hasCustomUI() const override { return true; }
+  bool supportsPreview() const override { return false; }
 
 protected:
   bool applyTransform(vtkDataObject* data) override;
 
 private:
-  QVector<vtkVector2i> offsets;
+  QVector<vtkVector2f> offsets;
   const QPointer<DataSource> dataSource;
 };
 }
@@ -16,6 +16,7 @@
 #include "Utilities.h"
 
 #include "DataSource.h"
+#include "PipelineTracer.h"
 
 #include <pqAnimationCue.h>
 #include <pqAnimationManager.h>
@@ -30,6 +31,9 @@
 
 #include <vtkBoundingBox.h>
 #include <vtkCamera.h>
+#include <vtkCellData.h>
+#include <vtkDataSet.h>
+#include <vtkFieldData.h>
 #include <vtkImageData.h>
 #include <vtkImageSliceMapper.h>
 #include <vtkNew.h>
@@ -39,6 +43,7 @@
 #include <vtkPVXMLElement.h>
 #include <vtkPVXMLParser.h>
 #include <vtkPiecewiseFunction.h>
+#include <vtkPointData.h>
 #include <vtkPoints.h>
 #include <vtkRenderer.h>
 #include <vtkSMTransferFunctionManager.h>
@@ -573,5 +578,79 @@ QString findPrefix(const QStringList& fileNames)
   return prefix;
 }
 
+void copyOnWrite(vtkDataObject* source, vtkDataObject* target)
+{
+  target->ShallowCopy(source);
+  // Field data arrays are small and are routinely modified in place (tilt
+  // angles for example), never share them.
+  if (source->GetFieldData() && target->GetFieldData()) {
+    target->GetFieldData()->DeepCopy(source->GetFieldData());
+  }
+}
+
+vtkIdType detachSharedArrays(vtkDataObject* data)
+{
+  vtkDataSet* dataSet = vtkDataSet::SafeDownCast(data);
+  if (!dataSet) {
+    return 0;
+  }
+
+  vtkIdType bytes = 0;
+  vtkDataSetAttributes* attributes[] = { dataSet->GetPointData(),
+                                         dataSet->GetCellData() };
+  for (auto attrs : attributes) {
+    // Collect the arrays in order, with private copies of the shared ones.
+    std::vector<vtkSmartPointer<vtkAbstractArray>> arrays;
+    bool shared = false;
+    for (int i = 0; i < attrs->GetNumberOfArrays(); ++i) {
+      vtkSmartPointer<vtkAbstractArray> array = attrs->GetAbstractArray(i);
+      // The attributes hold the only reference to arrays that aren't shared.
+      if (array && array->GetReferenceCount() > 2) {
+        vtkSmartPointer<vtkAbstractArray> copy;
+        copy.TakeReference(array->NewInstance());
+        copy->DeepCopy(array);
+        bytes += static_cast<vtkIdType>(copy->GetActualMemorySize()) * 1024;
+        array = copy;
+        shared = true;
+      }
+      arrays.push_back(array);
+    }
+    if (!shared) {
+      continue;
+    }
+
+    // Put the arrays back at the same indices and restore the attributes
+    // (e.g. the active scalars), which removing the arrays resets.
+    int indices[vtkDataSetAttributes::NUM_ATTRIBUTES];
+    attrs->GetAttributeIndices(indices);
+    for (int i = attrs->GetNumberOfArrays() - 1; i >= 0; --i) {
+      attrs->RemoveArray(i);
+    }
+    for (auto& array : arrays) {
+      attrs->AddArray(array);
+    }
+    for (int attribute = 0; attribute < vtkDataSetAttributes::NUM_ATTRIBUTES;
+         ++attribute) {
+      if (indices[attribute] >= 0) {
+        attrs->SetActiveAttribute(indices[attribute], attribute);
+      }
+    }
+  }
+  PipelineTracer::addBytesCopied(bytes);
+
+  return bytes;
+}
+
+quint64 fnv1aHash(const void* data, size_t length, quint64 hash)
+{
+  const quint64 prime = 1099511628211ULL;
+  auto bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= prime;
+  }
+  return hash;
+}
+
 double offWhite[3] = { 204.0 / 255, 204.0 / 255, 204.0 / 255 };
 }
@@ -32,6 +32,7 @@
 
 class pqAnimationScene;
 
+class vtkDataObject;
 class vtkImageSliceMapper;
 class vtkRenderer;
 class vtkSMProxyLocator;
@@ -188,6 +189,22 @@ Variant toVariant(const QVariantList& value);
 /// Find common prefix for collection of file names
 QString findPrefix(const QStringList& fileNames);
 
+/// Copy source into target sharing the point and cell data arrays rather than
+/// duplicating them, the field data is always deep copied. The arrays are
+/// copied on write: anything that is going to modify them in place must call
+/// detachSharedArrays() on the target first.
+void copyOnWrite(vtkDataObject* source, vtkDataObject* target);
+
+/// Replace any point or cell data array of data that is still shared with
+/// another data object with a private deep copy, so it can safely be modified
+/// in place. Returns the number of bytes copied.
+vtkIdType detachSharedArrays(vtkDataObject* data);
+
+/// 64 bit FNV-1a hash of length bytes of data, pass the previous hash to
+/// combine several buffers.
+quint64 fnv1aHash(const void* data, size_t length,
+                  quint64 hash = 14695981039346656037ULL);
+
 extern double offWhite[3];
 }
 
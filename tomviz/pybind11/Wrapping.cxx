@@ -14,12 +14,35 @@
 
 ******************************************************************************/
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 #include "OperatorPythonWrapper.h"
+#include "ParallelProjector.h"
+
+#include <stdexcept>
+#include <vector>
 
 namespace py = pybind11;
 
+namespace {
+
+typedef py::array_t<float, py::array::c_style | py::array::forcecast>
+  FloatArray;
+
+// Check that array has the given shape and return its data
+const float* checkedData(const FloatArray& array, size_t rows, size_t columns)
+{
+  py::buffer_info info = array.request();
+  if (info.ndim != 2 || static_cast<size_t>(info.shape[0]) != rows ||
+      static_cast<size_t>(info.shape[1]) != columns) {
+    throw std::invalid_argument("Array has the wrong shape.");
+  }
+  return static_cast<const float*>(info.ptr);
+}
+}
+
 PYBIND11_PLUGIN(_wrapping)
 {
   py::module m("_wrapping", "tomviz wrapped classes");
@@ -38,5 +61,46 @@ PYBIND11_PLUGIN(_wrapping)
     .def_property("progress_message", &OperatorPythonWrapper::progressMessage,
                   &OperatorPythonWrapper::setProgressMessage);
 
+  // Matrix free alternative to parallelRay() of the Python reconstructions,
+  // forward(image) returns the (Nproj, Nray) sinogram of an (Nside, Nside)
+  // image and back(sinogram) applies the transpose.
+  py::class_<tomviz::ParallelProjector>(m, "ParallelProjector")
+    .def("__init__",
+         [](tomviz::ParallelProjector& instance, int Nside, double pixelWidth,
+            const std::vector<double>& angles, int Nray, double rayWidth) {
+           new (&instance) tomviz::ParallelProjector(Nside, pixelWidth, angles,
+                                                     Nray, rayWidth);
+         })
+    .def_property_readonly("rows", &tomviz::ParallelProjector::rows)
+    .def_property_readonly("columns", &tomviz::ParallelProjector::columns)
+    .def("forward",
+         [](const tomviz::ParallelProjector& projector, FloatArray image) {
+           size_t Nside = projector.sideLength();
+           const float* data = checkedData(image, Nside, Nside);
+           FloatArray sinogram(std::vector<size_t>{
+             static_cast<size_t>(projector.numberOfProjections()),
+             static_cast<size_t>(projector.numberOfRays()) });
+           float* result = static_cast<float*>(sinogram.request().ptr);
+           {
+             py::gil_scoped_release release;
+             projector.forward(data, result);
+           }
+           return sinogram;
+         })
+    .def("back",
+         [](const tomviz::ParallelProjector& projector, FloatArray sinogram) {
+           const float* data =
+             checkedData(sinogram, projector.numberOfProjections(),
+                         projector.numberOfRays());
+           size_t Nside = projector.sideLength();
+           FloatArray image(std::vector<size_t>{ Nside, Nside });
+           float* result = static_cast<float*>(image.request().ptr);
+           {
+             py::gil_scoped_release release;
+             projector.back(data, result);
+           }
+           return image;
+         });
+
   return m.ptr();
 }